@@ -29,6 +29,9 @@ namespace hedger {
 
 typedef int S_T;
 
+// Cache line size assumed by the cache-conscious layouts
+const int kCacheLine = 64;
+
 // Algo is an ancestor class for any algorithm, and is to be used
 // for maintaining relevant statistics on the algorithm (run time, mean, std deviation, etc)
 class Algo
@@ -0,0 +1,606 @@
+// art_tree.cc
+//
+// Implements an Adaptive Radix Tree (ART) over the bytes of S_T keys.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "art_tree.h"
+
+namespace hedger
+{
+// Leaf pointers carry the key in the upper bits and have bit 0 set.
+static inline bool IsLeaf(const hedger::ArtNode *node)
+{
+  return (uintptr_t) node & 1;
+}
+
+static inline hedger::ArtNode *MakeLeaf(hedger::S_T key)
+{
+  return (hedger::ArtNode *) (((uintptr_t) (uint32_t) key << 1) | 1);
+}
+
+static inline hedger::S_T LeafKey(const hedger::ArtNode *node)
+{
+  return (hedger::S_T) (uint32_t) ((uintptr_t) node >> 1);
+}
+
+// KeyBytes
+// Big-endian bytes of key with the sign bit flipped, so that byte order
+// matches signed key order.
+// Entry: key
+//        output array of kArtKeyLen bytes
+static inline void KeyBytes(hedger::S_T key, uint8_t *bytes)
+{
+  uint32_t k = (uint32_t) key ^ 0x80000000u;
+  for (int i = kArtKeyLen - 1; i >= 0; i--) {
+    bytes[i] = (uint8_t) k;
+    k >>= 8;
+  }
+}
+
+// PrefixMismatch
+// Entry: pointer to node
+//        key bytes
+//        current depth
+// Exit:  index of the first prefix byte that differs, or prefixLen
+static inline int PrefixMismatch(const hedger::ArtNode *node, const uint8_t *bytes, int depth)
+{
+  int i = 0;
+  while (i < node->prefixLen && node->prefix[i] == bytes[depth + i]) {
+    i++;
+  }
+  return i;
+}
+
+// Constructor
+ArtTree::ArtTree()
+{
+  root_ = nullptr;
+  nodeTot_ = 0;
+  bytes_ = 0;
+}
+
+// Destructor
+ArtTree::~ArtTree()
+{
+  DeleteRecursive(root_);
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == inserted, false == key already present
+bool ArtTree::Add(hedger::S_T key)
+{
+  uint8_t bytes[kArtKeyLen];
+  KeyBytes(key, bytes);
+  if (!AddRecurse(&root_, bytes, key, 0)) {
+    return false;
+  }
+  nodeTot_++;
+  return true;
+}
+
+// AddRecurse
+//
+// Internal recursion function for Add.
+//
+// Entry: pointer to the slot holding the current node
+//        key bytes
+//        key
+//        current depth in bytes
+// Exit:  true == inserted
+bool ArtTree::AddRecurse(hedger::ArtNode **ref, const uint8_t *bytes, hedger::S_T key, int depth)
+{
+  hedger::ArtNode *node = *ref;
+
+  if (nullptr == node) {
+    *ref = MakeLeaf(key);
+    return true;
+  }
+
+  if (IsLeaf(node)) {
+    // Lazy expansion: split the leaf only now that a second key needs
+    // to share its path.
+    hedger::S_T other = LeafKey(node);
+    if (other == key) {
+      return false;
+    }
+    uint8_t otherBytes[kArtKeyLen];
+    KeyBytes(other, otherBytes);
+    int i = depth;
+    while (bytes[i] == otherBytes[i]) {
+      i++;
+    }
+    hedger::ArtNode *split = NewNode(kArtNode4, nullptr);
+    split->prefixLen = (uint8_t) (i - depth);
+    memcpy(split->prefix, &bytes[depth], i - depth);
+    AddChild(&split, split, bytes[i], MakeLeaf(key));
+    AddChild(&split, split, otherBytes[i], node);
+    *ref = split;
+    return true;
+  }
+
+  if (node->prefixLen) {
+    int p = PrefixMismatch(node, bytes, depth);
+    if (p < node->prefixLen) {
+      // The key leaves the compressed path at byte p: split the path.
+      hedger::ArtNode *split = NewNode(kArtNode4, nullptr);
+      split->prefixLen = (uint8_t) p;
+      memcpy(split->prefix, node->prefix, p);
+      uint8_t branch = node->prefix[p];
+      node->prefixLen -= p + 1;
+      memmove(node->prefix, &node->prefix[p + 1], node->prefixLen);
+      AddChild(&split, split, branch, node);
+      AddChild(&split, split, bytes[depth + p], MakeLeaf(key));
+      *ref = split;
+      return true;
+    }
+    depth += node->prefixLen;
+  }
+
+  hedger::ArtNode **child = FindChild(node, bytes[depth]);
+  if (child) {
+    return AddRecurse(child, bytes, key, depth + 1);
+  }
+  AddChild(ref, node, bytes[depth], MakeLeaf(key));
+  return true;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool ArtTree::Find(hedger::S_T key)
+{
+  uint8_t bytes[kArtKeyLen];
+  KeyBytes(key, bytes);
+
+  hedger::ArtNode *node = root_;
+  int depth = 0;
+  while (node) {
+    if (IsLeaf(node)) {
+      return LeafKey(node) == key;
+    }
+    if (node->prefixLen) {
+      if (PrefixMismatch(node, bytes, depth) != node->prefixLen) {
+        return false;
+      }
+      depth += node->prefixLen;
+    }
+    hedger::ArtNode **child = FindChild(node, bytes[depth]);
+    if (!child) {
+      return false;
+    }
+    node = *child;
+    depth++;
+  }
+  return false;
+}
+
+// DeleteKey
+//
+// Entry: key
+// Exit:  true == success
+bool ArtTree::DeleteKey(hedger::S_T key)
+{
+  uint8_t bytes[kArtKeyLen];
+  KeyBytes(key, bytes);
+  if (!DeleteRecurse(&root_, bytes, key, 0)) {
+    return false;
+  }
+  nodeTot_--;
+  return true;
+}
+
+// DeleteRecurse
+//
+// Internal recursion function for DeleteKey.  Leaves are removed by
+// their parent so that it can shrink or collapse.
+//
+// Entry: pointer to the slot holding the current node
+//        key bytes
+//        key
+//        current depth in bytes
+// Exit:  true == key was found and removed
+bool ArtTree::DeleteRecurse(hedger::ArtNode **ref, const uint8_t *bytes, hedger::S_T key, int depth)
+{
+  hedger::ArtNode *node = *ref;
+  if (nullptr == node) {
+    return false;
+  }
+  if (IsLeaf(node)) {
+    // Only reached for a leaf sitting at the root
+    if (LeafKey(node) != key) {
+      return false;
+    }
+    *ref = nullptr;
+    return true;
+  }
+
+  if (node->prefixLen) {
+    if (PrefixMismatch(node, bytes, depth) != node->prefixLen) {
+      return false;
+    }
+    depth += node->prefixLen;
+  }
+
+  hedger::ArtNode **child = FindChild(node, bytes[depth]);
+  if (!child) {
+    return false;
+  }
+  if (IsLeaf(*child)) {
+    if (LeafKey(*child) != key) {
+      return false;
+    }
+    RemoveChild(ref, node, bytes[depth]);
+    return true;
+  }
+  return DeleteRecurse(child, bytes, key, depth + 1);
+}
+
+// FindChild
+//
+// Entry: pointer to inner node
+//        key byte
+// Exit:  pointer to the child slot, or nullptr if there is no such child
+hedger::ArtNode **ArtTree::FindChild(hedger::ArtNode *node, uint8_t byte)
+{
+  switch (node->type) {
+    case kArtNode4: {
+      hedger::ArtNode4 *n = (hedger::ArtNode4 *) node;
+      for (int i = 0; i < n->count; i++) {
+        if (n->keys[i] == byte) {
+          return &n->children[i];
+        }
+      }
+      return nullptr;
+    }
+    case kArtNode16: {
+      hedger::ArtNode16 *n = (hedger::ArtNode16 *) node;
+#if defined(__SSE2__)
+      __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8((char) byte),
+        _mm_loadu_si128((const __m128i *) n->keys));
+      unsigned int mask = (unsigned int) _mm_movemask_epi8(cmp) & ((1u << n->count) - 1);
+      return mask ? &n->children[__builtin_ctz(mask)] : nullptr;
+#else
+      for (int i = 0; i < n->count; i++) {
+        if (n->keys[i] == byte) {
+          return &n->children[i];
+        }
+      }
+      return nullptr;
+#endif
+    }
+    case kArtNode48: {
+      hedger::ArtNode48 *n = (hedger::ArtNode48 *) node;
+      int slot = n->childIndex[byte];
+      return slot ? &n->children[slot - 1] : nullptr;
+    }
+    default: {
+      hedger::ArtNode256 *n = (hedger::ArtNode256 *) node;
+      return n->children[byte] ? &n->children[byte] : nullptr;
+    }
+  }
+}
+
+// AddChild
+//
+// Add a child under a new key byte, growing the node to the next larger
+// type when it is full.
+//
+// Entry: pointer to the slot holding node
+//        pointer to inner node
+//        key byte
+//        child to add
+void ArtTree::AddChild(hedger::ArtNode **ref, hedger::ArtNode *node, uint8_t byte,
+  hedger::ArtNode *child)
+{
+  switch (node->type) {
+    case kArtNode4: {
+      hedger::ArtNode4 *n = (hedger::ArtNode4 *) node;
+      if (n->count < 4) {
+        int i = 0;
+        while (i < n->count && n->keys[i] < byte) {
+          i++;
+        }
+        memmove(&n->keys[i + 1], &n->keys[i], n->count - i);
+        memmove(&n->children[i + 1], &n->children[i], (n->count - i) * sizeof(hedger::ArtNode *));
+        n->keys[i] = byte;
+        n->children[i] = child;
+        n->count++;
+        return;
+      }
+      hedger::ArtNode16 *grown = (hedger::ArtNode16 *) NewNode(kArtNode16, n);
+      memcpy(grown->keys, n->keys, 4);
+      memcpy(grown->children, n->children, 4 * sizeof(hedger::ArtNode *));
+      grown->count = 4;
+      FreeNode(n);
+      *ref = grown;
+      AddChild(ref, grown, byte, child);
+      return;
+    }
+    case kArtNode16: {
+      hedger::ArtNode16 *n = (hedger::ArtNode16 *) node;
+      if (n->count < 16) {
+        int i = 0;
+        while (i < n->count && n->keys[i] < byte) {
+          i++;
+        }
+        memmove(&n->keys[i + 1], &n->keys[i], n->count - i);
+        memmove(&n->children[i + 1], &n->children[i], (n->count - i) * sizeof(hedger::ArtNode *));
+        n->keys[i] = byte;
+        n->children[i] = child;
+        n->count++;
+        return;
+      }
+      hedger::ArtNode48 *grown = (hedger::ArtNode48 *) NewNode(kArtNode48, n);
+      for (int i = 0; i < 16; i++) {
+        grown->childIndex[n->keys[i]] = (uint8_t) (i + 1);
+        grown->children[i] = n->children[i];
+      }
+      grown->count = 16;
+      FreeNode(n);
+      *ref = grown;
+      AddChild(ref, grown, byte, child);
+      return;
+    }
+    case kArtNode48: {
+      hedger::ArtNode48 *n = (hedger::ArtNode48 *) node;
+      if (n->count < 48) {
+        int slot = 0;
+        while (n->children[slot]) {
+          slot++;
+        }
+        n->children[slot] = child;
+        n->childIndex[byte] = (uint8_t) (slot + 1);
+        n->count++;
+        return;
+      }
+      hedger::ArtNode256 *grown = (hedger::ArtNode256 *) NewNode(kArtNode256, n);
+      for (int b = 0; b < 256; b++) {
+        if (n->childIndex[b]) {
+          grown->children[b] = n->children[n->childIndex[b] - 1];
+        }
+      }
+      grown->count = 48;
+      FreeNode(n);
+      *ref = grown;
+      AddChild(ref, grown, byte, child);
+      return;
+    }
+    default: {
+      hedger::ArtNode256 *n = (hedger::ArtNode256 *) node;
+      n->children[byte] = child;
+      n->count++;
+      return;
+    }
+  }
+}
+
+// RemoveChild
+//
+// Remove the child under a key byte, shrinking the node to the next
+// smaller type once it is sparse enough.  A Node4 left with one child
+// is replaced by that child, whose prefix absorbs the node's path.
+//
+// Entry: pointer to the slot holding node
+//        pointer to inner node
+//        key byte
+void ArtTree::RemoveChild(hedger::ArtNode **ref, hedger::ArtNode *node, uint8_t byte)
+{
+  switch (node->type) {
+    case kArtNode4: {
+      hedger::ArtNode4 *n = (hedger::ArtNode4 *) node;
+      int i = 0;
+      while (n->keys[i] != byte) {
+        i++;
+      }
+      memmove(&n->keys[i], &n->keys[i + 1], n->count - i - 1);
+      memmove(&n->children[i], &n->children[i + 1], (n->count - i - 1) * sizeof(hedger::ArtNode *));
+      n->count--;
+      if (1 == n->count) {
+        hedger::ArtNode *only = n->children[0];
+        if (!IsLeaf(only)) {
+          uint8_t prefix[kArtKeyLen];
+          int len = n->prefixLen;
+          memcpy(prefix, n->prefix, len);
+          prefix[len++] = n->keys[0];
+          memcpy(&prefix[len], only->prefix, only->prefixLen);
+          len += only->prefixLen;
+          memcpy(only->prefix, prefix, len);
+          only->prefixLen = (uint8_t) len;
+        }
+        FreeNode(n);
+        *ref = only;
+      }
+      return;
+    }
+    case kArtNode16: {
+      hedger::ArtNode16 *n = (hedger::ArtNode16 *) node;
+      int i = 0;
+      while (n->keys[i] != byte) {
+        i++;
+      }
+      memmove(&n->keys[i], &n->keys[i + 1], n->count - i - 1);
+      memmove(&n->children[i], &n->children[i + 1], (n->count - i - 1) * sizeof(hedger::ArtNode *));
+      n->count--;
+      if (3 == n->count) {
+        hedger::ArtNode4 *shrunk = (hedger::ArtNode4 *) NewNode(kArtNode4, n);
+        memcpy(shrunk->keys, n->keys, 3);
+        memcpy(shrunk->children, n->children, 3 * sizeof(hedger::ArtNode *));
+        shrunk->count = 3;
+        FreeNode(n);
+        *ref = shrunk;
+      }
+      return;
+    }
+    case kArtNode48: {
+      hedger::ArtNode48 *n = (hedger::ArtNode48 *) node;
+      n->children[n->childIndex[byte] - 1] = nullptr;
+      n->childIndex[byte] = 0;
+      n->count--;
+      if (12 == n->count) {
+        hedger::ArtNode16 *shrunk = (hedger::ArtNode16 *) NewNode(kArtNode16, n);
+        int i = 0;
+        for (int b = 0; b < 256; b++) {
+          if (n->childIndex[b]) {
+            shrunk->keys[i] = (uint8_t) b;
+            shrunk->children[i] = n->children[n->childIndex[b] - 1];
+            i++;
+          }
+        }
+        shrunk->count = 12;
+        FreeNode(n);
+        *ref = shrunk;
+      }
+      return;
+    }
+    default: {
+      hedger::ArtNode256 *n = (hedger::ArtNode256 *) node;
+      n->children[byte] = nullptr;
+      n->count--;
+      if (37 == n->count) {
+        hedger::ArtNode48 *shrunk = (hedger::ArtNode48 *) NewNode(kArtNode48, n);
+        int slot = 0;
+        for (int b = 0; b < 256; b++) {
+          if (n->children[b]) {
+            shrunk->children[slot] = n->children[b];
+            shrunk->childIndex[b] = (uint8_t) (slot + 1);
+            slot++;
+          }
+        }
+        shrunk->count = 37;
+        FreeNode(n);
+        *ref = shrunk;
+      }
+      return;
+    }
+  }
+}
+
+//
+// Helper functions
+//
+
+// NewNode
+// Allocate a zeroed inner node, copying the compressed path of header.
+// Entry: node type
+//        node whose prefix to copy, or nullptr
+// Exit:  pointer to node
+hedger::ArtNode *ArtTree::NewNode(ArtNodeType type, const hedger::ArtNode *header)
+{
+  hedger::ArtNode *node;
+  switch (type) {
+    case kArtNode4:
+      node = new hedger::ArtNode4();
+      bytes_ += sizeof(hedger::ArtNode4);
+      break;
+    case kArtNode16:
+      node = new hedger::ArtNode16();
+      bytes_ += sizeof(hedger::ArtNode16);
+      break;
+    case kArtNode48:
+      node = new hedger::ArtNode48();
+      bytes_ += sizeof(hedger::ArtNode48);
+      break;
+    default:
+      node = new hedger::ArtNode256();
+      bytes_ += sizeof(hedger::ArtNode256);
+      break;
+  }
+  node->type = (uint8_t) type;
+  if (header) {
+    node->prefixLen = header->prefixLen;
+    memcpy(node->prefix, header->prefix, header->prefixLen);
+  }
+  return node;
+}
+
+// FreeNode
+// Entry: pointer to inner node
+void ArtTree::FreeNode(hedger::ArtNode *node)
+{
+  switch (node->type) {
+    case kArtNode4:
+      bytes_ -= sizeof(hedger::ArtNode4);
+      delete (hedger::ArtNode4 *) node;
+      break;
+    case kArtNode16:
+      bytes_ -= sizeof(hedger::ArtNode16);
+      delete (hedger::ArtNode16 *) node;
+      break;
+    case kArtNode48:
+      bytes_ -= sizeof(hedger::ArtNode48);
+      delete (hedger::ArtNode48 *) node;
+      break;
+    default:
+      bytes_ -= sizeof(hedger::ArtNode256);
+      delete (hedger::ArtNode256 *) node;
+      break;
+  }
+}
+
+// DeleteRecursive
+// Free the whole subtree under and including node.
+// Entry: pointer to node or leaf
+void ArtTree::DeleteRecursive(hedger::ArtNode *node)
+{
+  if (!node || IsLeaf(node)) {
+    return;
+  }
+  switch (node->type) {
+    case kArtNode4: {
+      hedger::ArtNode4 *n = (hedger::ArtNode4 *) node;
+      for (int i = 0; i < n->count; i++) {
+        DeleteRecursive(n->children[i]);
+      }
+      break;
+    }
+    case kArtNode16: {
+      hedger::ArtNode16 *n = (hedger::ArtNode16 *) node;
+      for (int i = 0; i < n->count; i++) {
+        DeleteRecursive(n->children[i]);
+      }
+      break;
+    }
+    case kArtNode48: {
+      hedger::ArtNode48 *n = (hedger::ArtNode48 *) node;
+      for (int i = 0; i < 48; i++) {
+        DeleteRecursive(n->children[i]);
+      }
+      break;
+    }
+    default: {
+      hedger::ArtNode256 *n = (hedger::ArtNode256 *) node;
+      for (int i = 0; i < 256; i++) {
+        DeleteRecursive(n->children[i]);
+      }
+      break;
+    }
+  }
+  FreeNode(node);
+}
+} // namespace hedger
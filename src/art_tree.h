@@ -0,0 +1,114 @@
+// art_tree.h
+//
+// Implements an Adaptive Radix Tree (ART) over the bytes of S_T keys.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef ART_TREE_H_
+#define ART_TREE_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Bytes in a radix key
+const int kArtKeyLen = sizeof(hedger::S_T);
+
+enum ArtNodeType
+{
+  kArtNode4,
+  kArtNode16,
+  kArtNode48,
+  kArtNode256
+};
+
+// ArtNode
+//
+// Header common to all inner node types.  Path compression stores the
+// whole compressed prefix in the node; keys are only kArtKeyLen bytes, so
+// it always fits.
+//
+// Leaves are not allocated: a child pointer with the low bit set carries
+// the key itself (lazy expansion with single-value leaves).
+struct ArtNode
+{
+  uint8_t             type;                   // ArtNodeType
+  uint8_t             prefixLen;              // compressed path length
+  uint16_t            count;                  // children in use
+  uint8_t             prefix[kArtKeyLen];     // compressed path bytes
+};
+
+// ArtNode4: up to 4 children, keys sorted
+struct ArtNode4 : public ArtNode
+{
+  uint8_t             keys[4];
+  hedger::ArtNode *   children[4];
+};
+
+// ArtNode16: up to 16 children, keys sorted and searched with SIMD
+struct ArtNode16 : public ArtNode
+{
+  uint8_t             keys[16];
+  hedger::ArtNode *   children[16];
+};
+
+// ArtNode48: up to 48 children, indexed through a 256-entry byte map
+struct ArtNode48 : public ArtNode
+{
+  uint8_t             childIndex[256];        // slot + 1, 0 == empty
+  hedger::ArtNode *   children[48];
+};
+
+// ArtNode256: one child slot per byte value
+struct ArtNode256 : public ArtNode
+{
+  hedger::ArtNode *   children[256];
+};
+
+class ArtTree
+{
+ public:
+  ArtTree();
+  virtual ~ArtTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  int Size() { return nodeTot_; }
+  std::size_t MemoryUsage() { return bytes_; }
+
+ protected:
+  bool AddRecurse(hedger::ArtNode **ref, const uint8_t *bytes, hedger::S_T key, int depth);
+  bool DeleteRecurse(hedger::ArtNode **ref, const uint8_t *bytes, hedger::S_T key, int depth);
+  hedger::ArtNode **FindChild(hedger::ArtNode *node, uint8_t byte);
+  void AddChild(hedger::ArtNode **ref, hedger::ArtNode *node, uint8_t byte, hedger::ArtNode *child);
+  void RemoveChild(hedger::ArtNode **ref, hedger::ArtNode *node, uint8_t byte);
+  hedger::ArtNode *NewNode(ArtNodeType type, const hedger::ArtNode *header);
+  void FreeNode(hedger::ArtNode *node);
+  void DeleteRecursive(hedger::ArtNode *node);
+
+  hedger::ArtNode *   root_;
+  int                 nodeTot_;
+  std::size_t         bytes_;
+};
+} // namespace hedger
+#endif // #ifndef ART_TREE_H_
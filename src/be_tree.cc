@@ -0,0 +1,390 @@
+// be_tree.cc
+//
+// Implements a write-optimized B^epsilon-tree with buffered inner nodes.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <algorithm>
+
+#include "be_tree.h"
+
+namespace hedger
+{
+// MessageKeyLess
+// Order a message against a bare key for binary searches.
+static bool MessageKeyLess(const hedger::BeMessage &a, hedger::S_T key)
+{
+  return a.key < key;
+}
+
+// Constructor
+BeTree::BeTree()
+{
+  root_ = nullptr;
+  updateTot_ = 0;
+  writeTot_ = 0;
+}
+
+// Destructor
+BeTree::~BeTree()
+{
+  DeleteRecursive(root_);
+}
+
+// Add
+// Queue an insert of key.
+// Entry: key
+void BeTree::Add(hedger::S_T key)
+{
+  Upsert(key, true);
+}
+
+// DeleteKey
+// Queue a delete of key.
+// Entry: key
+void BeTree::DeleteKey(hedger::S_T key)
+{
+  Upsert(key, false);
+}
+
+// Upsert
+//
+// Push one message in at the root, growing the tree while the root
+// splits and shrinking it while the root is an empty pass-through.
+//
+// Entry: key
+//        true == insert, false == delete
+void BeTree::Upsert(hedger::S_T key, bool insert)
+{
+  updateTot_++;
+  if (!root_) {
+    root_ = new hedger::BeLeaf();
+  }
+
+  std::vector<hedger::BeMessage> batch(1);
+  batch[0].key = key;
+  batch[0].insert = insert;
+  std::vector<hedger::BeSplit> splits;
+  Push(root_, batch, &splits);
+
+  while (!splits.empty()) {
+    hedger::BeInner *root = new hedger::BeInner();
+    root->children.push_back(root_);
+    for (const hedger::BeSplit &split : splits) {
+      root->pivots.push_back(split.pivot);
+      root->children.push_back(split.node);
+    }
+    root_ = root;
+    splits.clear();
+    if (root->children.size() > (std::size_t) kBeFanout) {
+      SplitInner(root, &splits);
+    }
+  }
+
+  while (!root_->leaf) {
+    hedger::BeInner *root = (hedger::BeInner *) root_;
+    if (root->children.size() > 1 || !root->buffer.empty()) {
+      break;
+    }
+    root_ = root->children[0];
+    root->children.clear();
+    delete root;
+  }
+}
+
+// Push
+//
+// Deliver a sorted batch of messages to a node.  A leaf applies them;
+// an inner node buffers them and flushes its busiest child until the
+// buffer is below capacity again.
+//
+// Entry: pointer to node
+//        sorted messages, one per key; consumed
+//        pointer to list receiving new right siblings of node
+void BeTree::Push(hedger::BeNode *node, std::vector<hedger::BeMessage> &batch,
+  std::vector<hedger::BeSplit> *splits)
+{
+  if (node->leaf) {
+    ApplyToLeaf((hedger::BeLeaf *) node, batch, splits);
+    return;
+  }
+
+  hedger::BeInner *inner = (hedger::BeInner *) node;
+  writeTot_ += batch.size();
+  if (1 == batch.size()) {
+    auto it = std::lower_bound(inner->buffer.begin(), inner->buffer.end(), batch[0].key,
+      MessageKeyLess);
+    if (it != inner->buffer.end() && it->key == batch[0].key) {
+      *it = batch[0];             // newer message wins
+    } else {
+      inner->buffer.insert(it, batch[0]);
+    }
+  } else {
+    std::vector<hedger::BeMessage> merged;
+    merged.reserve(inner->buffer.size() + batch.size());
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < inner->buffer.size() || j < batch.size()) {
+      if (j == batch.size() || (i < inner->buffer.size() && inner->buffer[i].key < batch[j].key)) {
+        merged.push_back(inner->buffer[i++]);
+      } else {
+        if (i < inner->buffer.size() && inner->buffer[i].key == batch[j].key) {
+          i++;                    // newer message wins
+        }
+        merged.push_back(batch[j++]);
+      }
+    }
+    inner->buffer.swap(merged);
+  }
+
+  while (inner->buffer.size() >= (std::size_t) kBeBufferTot) {
+    FlushBusiestChild(inner);
+  }
+  if (inner->children.size() > (std::size_t) kBeFanout) {
+    SplitInner(inner, splits);
+  }
+}
+
+// FlushBusiestChild
+//
+// Move every buffered message bound for the child with the most of them
+// down into that child, then splice in any siblings it split into, or
+// drop it if it was a leaf that is now empty.
+//
+// Entry: pointer to inner node
+void BeTree::FlushBusiestChild(hedger::BeInner *inner)
+{
+  std::size_t childTot = inner->children.size();
+  std::size_t best = 0;
+  std::size_t bestLo = 0;
+  std::size_t bestHi = 0;
+  std::size_t lo = 0;
+  for (std::size_t i = 0; i < childTot; i++) {
+    std::size_t hi = inner->buffer.size();
+    if (i + 1 < childTot) {
+      hi = std::lower_bound(inner->buffer.begin() + lo, inner->buffer.end(), inner->pivots[i],
+        MessageKeyLess) - inner->buffer.begin();
+    }
+    if (hi - lo > bestHi - bestLo) {
+      best = i;
+      bestLo = lo;
+      bestHi = hi;
+    }
+    lo = hi;
+  }
+
+  std::vector<hedger::BeMessage> batch(inner->buffer.begin() + bestLo,
+    inner->buffer.begin() + bestHi);
+  inner->buffer.erase(inner->buffer.begin() + bestLo, inner->buffer.begin() + bestHi);
+
+  hedger::BeNode *child = inner->children[best];
+  std::vector<hedger::BeSplit> childSplits;
+  Push(child, batch, &childSplits);
+
+  for (std::size_t i = 0; i < childSplits.size(); i++) {
+    inner->pivots.insert(inner->pivots.begin() + best + i, childSplits[i].pivot);
+    inner->children.insert(inner->children.begin() + best + 1 + i, childSplits[i].node);
+  }
+
+  if (child->leaf && ((hedger::BeLeaf *) child)->keys.empty() && inner->children.size() > 1) {
+    delete child;
+    inner->children.erase(inner->children.begin() + best);
+    inner->pivots.erase(inner->pivots.begin() + (best ? best - 1 : 0));
+  }
+}
+
+// ApplyToLeaf
+//
+// Merge a batch of messages into a leaf, splitting it into as many
+// half-full leaves as needed.
+//
+// Entry: pointer to leaf
+//        sorted messages, one per key
+//        pointer to list receiving new right siblings of leaf
+void BeTree::ApplyToLeaf(hedger::BeLeaf *leaf, std::vector<hedger::BeMessage> &batch,
+  std::vector<hedger::BeSplit> *splits)
+{
+  std::vector<hedger::S_T> merged;
+  merged.reserve(leaf->keys.size() + batch.size());
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < leaf->keys.size() || j < batch.size()) {
+    if (j == batch.size() || (i < leaf->keys.size() && leaf->keys[i] < batch[j].key)) {
+      merged.push_back(leaf->keys[i++]);
+      continue;
+    }
+    bool present = i < leaf->keys.size() && leaf->keys[i] == batch[j].key;
+    if (batch[j].insert) {
+      merged.push_back(batch[j].key);
+      if (!present) {
+        writeTot_++;
+      }
+    }
+    if (present) {
+      i++;
+    }
+    j++;
+  }
+
+  std::size_t n = merged.size();
+  if (n <= (std::size_t) kBeLeafKeys) {
+    leaf->keys.swap(merged);
+    return;
+  }
+
+  std::size_t half = kBeLeafKeys / 2;
+  std::size_t pieces = (n + half - 1) / half;
+  std::size_t start = 0;
+  for (std::size_t p = 0; p < pieces; p++) {
+    std::size_t size = n / pieces + (p < n % pieces ? 1 : 0);
+    if (0 == p) {
+      leaf->keys.assign(merged.begin(), merged.begin() + size);
+    } else {
+      hedger::BeLeaf *sibling = new hedger::BeLeaf();
+      sibling->keys.assign(merged.begin() + start, merged.begin() + start + size);
+      hedger::BeSplit split;
+      split.pivot = merged[start];
+      split.node = sibling;
+      splits->push_back(split);
+      writeTot_ += size;
+    }
+    start += size;
+  }
+}
+
+// SplitInner
+//
+// Split an inner node with too many children into half-full siblings,
+// dividing its buffer along the new pivots.
+//
+// Entry: pointer to inner node
+//        pointer to list receiving new right siblings
+void BeTree::SplitInner(hedger::BeInner *inner, std::vector<hedger::BeSplit> *splits)
+{
+  std::size_t childTot = inner->children.size();
+  std::size_t half = kBeFanout / 2;
+  std::size_t pieces = (childTot + half - 1) / half;
+  std::size_t firstTot = childTot / pieces + (0 < childTot % pieces ? 1 : 0);
+
+  std::size_t start = firstTot;
+  for (std::size_t p = 1; p < pieces; p++) {
+    std::size_t size = childTot / pieces + (p < childTot % pieces ? 1 : 0);
+    hedger::BeInner *sibling = new hedger::BeInner();
+    hedger::S_T pivot = inner->pivots[start - 1];
+    sibling->children.assign(inner->children.begin() + start, inner->children.begin() + start + size);
+    sibling->pivots.assign(inner->pivots.begin() + start, inner->pivots.begin() + start + size - 1);
+
+    auto lo = std::lower_bound(inner->buffer.begin(), inner->buffer.end(), pivot, MessageKeyLess);
+    auto hi = inner->buffer.end();
+    if (start + size < childTot) {
+      hi = std::lower_bound(lo, inner->buffer.end(), inner->pivots[start + size - 1], MessageKeyLess);
+    }
+    sibling->buffer.assign(lo, hi);
+    writeTot_ += sibling->buffer.size();
+
+    hedger::BeSplit split;
+    split.pivot = pivot;
+    split.node = sibling;
+    splits->push_back(split);
+    start += size;
+  }
+
+  hedger::S_T firstPivot = inner->pivots[firstTot - 1];
+  inner->children.resize(firstTot);
+  inner->pivots.resize(firstTot - 1);
+  inner->buffer.erase(std::lower_bound(inner->buffer.begin(), inner->buffer.end(), firstPivot,
+    MessageKeyLess), inner->buffer.end());
+}
+
+// Find
+//
+// The newest message for key is the first one met on the way down.
+//
+// Entry: key
+// Exit:  true == key present
+bool BeTree::Find(hedger::S_T key)
+{
+  hedger::BeNode *node = root_;
+  while (node && !node->leaf) {
+    hedger::BeInner *inner = (hedger::BeInner *) node;
+    auto it = std::lower_bound(inner->buffer.begin(), inner->buffer.end(), key, MessageKeyLess);
+    if (it != inner->buffer.end() && it->key == key) {
+      return it->insert;
+    }
+    std::size_t i = std::upper_bound(inner->pivots.begin(), inner->pivots.end(), key)
+      - inner->pivots.begin();
+    node = inner->children[i];
+  }
+  if (!node) {
+    return false;
+  }
+  hedger::BeLeaf *leaf = (hedger::BeLeaf *) node;
+  return std::binary_search(leaf->keys.begin(), leaf->keys.end(), key);
+}
+
+// MemoryUsage
+//
+// Exit: bytes held by nodes, their keys and their buffers
+std::size_t BeTree::MemoryUsage()
+{
+  return MemoryRecurse(root_);
+}
+
+//
+// Helper functions
+//
+
+// MemoryRecurse
+// Entry: pointer to node
+// Exit:  bytes held by the subtree
+std::size_t BeTree::MemoryRecurse(hedger::BeNode *node)
+{
+  if (!node) {
+    return 0;
+  }
+  if (node->leaf) {
+    hedger::BeLeaf *leaf = (hedger::BeLeaf *) node;
+    return sizeof(hedger::BeLeaf) + leaf->keys.capacity() * sizeof(hedger::S_T);
+  }
+  hedger::BeInner *inner = (hedger::BeInner *) node;
+  std::size_t bytes = sizeof(hedger::BeInner)
+    + inner->pivots.capacity() * sizeof(hedger::S_T)
+    + inner->children.capacity() * sizeof(hedger::BeNode *)
+    + inner->buffer.capacity() * sizeof(hedger::BeMessage);
+  for (hedger::BeNode *child : inner->children) {
+    bytes += MemoryRecurse(child);
+  }
+  return bytes;
+}
+
+// DeleteRecursive
+// Delete the whole subtree under and including node.
+// Entry: pointer to node
+void BeTree::DeleteRecursive(hedger::BeNode *node)
+{
+  if (node) {
+    if (!node->leaf) {
+      for (hedger::BeNode *child : ((hedger::BeInner *) node)->children) {
+        DeleteRecursive(child);
+      }
+    }
+    delete node;
+  }
+}
+} // namespace hedger
@@ -0,0 +1,118 @@
+// be_tree.h
+//
+// Implements a write-optimized B^epsilon-tree with buffered inner nodes.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef BE_TREE_H_
+#define BE_TREE_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Node shape: a few pivots (B^epsilon) and a large message buffer
+// (B - B^epsilon) per inner node.
+const int kBeFanout = 16;           // children per inner node
+const int kBeBufferTot = 512;       // messages buffered before a flush
+const int kBeLeafKeys = 256;        // keys per leaf
+
+// BeMessage: a pending insert or delete of one key
+struct BeMessage
+{
+  hedger::S_T         key;
+  bool                insert;       // true == insert, false == delete
+};
+
+struct BeNode
+{
+  BeNode(bool isLeaf) { leaf = isLeaf; }
+  virtual ~BeNode() {};
+
+  bool                leaf;
+};
+
+struct BeLeaf : public BeNode
+{
+  BeLeaf() : BeNode(true) {}
+
+  std::vector<hedger::S_T>          keys;       // sorted
+};
+
+// BeInner
+//
+// Child i holds keys k with pivots[i - 1] <= k < pivots[i].  Messages
+// for any of those keys wait in buffer, sorted by key, newest winning.
+struct BeInner : public BeNode
+{
+  BeInner() : BeNode(false) {}
+
+  std::vector<hedger::S_T>          pivots;
+  std::vector<hedger::BeNode *>     children;
+  std::vector<hedger::BeMessage>    buffer;     // sorted, one per key
+};
+
+// BeSplit: a new right sibling and the smallest key it covers
+struct BeSplit
+{
+  hedger::S_T         pivot;
+  hedger::BeNode *    node;
+};
+
+// BeTree
+//
+// Add and DeleteKey are blind: they append a message to the root buffer
+// and return without looking for the key.  When a buffer fills, the
+// messages bound for its busiest child move down in one batch, so each
+// descent's cache misses are shared by the whole batch.  Find checks the
+// buffers on its path before the leaf.
+class BeTree
+{
+ public:
+  BeTree();
+  virtual ~BeTree();
+
+  void Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  void DeleteKey(hedger::S_T key);
+  std::size_t MemoryUsage();
+
+  // Keys and messages written into node storage per update
+  double WriteAmplification() { return updateTot_ ? (double) writeTot_ / updateTot_ : 0.0; }
+
+ protected:
+  void Upsert(hedger::S_T key, bool insert);
+  void Push(hedger::BeNode *node, std::vector<hedger::BeMessage> &batch,
+    std::vector<hedger::BeSplit> *splits);
+  void ApplyToLeaf(hedger::BeLeaf *leaf, std::vector<hedger::BeMessage> &batch,
+    std::vector<hedger::BeSplit> *splits);
+  void FlushBusiestChild(hedger::BeInner *inner);
+  void SplitInner(hedger::BeInner *inner, std::vector<hedger::BeSplit> *splits);
+  std::size_t MemoryRecurse(hedger::BeNode *node);
+  void DeleteRecursive(hedger::BeNode *node);
+
+  hedger::BeNode *    root_;
+  std::size_t         updateTot_;   // Add and DeleteKey calls
+  std::size_t         writeTot_;    // keys and messages written to nodes
+};
+} // namespace hedger
+#endif // #ifndef BE_TREE_H_
@@ -0,0 +1,497 @@
+// bplus_tree.cc
+//
+// Implements an in-memory B+tree with cache-line-sized key blocks and
+// SIMD intra-node search.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "bplus_tree.h"
+
+namespace hedger
+{
+static_assert(kBPlusKeys == 16, "SIMD node search assumes 16 keys per node");
+// The kernels read all 16 key slots; an inner node's run past its
+// separators into its children, still inside the node.
+static_assert(offsetof(hedger::BPlusInner, keys) + kBPlusKeys * sizeof(hedger::S_T) <=
+  sizeof(hedger::BPlusInner), "inner node too small for the search kernels");
+static_assert(sizeof(hedger::BPlusInner) == 2 * kCacheLine, "inner node must be 128 bytes");
+
+// Constructor
+BPlusTree::BPlusTree()
+{
+  root_ = nullptr;
+  height_ = 0;
+  keyTot_ = 0;
+  leafTot_ = 0;
+  innerTot_ = 0;
+}
+
+// Destructor
+BPlusTree::~BPlusTree()
+{
+  DeleteRecursive(root_, height_);
+}
+
+// CountLess
+//
+// Count the keys in a node block that are strictly less than key, which
+// is the lower-bound position of key.  All kBPlusKeys slots are compared
+// at once and the slots past count are masked off afterwards.
+//
+// Entry: pointer to key block of kBPlusKeys keys
+//        keys in use
+//        search key
+// Exit:  number of keys < key
+int BPlusTree::CountLess(const hedger::S_T *keys, int count, hedger::S_T key)
+{
+  unsigned int mask;
+#if defined(__AVX2__)
+  __m256i k = _mm256_set1_epi32(key);
+  __m256i lo = _mm256_loadu_si256((const __m256i *) keys);
+  __m256i hi = _mm256_loadu_si256((const __m256i *) (keys + 8));
+  mask = (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, lo)));
+  mask |= (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, hi))) << 8;
+#elif defined(__SSE2__)
+  __m128i k = _mm_set1_epi32(key);
+  mask = 0;
+  for (int i = 0; i < kBPlusKeys; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *) (keys + i));
+    mask |= (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, v))) << i;
+  }
+#else
+  mask = 0;
+  for (int i = 0; i < kBPlusKeys; i++) {
+    mask |= (unsigned int) (keys[i] < key) << i;
+  }
+#endif
+  mask &= (1u << count) - 1;
+  return __builtin_popcount(mask);
+}
+
+// CountLessEqual
+//
+// Count the keys in a node block that are less than or equal to key,
+// which is the index of the child to descend into.
+//
+// Entry: pointer to key block of kBPlusKeys keys
+//        keys in use
+//        search key
+// Exit:  number of keys <= key
+int BPlusTree::CountLessEqual(const hedger::S_T *keys, int count, hedger::S_T key)
+{
+  unsigned int mask;
+#if defined(__AVX2__)
+  __m256i k = _mm256_set1_epi32(key);
+  __m256i lo = _mm256_loadu_si256((const __m256i *) keys);
+  __m256i hi = _mm256_loadu_si256((const __m256i *) (keys + 8));
+  mask = (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lo, k)));
+  mask |= (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(hi, k))) << 8;
+#elif defined(__SSE2__)
+  __m128i k = _mm_set1_epi32(key);
+  mask = 0;
+  for (int i = 0; i < kBPlusKeys; i += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *) (keys + i));
+    mask |= (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k))) << i;
+  }
+#else
+  mask = 0;
+  for (int i = 0; i < kBPlusKeys; i++) {
+    mask |= (unsigned int) (keys[i] > key) << i;
+  }
+#endif
+  // mask holds the keys > key; invert it within the keys in use
+  mask = ~mask & ((1u << count) - 1);
+  return __builtin_popcount(mask);
+}
+
+// Add
+//
+// Insert a key.  Splits propagate upward; a split root grows the tree
+// by one level.
+//
+// Entry: key
+// Exit:  true == inserted, false == key already present
+bool BPlusTree::Add(hedger::S_T key)
+{
+  if (nullptr == root_) {
+    root_ = NewLeaf();
+    height_ = 1;
+  }
+
+  hedger::S_T splitKey;
+  hedger::BPlusNode *splitNode = nullptr;
+  if (!AddRecurse(root_, height_, key, &splitKey, &splitNode)) {
+    return false;
+  }
+
+  if (splitNode) {
+    hedger::BPlusInner *root = NewInner();
+    root->keys[0] = splitKey;
+    root->count = 1;
+    root->children[0] = root_;
+    root->children[1] = splitNode;
+    root_ = root;
+    height_++;
+  }
+  keyTot_++;
+  return true;
+}
+
+// AddRecurse
+//
+// Internal recursion function for Add.  If node had to split, the new
+// right sibling and its separator key are handed back to the caller.
+//
+// Entry: pointer to node
+//        its level, leaves == 1
+//        key
+//        pointer to returned separator key
+//        pointer to returned right sibling, nullptr if no split
+// Exit:  true == inserted
+bool BPlusTree::AddRecurse(hedger::BPlusNode *node, int level, hedger::S_T key,
+  hedger::S_T *splitKey, hedger::BPlusNode **splitNode)
+{
+  *splitNode = nullptr;
+
+  if (1 == level) {
+    hedger::BPlusLeaf *leaf = (hedger::BPlusLeaf *) node;
+    int pos = CountLess(leaf->keys, leaf->count, key);
+    if (pos < leaf->count && leaf->keys[pos] == key) {
+      return false;             // duplicate keys disallowed
+    }
+
+    if (leaf->count < kBPlusKeys) {
+      memmove(&leaf->keys[pos + 1], &leaf->keys[pos], (leaf->count - pos) * sizeof(hedger::S_T));
+      leaf->keys[pos] = key;
+      leaf->count++;
+      return true;
+    }
+
+    // Full leaf: split the kBPlusKeys + 1 keys across two leaves.
+    hedger::S_T merged[kBPlusKeys + 1];
+    memcpy(merged, leaf->keys, pos * sizeof(hedger::S_T));
+    merged[pos] = key;
+    memcpy(&merged[pos + 1], &leaf->keys[pos], (kBPlusKeys - pos) * sizeof(hedger::S_T));
+
+    hedger::BPlusLeaf *right = NewLeaf();
+    int leftTot = (kBPlusKeys + 1) / 2;
+    int rightTot = kBPlusKeys + 1 - leftTot;
+    memcpy(leaf->keys, merged, leftTot * sizeof(hedger::S_T));
+    memcpy(right->keys, &merged[leftTot], rightTot * sizeof(hedger::S_T));
+    leaf->count = leftTot;
+    right->count = rightTot;
+
+    right->next = leaf->next;
+    right->prev = leaf;
+    if (leaf->next) {
+      leaf->next->prev = right;
+    }
+    leaf->next = right;
+
+    *splitKey = right->keys[0];
+    *splitNode = right;
+    return true;
+  }
+
+  hedger::BPlusInner *inner = (hedger::BPlusInner *) node;
+  int i = CountLessEqual(inner->keys, inner->count, key);
+  hedger::S_T childKey;
+  hedger::BPlusNode *childSplit;
+  if (!AddRecurse(inner->children[i], level - 1, key, &childKey, &childSplit)) {
+    return false;
+  }
+  if (!childSplit) {
+    return true;
+  }
+
+  if (inner->count < kBPlusInnerKeys) {
+    memmove(&inner->keys[i + 1], &inner->keys[i], (inner->count - i) * sizeof(hedger::S_T));
+    memmove(&inner->children[i + 2], &inner->children[i + 1],
+      (inner->count - i) * sizeof(hedger::BPlusNode *));
+    inner->keys[i] = childKey;
+    inner->children[i + 1] = childSplit;
+    inner->count++;
+    return true;
+  }
+
+  // Full inner node: the middle separator moves up to the caller.
+  hedger::S_T keys[kBPlusInnerKeys + 1];
+  hedger::BPlusNode *children[kBPlusInnerKeys + 2];
+  memcpy(keys, inner->keys, i * sizeof(hedger::S_T));
+  keys[i] = childKey;
+  memcpy(&keys[i + 1], &inner->keys[i], (kBPlusInnerKeys - i) * sizeof(hedger::S_T));
+  memcpy(children, inner->children, (i + 1) * sizeof(hedger::BPlusNode *));
+  children[i + 1] = childSplit;
+  memcpy(&children[i + 2], &inner->children[i + 1],
+    (kBPlusInnerKeys - i) * sizeof(hedger::BPlusNode *));
+
+  hedger::BPlusInner *right = NewInner();
+  int leftTot = kBPlusInnerKeys / 2;
+  int rightTot = kBPlusInnerKeys - leftTot;
+  memcpy(inner->keys, keys, leftTot * sizeof(hedger::S_T));
+  memcpy(inner->children, children, (leftTot + 1) * sizeof(hedger::BPlusNode *));
+  memcpy(right->keys, &keys[leftTot + 1], rightTot * sizeof(hedger::S_T));
+  memcpy(right->children, &children[leftTot + 1], (rightTot + 1) * sizeof(hedger::BPlusNode *));
+  inner->count = leftTot;
+  right->count = rightTot;
+
+  *splitKey = keys[leftTot];
+  *splitNode = right;
+  return true;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool BPlusTree::Find(hedger::S_T key)
+{
+  hedger::BPlusLeaf *leaf = FindLeaf(key);
+  if (!leaf) {
+    return false;
+  }
+  int pos = CountLess(leaf->keys, leaf->count, key);
+  return pos < leaf->count && leaf->keys[pos] == key;
+}
+
+// FindLeaf
+//
+// Descend to the leaf whose key range covers key.
+//
+// Entry: key
+// Exit:  pointer to leaf, or nullptr if the tree is empty
+hedger::BPlusLeaf *BPlusTree::FindLeaf(hedger::S_T key)
+{
+  hedger::BPlusNode *node = root_;
+  if (!node) {
+    return nullptr;
+  }
+  for (int level = height_; level > 1; level--) {
+    hedger::BPlusInner *inner = (hedger::BPlusInner *) node;
+    node = inner->children[CountLessEqual(inner->keys, inner->count, key)];
+  }
+  return (hedger::BPlusLeaf *) node;
+}
+
+// DeleteKey
+//
+// Remove a key.  Deletion is lazy: nodes are not merged when they run
+// under half full, but emptied nodes are unlinked and freed, and the
+// root collapses while it has a single child.
+//
+// Entry: key
+// Exit:  true == success
+bool BPlusTree::DeleteKey(hedger::S_T key)
+{
+  if (!root_) {
+    return false;
+  }
+
+  bool emptied = false;
+  if (!DeleteRecurse(root_, height_, key, &emptied)) {
+    return false;
+  }
+  keyTot_--;
+
+  if (emptied) {
+    FreeNode(root_, height_);
+    root_ = nullptr;
+    height_ = 0;
+    return true;
+  }
+  while (height_ > 1 && 0 == ((hedger::BPlusInner *) root_)->count) {
+    hedger::BPlusNode *child = ((hedger::BPlusInner *) root_)->children[0];
+    FreeNode(root_, height_);
+    root_ = child;
+    height_--;
+  }
+  return true;
+}
+
+// DeleteRecurse
+//
+// Internal recursion function for DeleteKey.
+//
+// Entry: pointer to node
+//        its level, leaves == 1
+//        key
+//        pointer to flag set when node has become empty
+// Exit:  true == key was found and removed
+bool BPlusTree::DeleteRecurse(hedger::BPlusNode *node, int level, hedger::S_T key, bool *emptied)
+{
+  *emptied = false;
+
+  if (1 == level) {
+    hedger::BPlusLeaf *leaf = (hedger::BPlusLeaf *) node;
+    int pos = CountLess(leaf->keys, leaf->count, key);
+    if (pos >= leaf->count || leaf->keys[pos] != key) {
+      return false;
+    }
+    memmove(&leaf->keys[pos], &leaf->keys[pos + 1], (leaf->count - pos - 1) * sizeof(hedger::S_T));
+    leaf->count--;
+    if (0 == leaf->count) {
+      if (leaf->prev) {
+        leaf->prev->next = leaf->next;
+      }
+      if (leaf->next) {
+        leaf->next->prev = leaf->prev;
+      }
+      *emptied = true;
+    }
+    return true;
+  }
+
+  hedger::BPlusInner *inner = (hedger::BPlusInner *) node;
+  int i = CountLessEqual(inner->keys, inner->count, key);
+  bool childEmptied;
+  if (!DeleteRecurse(inner->children[i], level - 1, key, &childEmptied)) {
+    return false;
+  }
+  if (!childEmptied) {
+    return true;
+  }
+
+  FreeNode(inner->children[i], level - 1);
+  if (0 == inner->count) {
+    *emptied = true;
+    return true;
+  }
+
+  // Drop the child together with the separator bounding it; its range
+  // folds into the neighbouring child.
+  int k = i ? i - 1 : 0;
+  memmove(&inner->keys[k], &inner->keys[k + 1], (inner->count - k - 1) * sizeof(hedger::S_T));
+  memmove(&inner->children[i], &inner->children[i + 1],
+    (inner->count - i) * sizeof(hedger::BPlusNode *));
+  inner->count--;
+  return true;
+}
+
+// RangeScan
+//
+// Copy the keys in [lo, hi] into out, in order, by walking the leaf chain.
+//
+// Entry: lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr to only count
+//        maximum number of keys to return
+// Exit:  number of keys returned
+std::size_t BPlusTree::RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max)
+{
+  std::size_t n = 0;
+  hedger::BPlusLeaf *leaf = FindLeaf(lo);
+  if (!leaf) {
+    return 0;
+  }
+  int pos = CountLess(leaf->keys, leaf->count, lo);
+  while (leaf && n < max) {
+    for (; pos < leaf->count && n < max; pos++) {
+      if (leaf->keys[pos] > hi) {
+        return n;
+      }
+      if (out) {
+        out[n] = leaf->keys[pos];
+      }
+      n++;
+    }
+    leaf = leaf->next;
+    pos = 0;
+  }
+  return n;
+}
+
+// MemoryUsage
+//
+// Exit: bytes held by nodes
+std::size_t BPlusTree::MemoryUsage()
+{
+  return leafTot_ * sizeof(hedger::BPlusLeaf) + innerTot_ * sizeof(hedger::BPlusInner);
+}
+
+//
+// Helper functions
+//
+
+// NewLeaf
+// Allocate a zeroed, cache-line-aligned leaf.
+// Exit: pointer to leaf
+hedger::BPlusLeaf *BPlusTree::NewLeaf()
+{
+  void *mem = nullptr;
+  if (posix_memalign(&mem, kCacheLine, sizeof(hedger::BPlusLeaf))) {
+    throw std::bad_alloc();
+  }
+  hedger::BPlusLeaf *leaf = new (mem) hedger::BPlusLeaf();
+  leafTot_++;
+  return leaf;
+}
+
+// NewInner
+// Allocate a zeroed, cache-line-aligned inner node.
+// Exit: pointer to inner node
+hedger::BPlusInner *BPlusTree::NewInner()
+{
+  void *mem = nullptr;
+  if (posix_memalign(&mem, kCacheLine, sizeof(hedger::BPlusInner))) {
+    throw std::bad_alloc();
+  }
+  hedger::BPlusInner *inner = new (mem) hedger::BPlusInner();
+  innerTot_++;
+  return inner;
+}
+
+// FreeNode
+// Entry: pointer to leaf or inner node
+//        its level, leaves == 1
+void BPlusTree::FreeNode(hedger::BPlusNode *node, int level)
+{
+  if (1 == level) {
+    leafTot_--;
+  } else {
+    innerTot_--;
+  }
+  free(node);
+}
+
+// DeleteRecursive
+// Free the whole subtree under and including node.
+// Entry: pointer to node
+//        its level, leaves == 1
+void BPlusTree::DeleteRecursive(hedger::BPlusNode *node, int level)
+{
+  if (node) {
+    if (level > 1) {
+      hedger::BPlusInner *inner = (hedger::BPlusInner *) node;
+      for (int i = 0; i <= inner->count; i++) {
+        DeleteRecursive(inner->children[i], level - 1);
+      }
+    }
+    FreeNode(node, level);
+  }
+}
+} // namespace hedger
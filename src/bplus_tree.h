@@ -0,0 +1,109 @@
+// bplus_tree.h
+//
+// Implements an in-memory B+tree with cache-line-sized key blocks and
+// SIMD intra-node search.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef BPLUS_TREE_H_
+#define BPLUS_TREE_H_
+
+#include <stdint.h>
+
+#include <cstddef>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Keys per leaf: 16 S_T keys fill exactly one 64-byte cache line.
+const int kBPlusKeys = 16;
+
+// Separators per inner node: with their ten child pointers and the
+// count, nine fill a 128-byte node.
+const int kBPlusInnerKeys = 9;
+
+// BPlusNode
+//
+// Base for leaves and inner nodes.  Which one a node is follows from its
+// level, leaves being level 1, so nodes carry no flag.
+struct BPlusNode
+{
+};
+
+// BPlusLeaf
+//
+// Leaves hold the keys themselves and are doubly linked for range scans.
+// The key block comes first so that a search touches a single cache
+// line.
+struct alignas(kCacheLine) BPlusLeaf : public BPlusNode
+{
+  hedger::S_T         keys[kBPlusKeys];   // sorted keys, one cache line
+  int                 count;              // keys in use
+  BPlusLeaf *         prev;               // leaf holding smaller keys
+  BPlusLeaf *         next;               // leaf holding larger keys
+};
+
+// BPlusInner
+//
+// Inner nodes hold count separators and count + 1 children in one
+// 128-byte node, two cache lines the adjacent-line prefetcher fetches
+// together.  Child i holds keys k with keys[i - 1] <= k < keys[i].
+struct alignas(kCacheLine) BPlusInner : public BPlusNode
+{
+  int32_t             count;              // separators in use
+  hedger::S_T         keys[kBPlusInnerKeys];
+  BPlusNode *         children[kBPlusInnerKeys + 1];
+};
+
+class BPlusTree
+{
+ public:
+  BPlusTree();
+  virtual ~BPlusTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max);
+  int Height() { return height_; }
+  int Size() { return keyTot_; }
+  std::size_t MemoryUsage();
+
+  static int CountLess(const hedger::S_T *keys, int count, hedger::S_T key);
+  static int CountLessEqual(const hedger::S_T *keys, int count, hedger::S_T key);
+
+ protected:
+  hedger::BPlusLeaf *FindLeaf(hedger::S_T key);
+  bool AddRecurse(hedger::BPlusNode *node, int level, hedger::S_T key,
+    hedger::S_T *splitKey, hedger::BPlusNode **splitNode);
+  bool DeleteRecurse(hedger::BPlusNode *node, int level, hedger::S_T key, bool *emptied);
+  void DeleteRecursive(hedger::BPlusNode *node, int level);
+  hedger::BPlusLeaf *NewLeaf();
+  hedger::BPlusInner *NewInner();
+  void FreeNode(hedger::BPlusNode *node, int level);
+
+  hedger::BPlusNode * root_;
+  int                 height_;
+  int                 keyTot_;
+  std::size_t         leafTot_;
+  std::size_t         innerTot_;
+};
+} // namespace hedger
+#endif // #ifndef BPLUS_TREE_H_
@@ -20,7 +20,10 @@
 // Copyright (C) 2018 Gregory Hedger
 //
 
+#include <stdlib.h>
+
 #include "bstree.h"
+#include "eytzinger_index.h"
 #include "stdio.h"
 
 namespace hedger
@@ -38,8 +41,8 @@ BSTree::BSTree()
 // Destructor
 BSTree::~BSTree()
 {
-  // TODO: Delete all nodes
   DeleteRecursive(root_);
+  FreeSlabs();
 }
 
 // DeleteRecursive
@@ -47,13 +50,39 @@ BSTree::~BSTree()
 // Entry: pointer to node
 void BSTree::DeleteRecursive(hedger::Node *node)
 {
-  if (node && node->data) {
+  if (node) {
     DeleteRecursive(node->left);
     DeleteRecursive(node->right);
     delete (int *) node->data;
     node->data = nullptr;
-    delete node;
+    FreeNode(node);
+  }
+}
+
+// FreeNode
+//
+// Release a node, unless it lives in a slab, which is released whole.
+// Slab nodes carry a flag, so no slab is searched.
+//
+// Entry: pointer to node
+void BSTree::FreeNode(hedger::Node *node)
+{
+  if (node->slab) {
+    node->~Node();
+    return;
+  }
+  delete node;
+}
+
+// FreeSlabs
+//
+// Release every slab.  None of their nodes may still be in the tree.
+void BSTree::FreeSlabs()
+{
+  for (const auto &slab : slabs_) {
+    free(slab.nodes);
   }
+  slabs_.clear();
 }
 
 // Add
@@ -66,53 +95,33 @@ void BSTree::DeleteRecursive(hedger::Node *node)
 // Exit:  -
 Node *BSTree::Add(hedger::S_T key, int *depth)
 {
-  hedger::Node *node = new hedger::Node(key);
-
   // Is this the first node in the tree? If so, we are done!
   if (nullptr == root_) {
-    root_ = node;
+    root_ = new hedger::Node(key);
     nodeTot_++;
-    *depth = 1;
-    return node;
-  }
-
-  // Find appropriate parent based on key.
-  Node *currentNode = root_;
-  Node *candidateParent = nullptr;
-  int currentDepth = 0;
-  while (currentNode != nullptr) {
-    candidateParent = currentNode;
-    if (node->key < currentNode->key) {
-      currentNode = currentNode->left;
-      currentDepth++;
-    } else {
-      currentNode = currentNode->right;
-      currentDepth++;
+    if (depth) {
+      *depth = 1;
     }
+    return root_;
   }
+  return AddBelow(root_, key, depth);
+}
 
-  // We are keeping the depth record for analysis
-  currentDepth++;
-  if(depth) {
-    *depth = currentDepth;
-  }
-
-  // Determine whether to add node at right or left of parent.
-  node->parent = candidateParent;
-  if (node->key < node->parent->key) {
-    node->parent->left = node;
-  } else {
-    node->parent->right = node;
+// Add
+//
+// Finger insert: start from a node returned earlier, climbing only as far
+// as the key requires, so a key near the hint costs O(log d) for a key d
+// positions away in a balanced tree.
+//
+// Entry: key
+//        hint node, or nullptr to start at the root
+// Exit:  pointer to the new node
+Node *BSTree::Add(hedger::S_T key, hedger::Node *hint)
+{
+  if (nullptr == hint || nullptr == root_) {
+    return Add(key);
   }
-  node->left = nullptr;
-  node->right = nullptr;
-
-  // Change the size of the tree by +1
-  ChangeSize(1);
-
-  // Increase the node total
-  nodeTot_++;
-  return node;
+  return AddBelow(FingerStart(key, hint), key, nullptr);
 }
 
 // DeleteKey
@@ -148,23 +157,22 @@ hedger::Node *BSTree::DeleteNode(hedger::Node *node, hedger::S_T key)
       node->right = DeleteNode(node->right, key);
     } else {
       // Case 0: Zero or single child: update linkage
-      if (nullptr == node->left) {
-        hedger::Node *successor = node->right;
-        if (node->parent->left == node) {
-          node->parent->left = successor;
-        } else if (node->parent->right == node) {
-          node->parent->right = successor;
+      if (nullptr == node->left || nullptr == node->right) {
+        hedger::Node *successor = node->left ? node->left : node->right;
+        if (successor) {
+          successor->parent = node->parent;
         }
-        delete node;
-        return successor;
-      } else if (nullptr == node->right) {
-        hedger::Node *successor = node->left;
-        if (node->parent->left == node) {
+        if (nullptr == node->parent) {
+          root_ = successor;
+        } else if (node->parent->left == node) {
           node->parent->left = successor;
         } else if (node->parent->right == node) {
           node->parent->right = successor;
         }
-        delete node;
+        delete (int *) node->data;
+        FreeNode(node);
+        ChangeSize(-1);
+        nodeTot_--;
         return successor;
       }
 
@@ -252,10 +260,207 @@ hedger::Node *BSTree::Find(hedger::S_T key)
   return node;
 }
 
+// Find
+//
+// Finger search: start from a node returned earlier, climbing only as far
+// as the key requires.
+//
+// Entry: key
+//        hint node, or nullptr to start at the root
+// Exit:  pointer to node, or nullptr if not found
+hedger::Node *BSTree::Find(hedger::S_T key, hedger::Node *hint)
+{
+  if (nullptr == hint) {
+    return Find(key);
+  }
+  return FindRecurse(key, FingerStart(key, hint));
+}
+
+// PackKeys
+//
+// Copy the keys into a flat array in sorted order.
+//
+// Entry: array of at least Size() keys
+// Exit:  number of keys written
+int BSTree::PackKeys(hedger::S_T keys[])
+{
+  return PackKeysRecurse(root_, keys, 0);
+}
+
+// RangeScan
+//
+// Copy the keys in [lo, hi] into out, in order.
+//
+// Entry: lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr to only count
+//        maximum number of keys to return
+// Exit:  number of keys returned
+std::size_t BSTree::RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max)
+{
+  return RangeScanRecurse(root_, lo, hi, out, max, 0);
+}
+
+// Freeze
+//
+// Snapshot the tree into an immutable Eytzinger-order search index.
+// The tree itself is left untouched.
+//
+// Entry: -
+// Exit:  pointer to new index; caller owns it
+hedger::EytzingerIndex *BSTree::Freeze()
+{
+  hedger::S_T *keys = new hedger::S_T[nodeTot_];
+  int keyTot = PackKeys(keys);
+  hedger::EytzingerIndex *index = new hedger::EytzingerIndex(keys, keyTot);
+  delete [] keys;
+  return index;
+}
+
 //
 // Helper functions
 //
 
+// AddBelow
+//
+// Link a new node into the subtree under start, which must be where the
+// key belongs.  Equal keys go right.
+//
+// Entry: subtree to descend
+//        key
+//        pointer to depth int, counted from start, or nullptr
+// Exit:  pointer to the new node
+hedger::Node *BSTree::AddBelow(hedger::Node *start, hedger::S_T key, int *depth)
+{
+  hedger::Node *node = new hedger::Node(key);
+
+  // Find appropriate parent based on key.
+  Node *currentNode = start;
+  Node *candidateParent = nullptr;
+  int currentDepth = 0;
+  while (currentNode != nullptr) {
+    candidateParent = currentNode;
+    if (node->key < currentNode->key) {
+      currentNode = currentNode->left;
+      currentDepth++;
+    } else {
+      currentNode = currentNode->right;
+      currentDepth++;
+    }
+  }
+
+  // We are keeping the depth record for analysis
+  currentDepth++;
+  if(depth) {
+    *depth = currentDepth;
+  }
+
+  // Determine whether to add node at right or left of parent.
+  node->parent = candidateParent;
+  if (node->key < node->parent->key) {
+    node->parent->left = node;
+  } else {
+    node->parent->right = node;
+  }
+  node->left = nullptr;
+  node->right = nullptr;
+
+  // Change the size of the tree by +1
+  ChangeSize(1);
+
+  // Increase the node total
+  nodeTot_++;
+  return node;
+}
+
+// AddNear
+//
+// Finger insert that also reports the new node's depth from the root,
+// worked out from the hint's depth, the levels climbed from the hint and
+// the levels descended, so no walk to the root is needed.
+//
+// Entry: key
+//        hint node, not nullptr
+//        depth of the hint, root == 1
+//        pointer to depth int
+// Exit:  pointer to the new node
+hedger::Node *BSTree::AddNear(hedger::S_T key, hedger::Node *hint, int hintDepth, int *depth)
+{
+  int climbed;
+  hedger::Node *start = FingerStart(key, hint, &climbed);
+  int below;
+  hedger::Node *node = AddBelow(start, key, &below);
+  *depth = hintDepth - climbed - 1 + below;
+  return node;
+}
+
+// FingerStart
+//
+// Find the lowest node at or above the hint whose subtree must hold the
+// key.  For a key above the hint, the climb passes right-child links,
+// whose parents are smaller still; a parent reached from its left child
+// bounds the subtree from above, and the climb stops at the first one
+// greater than the key.  Parents passed on the way that are not greater
+// become the node to descend from.  Symmetrically for a key below the
+// hint.  On the rightmost spine the climb reaches the root, but descends
+// from near the hint rather than from the root.
+//
+// Entry: key
+//        hint node
+//        pointer to levels climbed to the node returned, or nullptr
+// Exit:  node to descend from
+hedger::Node *BSTree::FingerStart(hedger::S_T key, hedger::Node *hint, int *climbed)
+{
+  hedger::Node *node = hint;
+  hedger::Node *walk = hint;
+  int up = 0;
+  int steps = 0;
+  if (key > hint->key) {
+    while (walk->parent) {
+      bool fromLeft = walk->parent->left == walk;
+      walk = walk->parent;
+      steps++;
+      if (fromLeft) {
+        if (walk->key > key) {
+          break;
+        }
+        node = walk;
+        up = steps;
+      }
+    }
+  } else if (key < hint->key) {
+    while (walk->parent) {
+      bool fromRight = walk->parent->right == walk;
+      walk = walk->parent;
+      steps++;
+      if (fromRight) {
+        if (walk->key < key) {
+          break;
+        }
+        node = walk;
+        up = steps;
+      }
+    }
+  }
+  if (climbed) {
+    *climbed = up;
+  }
+  return node;
+}
+
+// Depth
+//
+// Entry: pointer to node
+// Exit:  depth of the node, root == 1
+int BSTree::Depth(hedger::Node *node)
+{
+  int depth = 0;
+  for (; node; node = node->parent) {
+    depth++;
+  }
+  return depth;
+}
+
 // ChangeSize
 // Change the size of the tree (# of nodes)
 // Entry: size change delta
@@ -317,4 +522,51 @@ hedger::Node *BSTree::FindRecurse(hedger::S_T key, hedger::Node *node)
   }
   return nullptr;
 }
+
+// PackKeysRecurse
+// Internal recursion function for PackKeys; an in-order walk.
+// Entry: pointer to node
+//        key array
+//        current array index
+// Exit:  next array index
+int BSTree::PackKeysRecurse(hedger::Node *node, hedger::S_T keys[], int i)
+{
+  if (!node) {
+    return i;
+  }
+  i = PackKeysRecurse(node->left, keys, i);
+  keys[i++] = node->key;
+  return PackKeysRecurse(node->right, keys, i);
+}
+
+// RangeScanRecurse
+// Internal recursion function for RangeScan; an in-order walk that skips
+// subtrees outside [lo, hi].
+// Entry: pointer to node
+//        lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr
+//        maximum number of keys to return
+//        keys returned so far
+// Exit:  keys returned so far
+std::size_t BSTree::RangeScanRecurse(hedger::Node *node, hedger::S_T lo, hedger::S_T hi,
+  hedger::S_T *out, std::size_t max, std::size_t n)
+{
+  if (!node || n >= max) {
+    return n;
+  }
+  if (node->key >= lo) {
+    n = RangeScanRecurse(node->left, lo, hi, out, max, n);
+  }
+  if (node->key >= lo && node->key <= hi && n < max) {
+    if (out) {
+      out[n] = node->key;
+    }
+    n++;
+  }
+  if (node->key <= hi) {
+    n = RangeScanRecurse(node->right, lo, hi, out, max, n);
+  }
+  return n;
+}
 } // namespace hedger
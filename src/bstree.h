@@ -23,15 +23,23 @@
 #ifndef BTREE_H_
 #define BTREE_H_
 
+#include <stdint.h>
+
+#include <vector>
+
 #include "algo.h"
 
 namespace hedger
 {
+class EytzingerIndex;
+
 struct Node
 {
   Node(hedger::S_T newKey) {
     key = newKey;
     left = right = parent = nullptr;
+    rank = 0;
+    slab = 0;
     data = nullptr;
   }
   ~Node() {};
@@ -40,9 +48,22 @@ struct Node
   hedger::Node *      right;    // right leg
   hedger::Node *      parent;   // parent (could be axed)
   hedger::S_T         key;      // key
+  uint8_t             rank;     // zip tree rank; sits in padding after key
+  uint8_t             slab;     // 1 == placed in a NodeSlab; also in padding
   void *              data;     // payload / "satellite" data
 };
 
+// NodeSlab
+//
+// Nodes placed in one allocation by a bulk build.  They are released
+// with the slab rather than one at a time, so a deleted slab node keeps
+// its slot until the tree is destroyed or rebuilt.
+struct NodeSlab
+{
+  hedger::Node *      nodes;
+  std::size_t         nodeTot;
+};
+
 
 class BSTree
 {
@@ -51,23 +72,40 @@ class BSTree
   virtual ~BSTree();
 
   Node *Add(hedger::S_T key, int *depth = NULL);
+  Node *Add(hedger::S_T key, hedger::Node *hint);
   hedger::Node *DeleteNode(hedger::Node *node, hedger::S_T key);
   bool DeleteKey(hedger::S_T key);
   hedger::Node *Find(hedger::S_T key);
+  hedger::Node *Find(hedger::S_T key, hedger::Node *hint);
   void Print(hedger::Node *node = nullptr);
   int MaxDepth();
+  int Size() { return nodeTot_; }
+  std::size_t MemoryUsage() { return nodeTot_ * sizeof(hedger::Node); }
+  int PackKeys(hedger::S_T keys[]);
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max);
+  hedger::EytzingerIndex *Freeze();
 
  protected:
   hedger::Node* FindMin(hedger::Node *node);
+  hedger::Node *AddBelow(hedger::Node *start, hedger::S_T key, int *depth);
+  hedger::Node *AddNear(hedger::S_T key, hedger::Node *hint, int hintDepth, int *depth);
+  hedger::Node *FingerStart(hedger::S_T key, hedger::Node *hint, int *climbed = nullptr);
+  int Depth(hedger::Node *node);
   void MaxDepthRecurse(hedger::Node *node, int depth, int *maxDepth);
   void DeleteRecursive(hedger::Node *node);
+  void FreeNode(hedger::Node *node);
+  void FreeSlabs();
   void ChangeSize(int);
   Node *FindRecurse(hedger::S_T key, hedger::Node *node);
+  int PackKeysRecurse(hedger::Node *node, hedger::S_T keys[], int i);
+  std::size_t RangeScanRecurse(hedger::Node *node, hedger::S_T lo, hedger::S_T hi,
+    hedger::S_T *out, std::size_t max, std::size_t n);
 
   Node *  root_;
-  Node *  size_;
-  Node *  maxSize_;
+  int     size_;
+  int     maxSize_;
   int     nodeTot_;
+  std::vector<hedger::NodeSlab> slabs_;   // bulk-built nodes
 };
 } // namespace hedger
 #endif // #ifndef BTREE_H_
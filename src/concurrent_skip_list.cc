@@ -0,0 +1,403 @@
+// concurrent_skip_list.cc
+//
+// Implements a lock-free skip list: towers are linked and unlinked by CAS
+// and removed nodes are reclaimed through epochs.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <new>
+
+#include "concurrent_skip_list.h"
+
+namespace hedger
+{
+// Constructor
+//
+// Entry: probability that a tower grows past each level
+//        pinned (EBR) or quiescent (QSBR) reclamation
+ConcurrentSkipList::ConcurrentSkipList(double p, hedger::EpochMode mode) : epoch_(mode)
+{
+  threshold_ = (uint32_t) (p * 4294967296.0);
+  level_ = 1;
+  nodeTot_ = 0;
+  bytes_ = 0;
+  head_ = NewNode((int64_t) INT_MIN - 1, kSkipListMaxLevel);
+  tail_ = NewNode((int64_t) INT_MAX + 1, kSkipListMaxLevel);
+  for (int i = 0; i < kSkipListMaxLevel; i++) {
+    head_->next[i].store((uintptr_t) tail_, std::memory_order_relaxed);
+  }
+}
+
+// Destructor
+//
+// No other thread may be using the list.  Retired nodes are released by
+// the reclaimer.
+ConcurrentSkipList::~ConcurrentSkipList()
+{
+  hedger::ConcurrentSkipNode *node = head_;
+  while (node) {
+    hedger::ConcurrentSkipNode *next = Address(node->next[0].load(std::memory_order_relaxed));
+    FreeNode(node);
+    node = next;
+  }
+}
+
+// Add
+//
+// Link level 0 first; that is the insert.  Each level above is linked
+// only while the tower is unmarked, re-searching when a predecessor
+// changes under it.
+//
+// Entry: key
+// Exit:  true == inserted, false == key already present
+bool ConcurrentSkipList::Add(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  hedger::ConcurrentSkipNode *preds[kSkipListMaxLevel];
+  hedger::ConcurrentSkipNode *succs[kSkipListMaxLevel];
+  int level = RandomLevel();
+  int top = level_.load(std::memory_order_relaxed);
+  while (top < level && !level_.compare_exchange_weak(top, level)) {
+  }
+
+  hedger::ConcurrentSkipNode *node = nullptr;
+  for (;;) {
+    if (FindPredecessors(key, preds, succs)) {
+      if (node) {
+        bytes_.fetch_sub(offsetof(hedger::ConcurrentSkipNode, next) + level * sizeof(uintptr_t));
+        FreeNode(node);
+      }
+      return false;
+    }
+    if (!node) {
+      node = NewNode(key, level);
+    }
+    for (int i = 0; i < level; i++) {
+      node->next[i].store((uintptr_t) succs[i], std::memory_order_relaxed);
+    }
+    uintptr_t expected = (uintptr_t) succs[0];
+    if (preds[0]->next[0].compare_exchange_strong(expected, (uintptr_t) node,
+        std::memory_order_acq_rel)) {
+      break;
+    }
+  }
+  nodeTot_.fetch_add(1, std::memory_order_relaxed);
+
+  for (int i = 1; i < level; i++) {
+    for (;;) {
+      uintptr_t link = node->next[i].load(std::memory_order_acquire);
+      if (link & kSkipMark) {
+        i = level;                    // being deleted: stop growing
+        break;
+      }
+      if (Address(link) != succs[i] &&
+          !node->next[i].compare_exchange_strong(link, (uintptr_t) succs[i])) {
+        i = level;                    // marked just now
+        break;
+      }
+      uintptr_t expected = (uintptr_t) succs[i];
+      if (preds[i]->next[i].compare_exchange_strong(expected, (uintptr_t) node,
+          std::memory_order_acq_rel)) {
+        break;
+      }
+      if (!FindPredecessors(key, preds, succs) || succs[0] != node) {
+        i = level;                    // deleted meanwhile
+        break;
+      }
+    }
+  }
+  if (node->state.fetch_or(kSkipLinked) & kSkipDeleted) {
+    Reclaim(node);
+  }
+  return true;
+}
+
+// Find
+//
+// Wait-free: no CAS and no restarts; marked nodes are stepped over.
+//
+// Entry: key
+// Exit:  true == key present
+bool ConcurrentSkipList::Find(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  return LowerBound(key)->key == key;
+}
+
+// DeleteKey
+//
+// Mark the tower from the top down.  Marking level 0 is the delete, and
+// only one thread can do it.
+//
+// Entry: key
+// Exit:  true == deleted, false == not present
+bool ConcurrentSkipList::DeleteKey(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  hedger::ConcurrentSkipNode *preds[kSkipListMaxLevel];
+  hedger::ConcurrentSkipNode *succs[kSkipListMaxLevel];
+  if (!FindPredecessors(key, preds, succs)) {
+    return false;
+  }
+  hedger::ConcurrentSkipNode *node = succs[0];
+  for (int i = node->level - 1; i >= 1; i--) {
+    uintptr_t link = node->next[i].load(std::memory_order_acquire);
+    while (!(link & kSkipMark) && !node->next[i].compare_exchange_weak(link, link | kSkipMark)) {
+    }
+  }
+  uintptr_t link = node->next[0].load(std::memory_order_acquire);
+  for (;;) {
+    if (link & kSkipMark) {
+      return false;                   // another delete got there first
+    }
+    if (node->next[0].compare_exchange_weak(link, link | kSkipMark)) {
+      break;
+    }
+  }
+  nodeTot_.fetch_sub(1, std::memory_order_relaxed);
+  if (node->state.fetch_or(kSkipDeleted) & kSkipLinked) {
+    Reclaim(node);
+  }
+  return true;
+}
+
+// RangeScan
+//
+// Copy the keys in [lo, hi] into out, in order, by walking level 0.
+// Keys added or deleted during the scan may or may not be seen.
+//
+// Entry: lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr to only count
+//        maximum number of keys to return
+// Exit:  number of keys returned
+std::size_t ConcurrentSkipList::RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out,
+  std::size_t max)
+{
+  hedger::EpochGuard guard(epoch_);
+  std::size_t n = 0;
+  hedger::ConcurrentSkipNode *node = LowerBound(lo);
+  while (node->key <= hi && n < max) {
+    uintptr_t link = node->next[0].load(std::memory_order_acquire);
+    if (!(link & kSkipMark)) {
+      if (out) {
+        out[n] = (hedger::S_T) node->key;
+      }
+      n++;
+    }
+    node = Address(link);
+  }
+  return n;
+}
+
+//
+// Helper functions
+//
+
+// RandomLevel
+//
+// Draw a tower height from the geometric distribution with parameter p,
+// from a per-thread xorshift stream.
+//
+// Exit: level in [1, kSkipListMaxLevel]
+int ConcurrentSkipList::RandomLevel()
+{
+  static thread_local uint64_t seed = 0;
+  if (!seed) {
+    seed = ((uint64_t) (uintptr_t) &seed << 16) ^ 0x9e3779b97f4a7c15ull;
+  }
+  int level = 1;
+  for (;;) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    if ((uint32_t) (seed >> 32) >= threshold_ || level >= kSkipListMaxLevel) {
+      return level;
+    }
+    level++;
+  }
+}
+
+// NewNode
+// Allocate a node with its tower inline.
+// Entry: key
+//        tower height
+// Exit:  pointer to node, links cleared
+hedger::ConcurrentSkipNode *ConcurrentSkipList::NewNode(int64_t key, int level)
+{
+  std::size_t size = offsetof(hedger::ConcurrentSkipNode, next) + level * sizeof(uintptr_t);
+  hedger::ConcurrentSkipNode *node = (hedger::ConcurrentSkipNode *) malloc(size);
+  if (!node) {
+    throw std::bad_alloc();
+  }
+  node->key = key;
+  node->level = level;
+  new (&node->state) std::atomic<int>(0);
+  for (int i = 0; i < level; i++) {
+    new (&node->next[i]) std::atomic<uintptr_t>(0);
+  }
+  bytes_.fetch_add(size, std::memory_order_relaxed);
+  return node;
+}
+
+// FreeNode
+// Entry: pointer to node
+void ConcurrentSkipList::FreeNode(void *node)
+{
+  free(node);
+}
+
+// ReleaseNode
+// Free a retired node once the reclaimer is done with it.
+// Entry: list the node was in
+//        pointer to node
+void ConcurrentSkipList::ReleaseNode(void *list, void *node)
+{
+  std::size_t size = offsetof(hedger::ConcurrentSkipNode, next) +
+    ((hedger::ConcurrentSkipNode *) node)->level * sizeof(uintptr_t);
+  ((hedger::ConcurrentSkipList *) list)->bytes_.fetch_sub(size, std::memory_order_relaxed);
+  FreeNode(node);
+}
+
+// FindPredecessors
+//
+// Walk down from the top level, snipping out marked nodes on the way and
+// recording at each level the last node with a smaller key and the
+// first unmarked one with a key not smaller.  A failed snip means the
+// predecessor changed; the walk starts over.
+//
+// Entry: key
+//        arrays of kSkipListMaxLevel predecessors and successors to fill
+//        (only the levels below level_ are filled)
+// Exit:  true == succs[0] holds key
+bool ConcurrentSkipList::FindPredecessors(int64_t key, hedger::ConcurrentSkipNode **preds,
+  hedger::ConcurrentSkipNode **succs)
+{
+retry:
+  hedger::ConcurrentSkipNode *pred = head_;
+  for (int i = level_.load(std::memory_order_relaxed) - 1; i >= 0; i--) {
+    hedger::ConcurrentSkipNode *curr = Address(pred->next[i].load(std::memory_order_acquire));
+    for (;;) {
+      uintptr_t succ = curr->next[i].load(std::memory_order_acquire);
+      while (succ & kSkipMark) {
+        uintptr_t expected = (uintptr_t) curr;
+        if (!pred->next[i].compare_exchange_strong(expected, succ & ~kSkipMark,
+            std::memory_order_acq_rel)) {
+          goto retry;
+        }
+        curr = Address(succ);
+        succ = curr->next[i].load(std::memory_order_acquire);
+      }
+      if (curr->key >= key) {
+        break;
+      }
+      pred = curr;
+      curr = Address(succ);
+    }
+    preds[i] = pred;
+    succs[i] = curr;
+  }
+  return succs[0]->key == key;
+}
+
+// LowerBound
+//
+// Read-only descent that steps over marked nodes.
+//
+// Entry: key
+// Exit:  first unmarked node at level 0 with key >= key (tail_ if none)
+hedger::ConcurrentSkipNode *ConcurrentSkipList::LowerBound(int64_t key)
+{
+  hedger::ConcurrentSkipNode *pred = head_;
+  hedger::ConcurrentSkipNode *curr = nullptr;
+  for (int i = level_.load(std::memory_order_relaxed) - 1; i >= 0; i--) {
+    curr = Address(pred->next[i].load(std::memory_order_acquire));
+    for (;;) {
+      uintptr_t succ = curr->next[i].load(std::memory_order_acquire);
+      while (succ & kSkipMark) {
+        curr = Address(succ);
+        succ = curr->next[i].load(std::memory_order_acquire);
+      }
+      if (curr->key >= key) {
+        break;
+      }
+      pred = curr;
+      curr = Address(succ);
+    }
+  }
+  return curr;
+}
+
+// Reclaim
+//
+// Called by the second of inserter and deleter: the tower is fully
+// marked and will not be linked any further, so once unlinked it can be
+// retired.
+//
+// Entry: node
+void ConcurrentSkipList::Reclaim(hedger::ConcurrentSkipNode *node)
+{
+  Unlink(node);
+  epoch_.Retire(node, ReleaseNode, this,
+    offsetof(hedger::ConcurrentSkipNode, next) + node->level * sizeof(uintptr_t));
+}
+
+// Unlink
+//
+// Snip node out of every level it is still linked at.  Unlike
+// FindPredecessors this walks past every node with an equal key, since
+// a newer node for the same key may sit ahead of it, and descends from
+// the last smaller key so that none is missed on the level below.
+//
+// Entry: fully marked node
+void ConcurrentSkipList::Unlink(hedger::ConcurrentSkipNode *node)
+{
+  int64_t key = node->key;
+retry:
+  hedger::ConcurrentSkipNode *less = head_;
+  for (int i = level_.load(std::memory_order_relaxed) - 1; i >= 0; i--) {
+    hedger::ConcurrentSkipNode *pred = less;
+    uintptr_t link = pred->next[i].load(std::memory_order_acquire);
+    if (link & kSkipMark) {
+      goto retry;
+    }
+    hedger::ConcurrentSkipNode *curr = Address(link);
+    while (curr->key <= key) {
+      uintptr_t succ = curr->next[i].load(std::memory_order_acquire);
+      if (succ & kSkipMark) {
+        uintptr_t expected = (uintptr_t) curr;
+        if (!pred->next[i].compare_exchange_strong(expected, succ & ~kSkipMark,
+            std::memory_order_acq_rel)) {
+          goto retry;
+        }
+      } else {
+        if (curr->key < key) {
+          less = curr;
+        }
+        pred = curr;
+      }
+      curr = Address(succ);
+    }
+  }
+}
+} // namespace hedger
@@ -0,0 +1,109 @@
+// concurrent_skip_list.h
+//
+// Implements a lock-free skip list: towers are linked and unlinked by CAS
+// and removed nodes are reclaimed through epochs.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef CONCURRENT_SKIP_LIST_H_
+#define CONCURRENT_SKIP_LIST_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+
+#include "algo.h"
+#include "epoch.h"
+#include "skip_list.h"
+
+namespace hedger
+{
+// Low bit of a forward link: the node holding the link is being deleted
+// at that level and the link may no longer change.
+const uintptr_t kSkipMark = 1;
+
+// Tower states; whichever of inserter and deleter finishes second
+// unlinks and retires the node.
+const int kSkipLinked = 1;        // inserter has finished with the tower
+const int kSkipDeleted = 2;       // deleter has marked the whole tower
+
+// ConcurrentSkipNode
+//
+// As SkipNode, with the tower of marked links allocated inline.  Keys
+// are widened so the sentinels sort outside every S_T.
+struct ConcurrentSkipNode
+{
+  int64_t                   key;
+  int                       level;        // tower height
+  std::atomic<int>          state;
+  std::atomic<uintptr_t>    next[1];      // forward links, level entries
+};
+
+// ConcurrentSkipList
+//
+// Lock-free skip list.  A key is in the set once its node is linked at
+// level 0 and leaves it when its level 0 link is marked; the levels
+// above are only shortcuts.  Add links the tower bottom up, DeleteKey
+// marks it top down, and searches snip marked nodes out as they pass.
+// Find and RangeScan skip marked nodes without writing.  Every
+// operation runs inside an epoch guard, so removed nodes are freed only
+// once no thread can be traversing them.  Towers vary in size, so nodes
+// come from malloc rather than a NodePool.
+class ConcurrentSkipList
+{
+ public:
+  ConcurrentSkipList(double p = kSkipListP, hedger::EpochMode mode = kEpochPinned);
+  virtual ~ConcurrentSkipList();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max);
+  int Size() { return nodeTot_.load(std::memory_order_relaxed); }
+  std::size_t MemoryUsage() { return bytes_.load(std::memory_order_relaxed); }
+  void ReclaimStats(hedger::EpochStats *stats) { epoch_.Stats(stats); }
+  void Offline() { epoch_.Offline(); }
+  hedger::EpochMode Mode() { return epoch_.Mode(); }
+
+ protected:
+  static hedger::ConcurrentSkipNode *Address(uintptr_t link)
+  {
+    return (hedger::ConcurrentSkipNode *) (link & ~kSkipMark);
+  }
+  int RandomLevel();
+  hedger::ConcurrentSkipNode *NewNode(int64_t key, int level);
+  static void FreeNode(void *node);
+  static void ReleaseNode(void *list, void *node);
+  bool FindPredecessors(int64_t key, hedger::ConcurrentSkipNode **preds,
+    hedger::ConcurrentSkipNode **succs);
+  hedger::ConcurrentSkipNode *LowerBound(int64_t key);
+  void Reclaim(hedger::ConcurrentSkipNode *node);
+  void Unlink(hedger::ConcurrentSkipNode *node);
+
+  hedger::ConcurrentSkipNode *  head_;        // sentinels with full-height towers
+  hedger::ConcurrentSkipNode *  tail_;
+  std::atomic<int>              level_;       // highest level any tower reaches
+  uint32_t                      threshold_;   // p scaled to 2^32
+  std::atomic<int>              nodeTot_;
+  std::atomic<std::size_t>      bytes_;       // linked and retired nodes
+  hedger::EpochReclaimer        epoch_;
+};
+} // namespace hedger
+#endif // #ifndef CONCURRENT_SKIP_LIST_H_
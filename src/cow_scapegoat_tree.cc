@@ -0,0 +1,605 @@
+// cow_scapegoat_tree.cc
+//
+// Implements a scapegoat tree whose rebuilds run on a background thread
+// and are swapped in copy-on-write under concurrent readers.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <math.h>
+
+#include <algorithm>
+#include <new>
+
+#include "cow_scapegoat_tree.h"
+
+namespace hedger
+{
+// Constructor
+//
+// Starts the rebuilder thread.
+CowScapegoatTree::CowScapegoatTree() : head_(0), pool_(sizeof(hedger::CowNode))
+{
+  nodeTot_ = 0;
+  rebuild_ = nullptr;
+  rebuildTot_ = 0;
+  bufferedTot_ = 0;
+  skippedTot_ = 0;
+  pending_ = false;
+  stop_ = false;
+  requestKey_ = 0;
+  rebuilder_ = std::thread(&CowScapegoatTree::Rebuilder, this);
+}
+
+// Destructor
+//
+// No other thread may be using the tree.  A rebuild in progress is
+// finished first.  Nodes, linked or retired, go with the pool's slabs.
+CowScapegoatTree::~CowScapegoatTree()
+{
+  {
+    std::lock_guard<std::mutex> lock(requestLock_);
+    stop_ = true;
+  }
+  requestReady_.notify_one();
+  rebuilder_.join();
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == added, false == already present
+bool CowScapegoatTree::Add(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  std::lock_guard<std::mutex> lock(writeLock_);
+  hedger::CowRebuild *rebuild = rebuild_.load(std::memory_order_relaxed);
+  hedger::CowNode *frozen = rebuild ? rebuild->scapegoat : nullptr;
+  hedger::CowNode *parent = &head_;
+  hedger::CowNode *node = head_.left.load(std::memory_order_relaxed);
+  int depth = 1;
+  while (node) {
+    if (node == frozen) {
+      return Buffer(rebuild, key, true);
+    }
+    if (node->key == key) {
+      return false;
+    }
+    parent = node;
+    node = Child(node, key).load(std::memory_order_relaxed);
+    depth++;
+  }
+  Child(parent, key).store(NewNode(key), std::memory_order_release);
+  int size = nodeTot_.load(std::memory_order_relaxed) + 1;
+  nodeTot_.store(size, std::memory_order_relaxed);
+  if (depth > Log32(size)) {
+    PostRebuild(key);
+  }
+  return true;
+}
+
+// Find
+//
+// Lock-free unless it meets a frozen subtree, where it takes the
+// rebuild's overlay lock to look for a buffered write first.
+//
+// Entry: key
+// Exit:  true == key present
+bool CowScapegoatTree::Find(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  hedger::CowRebuild *rebuild = rebuild_.load(std::memory_order_seq_cst);
+  hedger::CowNode *frozen = rebuild ? rebuild->scapegoat : nullptr;
+  hedger::CowNode *node = head_.left.load(std::memory_order_acquire);
+  while (node) {
+    if (node == frozen) {
+      std::lock_guard<std::mutex> lock(rebuild->lock);
+      auto write = rebuild->overlay.find(key);
+      if (write != rebuild->overlay.end()) {
+        return write->second.present;
+      }
+    }
+    if (node->key == key) {
+      return true;
+    }
+    node = Child(node, key).load(std::memory_order_acquire);
+  }
+  return false;
+}
+
+// DeleteKey
+//
+// A node with at most one child is spliced out with one store.  A node
+// with two children takes its successor's key; the path from it down to
+// the successor is copied and the copy published with one store, so a
+// reader on the old path still finds every key.
+//
+// Entry: key
+// Exit:  true == deleted, false == not present
+bool CowScapegoatTree::DeleteKey(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  for (;;) {
+    std::unique_lock<std::mutex> lock(writeLock_);
+    hedger::CowRebuild *rebuild = rebuild_.load(std::memory_order_relaxed);
+    hedger::CowNode *frozen = rebuild ? rebuild->scapegoat : nullptr;
+    hedger::CowNode *parent = &head_;
+    hedger::CowNode *node = head_.left.load(std::memory_order_relaxed);
+    while (node && node != frozen && node->key != key) {
+      parent = node;
+      node = Child(node, key).load(std::memory_order_relaxed);
+    }
+    if (!node) {
+      return false;
+    }
+    if (node == frozen) {
+      return Buffer(rebuild, key, false);
+    }
+
+    hedger::CowNode *left = node->left.load(std::memory_order_relaxed);
+    hedger::CowNode *right = node->right.load(std::memory_order_relaxed);
+    if (!left || !right) {
+      Child(parent, key).store(left ? left : right, std::memory_order_release);
+      nodeTot_.store(nodeTot_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+      Retire(node);
+      return true;
+    }
+
+    std::vector<hedger::CowNode *> path(1, node);
+    for (hedger::CowNode *next = right; next; next = next->left.load(std::memory_order_relaxed)) {
+      path.push_back(next);
+    }
+    if (frozen && std::find(path.begin(), path.end(), frozen) != path.end()) {
+      // The successor is frozen: wait for the rebuild to swap it out.
+      lock.unlock();
+      WaitIdle();
+      continue;
+    }
+    hedger::CowNode *succ = path.back();
+    hedger::CowNode *below = succ->right.load(std::memory_order_relaxed);
+    for (int i = (int) path.size() - 2; i >= 1; i--) {
+      hedger::CowNode *copy = NewNode(path[i]->key);
+      copy->left.store(below, std::memory_order_relaxed);
+      copy->right.store(path[i]->right.load(std::memory_order_relaxed), std::memory_order_relaxed);
+      below = copy;
+    }
+    hedger::CowNode *top = NewNode(succ->key);
+    top->left.store(left, std::memory_order_relaxed);
+    top->right.store(below, std::memory_order_relaxed);
+    Child(parent, key).store(top, std::memory_order_release);
+    nodeTot_.store(nodeTot_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+    for (hedger::CowNode *old : path) {
+      Retire(old);
+    }
+    return true;
+  }
+}
+
+// WaitIdle
+//
+// Block until no rebuild is posted or running.
+void CowScapegoatTree::WaitIdle()
+{
+  std::unique_lock<std::mutex> lock(requestLock_);
+  idle_.wait(lock, [this]() { return !pending_; });
+}
+
+//
+// Helper functions
+//
+
+// Log32
+//
+// Gets the log-base 3/2, as ScapegoatTree does
+int const CowScapegoatTree::Log32(int q)
+{
+  double const log23 = 2.4663034623764317;
+  return (int) ceil(log23 * log(q));
+}
+
+// Child
+//
+// Entry: node, or the head sentinel
+//        key
+// Exit:  the link key descends through
+std::atomic<hedger::CowNode *> &CowScapegoatTree::Child(hedger::CowNode *node, hedger::S_T key)
+{
+  if (node == &head_ || key < node->key) {
+    return node->left;
+  }
+  return node->right;
+}
+
+// NewNode
+// Entry: key
+// Exit:  pointer to node, from the pool
+hedger::CowNode *CowScapegoatTree::NewNode(hedger::S_T key)
+{
+  return new (pool_.Alloc()) hedger::CowNode(key);
+}
+
+// Retire
+//
+// Hand an unlinked node to the reclaimer, as a reader may still be
+// looking at it.
+//
+// Entry: unlinked node
+void CowScapegoatTree::Retire(hedger::CowNode *node)
+{
+  epoch_.Retire(node, hedger::NodePool::Release, &pool_, sizeof(hedger::CowNode));
+}
+
+// Buffer
+//
+// Record a write that reached the frozen subtree.  Called with the
+// writer lock held; only writers change the overlay, so it is read here
+// without its lock, which is taken only to exclude readers.
+//
+// Entry: rebuild in progress
+//        key
+//        true == add, false == delete
+// Exit:  true == the write changed the set
+bool CowScapegoatTree::Buffer(hedger::CowRebuild *rebuild, hedger::S_T key, bool present)
+{
+  auto write = rebuild->overlay.find(key);
+  bool was = write != rebuild->overlay.end() ? write->second.present :
+    Contains(rebuild->scapegoat, key);
+  if (was == present) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(rebuild->lock);
+    rebuild->overlay[key] = { present, ++rebuild->seq };
+  }
+  nodeTot_.store(nodeTot_.load(std::memory_order_relaxed) + (present ? 1 : -1),
+    std::memory_order_relaxed);
+  bufferedTot_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+// Contains
+// Entry: subtree root
+//        key
+// Exit:  true == key in the subtree
+bool CowScapegoatTree::Contains(hedger::CowNode *node, hedger::S_T key)
+{
+  while (node && node->key != key) {
+    node = (key < node->key ? node->left : node->right).load(std::memory_order_acquire);
+  }
+  return node != nullptr;
+}
+
+// ParentOf
+//
+// Find a node's parent by searching for its key.  Called with the writer
+// lock held.
+//
+// Entry: node
+// Exit:  parent (head_ for the root), or nullptr == node not linked
+hedger::CowNode *CowScapegoatTree::ParentOf(hedger::CowNode *node)
+{
+  hedger::CowNode *parent = &head_;
+  for (;;) {
+    hedger::CowNode *next = Child(parent, node->key).load(std::memory_order_relaxed);
+    if (next == node) {
+      return parent;
+    }
+    if (!next) {
+      return nullptr;
+    }
+    parent = next;
+  }
+}
+
+// PostRebuild
+//
+// Ask the rebuilder to look for a scapegoat above key.  Dropped if a
+// rebuild is already under way; a later deep insert posts again.
+//
+// Entry: key of a node that landed too deep
+void CowScapegoatTree::PostRebuild(hedger::S_T key)
+{
+  std::lock_guard<std::mutex> lock(requestLock_);
+  if (!pending_) {
+    pending_ = true;
+    requestKey_ = key;
+    requestReady_.notify_one();
+  }
+}
+
+// Rebuilder
+//
+// Rebuilder thread: serve posted rebuilds until the tree goes.
+void CowScapegoatTree::Rebuilder()
+{
+  std::unique_lock<std::mutex> lock(requestLock_);
+  for (;;) {
+    requestReady_.wait(lock, [this]() { return stop_ || pending_; });
+    if (stop_) {
+      return;
+    }
+    hedger::S_T key = requestKey_;
+    lock.unlock();
+    Rebuild(key);
+    lock.lock();
+    pending_ = false;
+    idle_.notify_all();
+  }
+}
+
+// Rebuild
+//
+// Freeze the scapegoat's subtree, copy its keys and the writes buffered
+// so far into fresh balanced nodes with no lock held, then under the
+// writer lock replay the writes buffered since and swap the copy in.
+//
+// Entry: key of a node that landed too deep
+void CowScapegoatTree::Rebuild(hedger::S_T key)
+{
+  hedger::CowRebuild *rebuild;
+  {
+    hedger::EpochGuard guard(epoch_);
+    hedger::CowNode *scapegoat = FindScapegoat(key);
+    if (!scapegoat) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(writeLock_);
+    if (!ParentOf(scapegoat)) {
+      skippedTot_.fetch_add(1, std::memory_order_relaxed);
+      return;                         // unlinked or copied since
+    }
+    rebuild = new hedger::CowRebuild(scapegoat);
+    rebuild_.store(rebuild, std::memory_order_seq_cst);
+  }
+
+  // Frozen nodes are neither changed nor retired, so no pin is needed
+  // to read them.
+  std::vector<hedger::S_T> keys;
+  PackRecurse(rebuild->scapegoat, &keys);
+  std::vector<std::pair<hedger::S_T, hedger::CowWrite>> writes;
+  uint64_t seen;
+  {
+    std::lock_guard<std::mutex> lock(rebuild->lock);
+    writes.assign(rebuild->overlay.begin(), rebuild->overlay.end());
+    seen = rebuild->seq;
+  }
+  std::vector<hedger::S_T> merged;
+  merged.reserve(keys.size() + writes.size());
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (i < keys.size() || j < writes.size()) {
+    if (j == writes.size() || (i < keys.size() && keys[i] < writes[j].first)) {
+      merged.push_back(keys[i++]);
+      continue;
+    }
+    if (i < keys.size() && keys[i] == writes[j].first) {
+      i++;
+    }
+    if (writes[j].second.present) {
+      merged.push_back(writes[j].first);
+    }
+    j++;
+  }
+  hedger::CowNode *fresh = BuildBalanced(merged.data(), (int) merged.size());
+
+  {
+    std::lock_guard<std::mutex> lock(writeLock_);
+    std::vector<hedger::S_T> adds;
+    for (const auto &write : rebuild->overlay) {
+      if (write.second.seq > seen) {
+        if (write.second.present) {
+          adds.push_back(write.first);
+        } else {
+          DeletePrivate(&fresh, write.first);
+        }
+      }
+    }
+    AddBalanced(&fresh, adds.data(), (int) adds.size());
+    Child(ParentOf(rebuild->scapegoat), rebuild->scapegoat->key).store(fresh,
+      std::memory_order_release);
+    rebuild_.store(nullptr, std::memory_order_seq_cst);
+  }
+  rebuildTot_.fetch_add(merged.size(), std::memory_order_relaxed);
+
+  hedger::EpochGuard guard(epoch_);
+  RetireRecursive(rebuild->scapegoat);
+  epoch_.Retire(rebuild, ReleaseRebuild, nullptr, sizeof(hedger::CowRebuild));
+}
+
+// FindScapegoat
+//
+// Apply ScapegoatTree's depth bound and scapegoat test along key's path.
+// The tree may change underneath, so sizes can be off; that only moves
+// the choice of scapegoat.  Called pinned.
+//
+// Entry: key of a node that landed too deep
+// Exit:  scapegoat, or nullptr == none needed any more
+hedger::CowNode *CowScapegoatTree::FindScapegoat(hedger::S_T key)
+{
+  std::vector<hedger::CowNode *> path(1, &head_);
+  hedger::CowNode *node = head_.left.load(std::memory_order_acquire);
+  while (node) {
+    path.push_back(node);
+    if (node->key == key) {
+      break;
+    }
+    node = Child(node, key).load(std::memory_order_acquire);
+  }
+  int last = (int) path.size() - 1;
+  if (!node || last < 2 || last <= Log32(Size())) {
+    return nullptr;
+  }
+  int size = CountRecurse(path[last - 1]);
+  for (int i = last - 2; i >= 1; i--) {
+    hedger::CowNode *left = path[i]->left.load(std::memory_order_acquire);
+    hedger::CowNode *sibling = left == path[i + 1] ? path[i]->right.load(std::memory_order_acquire) : left;
+    int parentSize = size + CountRecurse(sibling) + 1;
+    if (3 * size > 2 * parentSize) {
+      return path[i];
+    }
+    size = parentSize;
+  }
+  return nullptr;
+}
+
+// CountRecurse
+// Entry: subtree root
+// Exit:  node total
+int CowScapegoatTree::CountRecurse(hedger::CowNode *node)
+{
+  if (!node) {
+    return 0;
+  }
+  return CountRecurse(node->left.load(std::memory_order_acquire)) +
+    CountRecurse(node->right.load(std::memory_order_acquire)) + 1;
+}
+
+// PackRecurse
+// Entry: subtree root
+//        vector to append its keys to, in order
+void CowScapegoatTree::PackRecurse(hedger::CowNode *node, std::vector<hedger::S_T> *keys)
+{
+  if (node) {
+    PackRecurse(node->left.load(std::memory_order_acquire), keys);
+    keys->push_back(node->key);
+    PackRecurse(node->right.load(std::memory_order_acquire), keys);
+  }
+}
+
+// BuildBalanced
+//
+// Entry: keys in order
+//        number of keys
+// Exit:  root of a fresh, unpublished balanced subtree
+hedger::CowNode *CowScapegoatTree::BuildBalanced(const hedger::S_T *keys, int nodeTot)
+{
+  if (!nodeTot) {
+    return nullptr;
+  }
+  int m = nodeTot / 2;
+  hedger::CowNode *node = NewNode(keys[m]);
+  node->left.store(BuildBalanced(keys, m), std::memory_order_relaxed);
+  node->right.store(BuildBalanced(keys + m + 1, nodeTot - m - 1), std::memory_order_relaxed);
+  return node;
+}
+
+// AddPrivate
+//
+// Insert into an unpublished subtree, if the key is not there yet.
+//
+// Entry: pointer to subtree root
+//        key
+void CowScapegoatTree::AddPrivate(hedger::CowNode **root, hedger::S_T key)
+{
+  hedger::CowNode *node = *root;
+  if (!node) {
+    *root = NewNode(key);
+    return;
+  }
+  while (node->key != key) {
+    std::atomic<hedger::CowNode *> &link = key < node->key ? node->left : node->right;
+    hedger::CowNode *next = link.load(std::memory_order_relaxed);
+    if (!next) {
+      link.store(NewNode(key), std::memory_order_relaxed);
+      return;
+    }
+    node = next;
+  }
+}
+
+// AddBalanced
+//
+// Insert sorted keys into an unpublished subtree middle first, so that a
+// run of keys landing in one gap, as a sorted stream does, hangs there
+// as a balanced subtree rather than a chain.
+//
+// Entry: pointer to subtree root
+//        keys in order
+//        number of keys
+void CowScapegoatTree::AddBalanced(hedger::CowNode **root, const hedger::S_T *keys, int keyTot)
+{
+  if (keyTot) {
+    int m = keyTot / 2;
+    AddPrivate(root, keys[m]);
+    AddBalanced(root, keys, m);
+    AddBalanced(root, keys + m + 1, keyTot - m - 1);
+  }
+}
+
+// DeletePrivate
+//
+// Delete from an unpublished subtree, if the key is there, overwriting
+// keys in place and freeing nodes straight to the pool, as no reader can
+// see them yet.  A buffered write only records the final state of its
+// key, so a key added and deleted again after the copy was made is not
+// in the copy.
+//
+// Entry: pointer to subtree root
+//        key
+void CowScapegoatTree::DeletePrivate(hedger::CowNode **root, hedger::S_T key)
+{
+  std::atomic<hedger::CowNode *> top(*root);
+  std::atomic<hedger::CowNode *> *link = &top;
+  hedger::CowNode *node = top.load(std::memory_order_relaxed);
+  while (node && node->key != key) {
+    link = key < node->key ? &node->left : &node->right;
+    node = link->load(std::memory_order_relaxed);
+  }
+  if (!node) {
+    return;
+  }
+  hedger::CowNode *left = node->left.load(std::memory_order_relaxed);
+  hedger::CowNode *right = node->right.load(std::memory_order_relaxed);
+  if (left && right) {
+    link = &node->right;
+    hedger::CowNode *succ = right;
+    hedger::CowNode *next;
+    while (nullptr != (next = succ->left.load(std::memory_order_relaxed))) {
+      link = &succ->left;
+      succ = next;
+    }
+    node->key = succ->key;
+    node = succ;
+    right = succ->right.load(std::memory_order_relaxed);
+    left = nullptr;
+  }
+  link->store(left ? left : right, std::memory_order_relaxed);
+  pool_.Free(node);
+  *root = top.load(std::memory_order_relaxed);
+}
+
+// RetireRecursive
+// Retire a whole unlinked subtree.
+// Entry: subtree root
+void CowScapegoatTree::RetireRecursive(hedger::CowNode *node)
+{
+  if (node) {
+    RetireRecursive(node->left.load(std::memory_order_relaxed));
+    RetireRecursive(node->right.load(std::memory_order_relaxed));
+    Retire(node);
+  }
+}
+
+// ReleaseRebuild
+// Entry: unused
+//        retired rebuild record
+void CowScapegoatTree::ReleaseRebuild(void *, void *rebuild)
+{
+  delete (hedger::CowRebuild *) rebuild;
+}
+} // namespace hedger
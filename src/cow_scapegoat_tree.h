@@ -0,0 +1,145 @@
+// cow_scapegoat_tree.h
+//
+// Implements a scapegoat tree whose rebuilds run on a background thread
+// and are swapped in copy-on-write under concurrent readers.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef COW_SCAPEGOAT_TREE_H_
+#define COW_SCAPEGOAT_TREE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "algo.h"
+#include "epoch.h"
+#include "node_pool.h"
+
+namespace hedger
+{
+// CowNode
+//
+// A published node's key never changes: a delete that would overwrite it
+// publishes a copy instead, so readers need no validation.
+struct CowNode
+{
+  CowNode(hedger::S_T newKey) : key(newKey), left(nullptr), right(nullptr) {}
+
+  hedger::S_T                     key;
+  std::atomic<hedger::CowNode *>  left;
+  std::atomic<hedger::CowNode *>  right;
+};
+
+// CowWrite
+//
+// A buffered write: whether the key is present afterwards, and when.
+struct CowWrite
+{
+  bool        present;
+  uint64_t    seq;
+};
+
+// CowRebuild
+//
+// One background rebuild.  The subtree under scapegoat is frozen: writes
+// that reach it are recorded in the overlay instead, and readers that
+// reach it check the overlay before searching the old nodes.
+struct CowRebuild
+{
+  CowRebuild(hedger::CowNode *root) : scapegoat(root), seq(0) {}
+
+  hedger::CowNode *                           scapegoat;
+  std::mutex                                  lock;       // guards overlay against readers
+  std::map<hedger::S_T, hedger::CowWrite>     overlay;
+  uint64_t                                    seq;        // writes buffered so far
+};
+
+// CowScapegoatTree
+//
+// Scapegoat tree for one writer at a time and any number of lock-free
+// readers.  Add applies the same depth bound as ScapegoatTree but only
+// posts the deep key to a rebuilder thread, which picks the scapegoat,
+// freezes its subtree, copies the keys into fresh balanced nodes, then
+// replays the writes buffered meanwhile and hangs the copy from the
+// scapegoat's parent with one pointer store.  Foreground writers only
+// ever wait for the rebuilder when a delete must copy a path through the
+// frozen subtree.  Removed nodes are retired through an EpochReclaimer.
+class CowScapegoatTree
+{
+ public:
+  CowScapegoatTree();
+  virtual ~CowScapegoatTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  void WaitIdle();
+  int Size() { return nodeTot_.load(std::memory_order_relaxed); }
+  std::size_t MemoryUsage() { return pool_.SlabBytes(); }
+  std::size_t RebuildTot() { return rebuildTot_.load(std::memory_order_relaxed); }
+  std::size_t BufferedTot() { return bufferedTot_.load(std::memory_order_relaxed); }
+  std::size_t SkippedRebuildTot() { return skippedTot_.load(std::memory_order_relaxed); }
+
+ protected:
+  static int const Log32(int q);
+  std::atomic<hedger::CowNode *> &Child(hedger::CowNode *node, hedger::S_T key);
+  hedger::CowNode *NewNode(hedger::S_T key);
+  void Retire(hedger::CowNode *node);
+  bool Buffer(hedger::CowRebuild *rebuild, hedger::S_T key, bool present);
+  static bool Contains(hedger::CowNode *node, hedger::S_T key);
+  hedger::CowNode *ParentOf(hedger::CowNode *node);
+  void PostRebuild(hedger::S_T key);
+  void Rebuilder();
+  void Rebuild(hedger::S_T key);
+  hedger::CowNode *FindScapegoat(hedger::S_T key);
+  int CountRecurse(hedger::CowNode *node);
+  void PackRecurse(hedger::CowNode *node, std::vector<hedger::S_T> *keys);
+  hedger::CowNode *BuildBalanced(const hedger::S_T *keys, int nodeTot);
+  void AddPrivate(hedger::CowNode **root, hedger::S_T key);
+  void AddBalanced(hedger::CowNode **root, const hedger::S_T *keys, int keyTot);
+  void DeletePrivate(hedger::CowNode **root, hedger::S_T key);
+  void RetireRecursive(hedger::CowNode *node);
+  static void ReleaseRebuild(void *, void *rebuild);
+
+  hedger::CowNode                     head_;          // sentinel; left is the root
+  std::atomic<int>                    nodeTot_;
+  std::mutex                          writeLock_;     // one writer at a time
+  std::atomic<hedger::CowRebuild *>   rebuild_;       // set while a subtree is frozen
+  std::atomic<std::size_t>            rebuildTot_;    // nodes copied by rebuilds
+  std::atomic<std::size_t>            bufferedTot_;   // writes buffered during rebuilds
+  std::atomic<std::size_t>            skippedTot_;    // rebuilds abandoned
+  hedger::NodePool                    pool_;          // outlives epoch_, which releases into it
+  hedger::EpochReclaimer              epoch_;
+  std::mutex                          requestLock_;   // guards the fields below
+  std::condition_variable             requestReady_;
+  std::condition_variable             idle_;
+  bool                                pending_;       // a rebuild is posted or running
+  bool                                stop_;
+  hedger::S_T                         requestKey_;
+  std::thread                         rebuilder_;
+};
+} // namespace hedger
+#endif // #ifndef COW_SCAPEGOAT_TREE_H_
@@ -0,0 +1,279 @@
+// csb_tree.cc
+//
+// Implements a read-optimized cache-sensitive B+tree (CSB+-tree).
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+#include <vector>
+
+#include "bplus_tree.h"
+#include "csb_tree.h"
+
+namespace hedger
+{
+// The node searches reuse the B+tree's 16-key SIMD kernels, which read
+// past the keys of a CSB+ node into the next one; the node arrays carry
+// one spare node so the last node can be searched too.
+static_assert(kCsbInnerKeys <= kBPlusKeys && kCsbLeafKeys <= kBPlusKeys,
+  "CSB+ nodes must fit the B+tree search kernels");
+static_assert(sizeof(hedger::CsbInner) == kCacheLine && sizeof(hedger::CsbLeaf) == kCacheLine,
+  "CSB+ nodes must be one cache line");
+
+// AllocNodes
+// Entry: number of 64-byte nodes
+// Exit:  zeroed, cache-line-aligned storage for them plus one spare
+static void *AllocNodes(std::size_t n)
+{
+  void *mem = nullptr;
+  if (posix_memalign(&mem, kCacheLine, (n + 1) * kCacheLine)) {
+    throw std::bad_alloc();
+  }
+  memset(mem, 0, (n + 1) * kCacheLine);
+  return mem;
+}
+
+// Constructor
+CsbTree::CsbTree()
+{
+  inner_ = nullptr;
+  leaves_ = nullptr;
+  innerTot_ = 0;
+  leafTot_ = 0;
+  height_ = 0;
+  treeTot_ = 0;
+  keyTot_ = 0;
+}
+
+// Destructor
+CsbTree::~CsbTree()
+{
+  FreeNodes();
+}
+
+// Build
+//
+// Replace the contents of the tree by bulk-loading sorted keys.  Leaves
+// are packed full; each inner level groups kCsbFanout consecutive nodes
+// of the level below, so every child group is contiguous.
+//
+// Entry: pointer to keys in ascending order
+//        number of keys
+void CsbTree::Build(const hedger::S_T *sorted, std::size_t n)
+{
+  FreeNodes();
+  pending_.clear();
+  treeTot_ = keyTot_ = n;
+  leafTot_ = (n + kCsbLeafKeys - 1) / kCsbLeafKeys;
+
+  // Inner level sizes, bottom-up
+  std::vector<std::size_t> levelTot;
+  for (std::size_t m = leafTot_; m > 1; ) {
+    m = (m + kCsbFanout - 1) / kCsbFanout;
+    levelTot.push_back(m);
+  }
+  height_ = (int) levelTot.size();
+  innerTot_ = 0;
+  for (std::size_t m : levelTot) {
+    innerTot_ += m;
+  }
+
+  leaves_ = (hedger::CsbLeaf *) AllocNodes(leafTot_);
+  inner_ = (hedger::CsbInner *) AllocNodes(innerTot_);
+
+  std::vector<hedger::S_T> mins(leafTot_);
+  for (std::size_t j = 0; j < leafTot_; j++) {
+    std::size_t first = j * kCsbLeafKeys;
+    std::size_t count = n - first < (std::size_t) kCsbLeafKeys ? n - first : kCsbLeafKeys;
+    leaves_[j].count = (int32_t) count;
+    memcpy(leaves_[j].keys, &sorted[first], count * sizeof(hedger::S_T));
+    mins[j] = sorted[first];
+  }
+
+  // Inner levels are stored root first; level l sits after all higher levels.
+  std::vector<std::size_t> offset(height_);
+  std::size_t at = 0;
+  for (int l = height_ - 1; l >= 0; l--) {
+    offset[l] = at;
+    at += levelTot[l];
+  }
+
+  for (int l = 0; l < height_; l++) {
+    std::size_t belowTot = l ? levelTot[l - 1] : leafTot_;
+    std::size_t belowOffset = l ? offset[l - 1] : 0;
+    for (std::size_t j = 0; j < levelTot[l]; j++) {
+      hedger::CsbInner *node = &inner_[offset[l] + j];
+      std::size_t first = j * kCsbFanout;
+      std::size_t last = first + kCsbFanout < belowTot ? first + kCsbFanout : belowTot;
+      node->count = (int32_t) (last - first - 1);
+      node->firstChild = (uint32_t) (belowOffset + first);
+      for (std::size_t i = first + 1; i < last; i++) {
+        node->keys[i - first - 1] = mins[i];
+      }
+      mins[j] = mins[first];
+    }
+  }
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == inserted, false == key already present
+bool CsbTree::Add(hedger::S_T key)
+{
+  if (Find(key)) {
+    return false;
+  }
+  auto it = pending_.find(key);
+  if (it != pending_.end()) {
+    pending_.erase(it);           // cancels a pending delete
+  } else {
+    pending_[key] = true;
+  }
+  keyTot_++;
+  FlushIfFull();
+  return true;
+}
+
+// DeleteKey
+//
+// Entry: key
+// Exit:  true == success
+bool CsbTree::DeleteKey(hedger::S_T key)
+{
+  if (!Find(key)) {
+    return false;
+  }
+  auto it = pending_.find(key);
+  if (it != pending_.end()) {
+    pending_.erase(it);           // cancels a pending insert
+  } else {
+    pending_[key] = false;
+  }
+  keyTot_--;
+  FlushIfFull();
+  return true;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool CsbTree::Find(hedger::S_T key)
+{
+  if (!pending_.empty()) {
+    auto it = pending_.find(key);
+    if (it != pending_.end()) {
+      return it->second;
+    }
+  }
+  return FindInTree(key);
+}
+
+// FindInTree
+//
+// Descend the packed levels.  Each inner node is one cache line and
+// the child is found by arithmetic on its group index.
+//
+// Entry: key
+// Exit:  true == key present in the built tree
+bool CsbTree::FindInTree(hedger::S_T key)
+{
+  if (!treeTot_) {
+    return false;
+  }
+  std::size_t index = 0;
+  for (int l = 0; l < height_; l++) {
+    hedger::CsbInner *node = &inner_[index];
+    index = node->firstChild + BPlusTree::CountLessEqual(node->keys, node->count, key);
+  }
+  hedger::CsbLeaf *leaf = &leaves_[index];
+  int pos = BPlusTree::CountLess(leaf->keys, leaf->count, key);
+  return pos < leaf->count && leaf->keys[pos] == key;
+}
+
+// Flush
+//
+// Merge the pending updates with the tree's keys and rebuild.
+void CsbTree::Flush()
+{
+  if (pending_.empty()) {
+    return;
+  }
+
+  std::vector<hedger::S_T> merged;
+  merged.reserve(keyTot_);
+  auto it = pending_.begin();
+  for (std::size_t j = 0; j < leafTot_; j++) {
+    for (int i = 0; i < leaves_[j].count; i++) {
+      hedger::S_T key = leaves_[j].keys[i];
+      for (; it != pending_.end() && it->first < key; ++it) {
+        merged.push_back(it->first);
+      }
+      if (it != pending_.end() && it->first == key) {
+        ++it;                     // pending delete
+        continue;
+      }
+      merged.push_back(key);
+    }
+  }
+  for (; it != pending_.end(); ++it) {
+    merged.push_back(it->first);
+  }
+  Build(merged.data(), merged.size());
+}
+
+// MemoryUsage
+//
+// Exit: bytes held by nodes; the pending buffer is not counted
+std::size_t CsbTree::MemoryUsage()
+{
+  return (innerTot_ + leafTot_) * kCacheLine;
+}
+
+//
+// Helper functions
+//
+
+// FlushIfFull
+// Apply the pending updates once there are enough of them.
+void CsbTree::FlushIfFull()
+{
+  std::size_t batch = treeTot_ >> kCsbBatchShift;
+  if (pending_.size() >= (batch > kCsbBatchMin ? batch : kCsbBatchMin)) {
+    Flush();
+  }
+}
+
+// FreeNodes
+// Release the node arrays.
+void CsbTree::FreeNodes()
+{
+  free(inner_);
+  free(leaves_);
+  inner_ = nullptr;
+  leaves_ = nullptr;
+  innerTot_ = leafTot_ = 0;
+  height_ = 0;
+  treeTot_ = 0;
+}
+} // namespace hedger
@@ -0,0 +1,101 @@
+// csb_tree.h
+//
+// Implements a read-optimized cache-sensitive B+tree (CSB+-tree).
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef CSB_TREE_H_
+#define CSB_TREE_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include <map>
+
+#include "algo.h"
+
+namespace hedger
+{
+// A whole node is one cache line: 14 keys per inner node, 15 per leaf.
+const int kCsbInnerKeys = 14;
+const int kCsbLeafKeys = 15;
+const int kCsbFanout = kCsbInnerKeys + 1;
+
+// Pending updates are applied once they reach 1 / 2^kCsbBatchShift of
+// the tree, and never fewer than kCsbBatchMin at a time.
+const int kCsbBatchShift = 3;
+const std::size_t kCsbBatchMin = 1024;
+
+// CsbInner
+//
+// Inner node: instead of one pointer per child, a single index to the
+// first node of its child group.  The group is contiguous, so child i
+// is firstChild + i.
+struct alignas(kCacheLine) CsbInner
+{
+  int32_t             count;                  // keys in use
+  uint32_t            firstChild;             // index of first child
+  hedger::S_T         keys[kCsbInnerKeys];    // child i holds keys >= keys[i - 1]
+};
+
+// CsbLeaf
+//
+// Leaves are stored in key order in one array, so the next leaf is the
+// next array element.
+struct alignas(kCacheLine) CsbLeaf
+{
+  int32_t             count;                  // keys in use
+  hedger::S_T         keys[kCsbLeafKeys];
+};
+
+// CsbTree
+//
+// The tree is bulk-built from sorted keys with every level packed into
+// contiguous arrays.  Add and DeleteKey are buffered in a pending map
+// that Find consults first; once the buffer is large enough, Flush()
+// merges it with the tree's keys and rebuilds.
+class CsbTree
+{
+ public:
+  CsbTree();
+  virtual ~CsbTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  void Flush();
+  void Build(const hedger::S_T *sorted, std::size_t n);
+  int Size() { return (int) keyTot_; }
+  std::size_t MemoryUsage();
+
+ protected:
+  bool FindInTree(hedger::S_T key);
+  void FlushIfFull();
+  void FreeNodes();
+
+  hedger::CsbInner *  inner_;       // inner levels, root first
+  hedger::CsbLeaf *   leaves_;      // leaves in key order
+  std::size_t         innerTot_;
+  std::size_t         leafTot_;
+  int                 height_;      // inner levels above the leaves
+  std::size_t         treeTot_;     // keys stored in the leaves
+  std::size_t         keyTot_;      // keys including pending updates
+  std::map<hedger::S_T, bool> pending_;   // true == insert, false == delete
+};
+} // namespace hedger
+#endif // #ifndef CSB_TREE_H_
@@ -0,0 +1,319 @@
+// epoch.cc
+//
+// Implements epoch-based reclamation: nodes unlinked from a concurrent
+// structure are freed once no thread can still be reading them.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+#include "epoch.h"
+
+namespace hedger
+{
+// Slot claims, shared by every reclaimer, and one past the highest
+// slot ever claimed, bounding the scan in TryAdvance
+static std::atomic<bool> slotClaimed[kEpochThreadMax];
+static std::atomic<int> slotHigh(0);
+
+// Live reclaimers, so that an exiting thread can go offline in each
+static std::mutex reclaimerLock;
+static std::vector<hedger::EpochReclaimer *> reclaimers;
+
+// Now
+// Exit:  steady clock in nanoseconds
+static inline int64_t Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Bump
+// Add to a counter only its owner writes.
+// Entry: counter
+//        amount
+static inline void Bump(std::atomic<uint64_t> *counter, uint64_t n)
+{
+  counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// EpochRegistration
+//
+// Claims a slot index for its thread; the thread_local instance gives it
+// back when the thread exits.
+struct EpochRegistration
+{
+  EpochRegistration()
+  {
+    for (index = 0; index < kEpochThreadMax; index++) {
+      bool expected = false;
+      if (slotClaimed[index].compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        break;
+      }
+    }
+    if (index == kEpochThreadMax) {
+      throw std::runtime_error("EpochReclaimer: too many threads");
+    }
+    int high = slotHigh.load(std::memory_order_relaxed);
+    while (high <= index && !slotHigh.compare_exchange_weak(high, index + 1)) {
+    }
+  }
+  ~EpochRegistration()
+  {
+    {
+      // A quiescent-mode thread is still online; nothing it read is
+      // reachable any more.
+      std::lock_guard<std::mutex> guard(reclaimerLock);
+      for (hedger::EpochReclaimer *reclaimer : reclaimers) {
+        reclaimer->slots_[index].depth = 0;
+        reclaimer->slots_[index].state.store(0, std::memory_order_release);
+      }
+    }
+    slotClaimed[index].store(false, std::memory_order_release);
+  }
+
+  int index;
+};
+
+// Constructor
+//
+// Entry: pinned (EBR) or quiescent (QSBR) mode
+EpochReclaimer::EpochReclaimer(hedger::EpochMode mode)
+{
+  void *mem;
+  if (posix_memalign(&mem, kCacheLine, kEpochThreadMax * sizeof(hedger::EpochSlot))) {
+    throw std::bad_alloc();
+  }
+  slots_ = (hedger::EpochSlot *) mem;
+  for (int i = 0; i < kEpochThreadMax; i++) {
+    hedger::EpochSlot *slot = new (&slots_[i]) hedger::EpochSlot();
+    slot->state = 0;
+    slot->depth = 0;
+    slot->retireTot = 0;
+    for (int b = 0; b < 3; b++) {
+      slot->limboEpoch[b] = 0;
+      slot->limboStart[b] = 0;
+      slot->limboBytes[b] = 0;
+    }
+    slot->retiredTot = 0;
+    slot->retiredBytes = 0;
+    slot->releasedTot = 0;
+    slot->releasedBytes = 0;
+    slot->lagEpochs = 0;
+    slot->lagNanos = 0;
+  }
+  mode_ = mode;
+  epoch_ = 0;
+  std::lock_guard<std::mutex> guard(reclaimerLock);
+  reclaimers.push_back(this);
+}
+
+// Destructor
+//
+// No other thread may be using the reclaimer; everything still in limbo
+// is released.
+EpochReclaimer::~EpochReclaimer()
+{
+  {
+    std::lock_guard<std::mutex> guard(reclaimerLock);
+    reclaimers.erase(std::find(reclaimers.begin(), reclaimers.end(), this));
+  }
+  uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+  for (int i = 0; i < kEpochThreadMax; i++) {
+    for (int b = 0; b < 3; b++) {
+      Release(&slots_[i], b, epoch);
+    }
+    slots_[i].~EpochSlot();
+  }
+  free(slots_);
+}
+
+// Enter
+//
+// Pin the calling thread, or bring it online in quiescent mode.  May
+// nest.
+void EpochReclaimer::Enter()
+{
+  hedger::EpochSlot &slot = slots_[ThreadIndex()];
+  if (0 == slot.depth++) {
+    if (kEpochQuiescent == mode_ && slot.state.load(std::memory_order_relaxed)) {
+      return;
+    }
+    slot.state.store(epoch_.load(std::memory_order_relaxed) << 1 | 1, std::memory_order_relaxed);
+    // The pin must be visible before any shared pointer is read.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+// Exit
+//
+// Once the outermost Enter is matched, unpin the calling thread, or in
+// quiescent mode announce that it holds no shared pointers.
+void EpochReclaimer::Exit()
+{
+  hedger::EpochSlot &slot = slots_[ThreadIndex()];
+  if (0 == --slot.depth) {
+    if (kEpochQuiescent == mode_) {
+      slot.state.store(epoch_.load(std::memory_order_relaxed) << 1 | 1, std::memory_order_release);
+    } else {
+      slot.state.store(0, std::memory_order_release);
+    }
+  }
+}
+
+// Offline
+//
+// Stop holding reclamation back until the next Enter.  Only needed in
+// quiescent mode, by a thread that goes idle without exiting.
+void EpochReclaimer::Offline()
+{
+  hedger::EpochSlot &slot = slots_[ThreadIndex()];
+  if (0 == slot.depth) {
+    slot.state.store(0, std::memory_order_release);
+  }
+}
+
+// Retire
+//
+// Hand over an object already unlinked from the shared structure.
+//
+// Entry: object
+//        function releasing it
+//        first argument to release, such as the NodePool it came from
+//        size in bytes, for Stats
+void EpochReclaimer::Retire(void *object, void (*release)(void *context, void *object),
+  void *context, std::size_t bytes)
+{
+  hedger::EpochSlot &slot = slots_[ThreadIndex()];
+  // Order the unlink before the epoch read, pairing with Enter's fence.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t epoch = epoch_.load(std::memory_order_acquire);
+  // Lists from two or more epochs back are safe; that includes the one
+  // this epoch's list reuses.
+  for (int b = 0; b < 3; b++) {
+    if (slot.limboEpoch[b] + 2 <= epoch) {
+      Release(&slot, b, epoch);
+    }
+  }
+  int b = (int) (epoch % 3);
+  if (slot.limbo[b].empty()) {
+    slot.limboEpoch[b] = epoch;
+    slot.limboStart[b] = Now();
+  }
+  slot.limbo[b].push_back({ object, context, release });
+  slot.limboBytes[b] += bytes;
+  Bump(&slot.retiredTot, 1);
+  Bump(&slot.retiredBytes, bytes);
+  if (0 == ++slot.retireTot % kEpochBatch) {
+    TryAdvance();
+  }
+}
+
+// Stats
+//
+// Counters are read without stopping other threads, so the totals are
+// a near-consistent sample.
+//
+// Entry: pointer to stats to fill in
+void EpochReclaimer::Stats(hedger::EpochStats *stats)
+{
+  uint64_t retired = 0;
+  uint64_t retiredBytes = 0;
+  uint64_t released = 0;
+  uint64_t releasedBytes = 0;
+  uint64_t lagEpochs = 0;
+  uint64_t lagNanos = 0;
+  int high = slotHigh.load(std::memory_order_acquire);
+  for (int i = 0; i < high; i++) {
+    released += slots_[i].releasedTot.load(std::memory_order_relaxed);
+    releasedBytes += slots_[i].releasedBytes.load(std::memory_order_relaxed);
+    lagEpochs += slots_[i].lagEpochs.load(std::memory_order_relaxed);
+    lagNanos += slots_[i].lagNanos.load(std::memory_order_relaxed);
+    retired += slots_[i].retiredTot.load(std::memory_order_relaxed);
+    retiredBytes += slots_[i].retiredBytes.load(std::memory_order_relaxed);
+  }
+  stats->epoch = epoch_.load(std::memory_order_relaxed);
+  stats->retiredTot = retired;
+  stats->releasedTot = released;
+  stats->pendingTot = retired > released ? retired - released : 0;
+  stats->pendingBytes = retiredBytes > releasedBytes ? retiredBytes - releasedBytes : 0;
+  stats->lagEpochs = released ? (double) lagEpochs / released : 0.0;
+  stats->lagMicros = released ? lagNanos / 1e3 / released : 0.0;
+}
+
+// ThreadIndex
+//
+// Exit:  the calling thread's slot index, shared by every reclaimer and
+//        node pool
+int EpochReclaimer::ThreadIndex()
+{
+  static thread_local hedger::EpochRegistration registration;
+  return registration.index;
+}
+
+//
+// Helper functions
+//
+
+// TryAdvance
+//
+// Move the global epoch on if every pinned thread has entered in it.
+void EpochReclaimer::TryAdvance()
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  uint64_t epoch = epoch_.load(std::memory_order_acquire);
+  int high = slotHigh.load(std::memory_order_acquire);
+  for (int i = 0; i < high; i++) {
+    uint64_t state = slots_[i].state.load(std::memory_order_acquire);
+    if ((state & 1) && (state >> 1) != epoch) {
+      return;
+    }
+  }
+  epoch_.compare_exchange_strong(epoch, epoch + 1, std::memory_order_acq_rel);
+}
+
+// Release
+//
+// Entry: slot
+//        limbo list to release and empty
+//        current epoch, for the lag counters
+void EpochReclaimer::Release(hedger::EpochSlot *slot, int b, uint64_t epoch)
+{
+  std::vector<hedger::EpochRetired> &limbo = slot->limbo[b];
+  if (limbo.empty()) {
+    return;
+  }
+  for (const hedger::EpochRetired &retired : limbo) {
+    retired.release(retired.context, retired.object);
+  }
+  uint64_t n = limbo.size();
+  Bump(&slot->releasedTot, n);
+  Bump(&slot->releasedBytes, slot->limboBytes[b]);
+  Bump(&slot->lagEpochs, n * (epoch - slot->limboEpoch[b]));
+  Bump(&slot->lagNanos, n * (uint64_t) (Now() - slot->limboStart[b]));
+  limbo.clear();
+  slot->limboBytes[b] = 0;
+}
+} // namespace hedger
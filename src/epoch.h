@@ -0,0 +1,158 @@
+// epoch.h
+//
+// Implements epoch-based reclamation: nodes unlinked from a concurrent
+// structure are freed once no thread can still be reading them.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef EPOCH_H_
+#define EPOCH_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Threads that may use reclaimers at once
+const int kEpochThreadMax = 256;
+
+// Retires between attempts to advance the global epoch
+const int kEpochBatch = 64;
+
+// EpochMode
+//
+// Pinned (EBR): a thread is pinned only between Enter and Exit, and
+// Enter pays a full fence.  Quiescent (QSBR): a thread stays online from
+// its first Enter until Offline or thread exit, Enter is free, and Exit
+// just announces a quiescent state with a plain store.  An online thread
+// that stops calling Exit holds reclamation back for everyone.
+enum EpochMode
+{
+  kEpochPinned,
+  kEpochQuiescent
+};
+
+// EpochRetired
+//
+// A removed object and how to release it.
+struct EpochRetired
+{
+  void *      object;
+  void *      context;
+  void        (*release)(void *context, void *object);
+};
+
+// EpochStats
+//
+// Totals over every thread.  Lag is measured from the first retire into
+// each limbo list, so it is an upper bound for the objects behind it.
+struct EpochStats
+{
+  uint64_t        epoch;
+  std::size_t     retiredTot;       // objects retired
+  std::size_t     releasedTot;      // objects released
+  std::size_t     pendingTot;       // retired, not yet released
+  std::size_t     pendingBytes;
+  double          lagEpochs;        // mean epochs from retire to release
+  double          lagMicros;        // mean microseconds from retire to release
+};
+
+// EpochSlot
+//
+// One thread's view.  state is written by its owner and read by threads
+// advancing the epoch; the limbo lists are the owner's alone, and the
+// counters are written by the owner and read by Stats.
+struct alignas(kCacheLine) EpochSlot
+{
+  std::atomic<uint64_t>               state;          // epoch << 1 | 1 while pinned or online, 0 idle
+  int                                 depth;          // Enter nesting
+  std::size_t                         retireTot;
+  uint64_t                            limboEpoch[3];
+  int64_t                             limboStart[3];  // steady clock ns at first retire
+  std::size_t                         limboBytes[3];
+  std::vector<hedger::EpochRetired>   limbo[3];       // retired in limboEpoch[i]
+  std::atomic<uint64_t>               retiredTot;
+  std::atomic<uint64_t>               retiredBytes;
+  std::atomic<uint64_t>               releasedTot;
+  std::atomic<uint64_t>               releasedBytes;
+  std::atomic<uint64_t>               lagEpochs;      // summed over released objects
+  std::atomic<uint64_t>               lagNanos;
+};
+
+// EpochReclaimer
+//
+// A thread calls Enter before touching shared nodes and Exit when done;
+// in between it is pinned to the epoch it entered in.  Objects are
+// retired into the caller's limbo list for the current epoch.  The
+// global epoch moves on only when every pinned thread has seen it, so
+// once it has moved on twice no thread can still hold a pointer to an
+// object retired back then, and that list is released.
+//
+// Threads are given slots on first use and give them back on exit,
+// going offline in every live reclaimer as they do.  A thread's limbo
+// lists stay with its slot until the next thread to take the slot
+// retires something, or the reclaimer goes.
+class EpochReclaimer
+{
+  friend struct EpochRegistration;
+
+ public:
+  EpochReclaimer(hedger::EpochMode mode = kEpochPinned);
+  virtual ~EpochReclaimer();
+
+  void Enter();
+  void Exit();
+  void Offline();
+  void Retire(void *object, void (*release)(void *context, void *object), void *context = nullptr,
+    std::size_t bytes = 0);
+  void Stats(hedger::EpochStats *stats);
+  uint64_t Epoch() { return epoch_.load(std::memory_order_relaxed); }
+  hedger::EpochMode Mode() { return mode_; }
+
+  static int ThreadIndex();
+
+ protected:
+  void TryAdvance();
+  void Release(hedger::EpochSlot *slot, int b, uint64_t epoch);
+
+  hedger::EpochMode       mode_;
+  std::atomic<uint64_t>   epoch_;
+  hedger::EpochSlot *     slots_;         // kEpochThreadMax
+};
+
+// EpochGuard
+//
+// Brackets one operation: pins the calling thread for the guard's
+// lifetime, or in quiescent mode announces a quiescent state at its end.
+class EpochGuard
+{
+ public:
+  EpochGuard(hedger::EpochReclaimer &reclaimer) : reclaimer_(reclaimer) { reclaimer_.Enter(); }
+  ~EpochGuard() { reclaimer_.Exit(); }
+
+ private:
+  hedger::EpochReclaimer &reclaimer_;
+};
+} // namespace hedger
+#endif // #ifndef EPOCH_H_
@@ -0,0 +1,160 @@
+// eytzinger_index.cc
+//
+// Implements an immutable search index stored in Eytzinger (BFS) order.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdlib.h>
+
+#include <new>
+
+#include "eytzinger_index.h"
+
+namespace hedger
+{
+// Slots per cache line; slot k * kPrefetchStride is four levels below k.
+static const std::size_t kPrefetchStride = kCacheLine / sizeof(hedger::S_T);
+
+// Constructor
+//
+// Permute a sorted key array into BFS order.
+//
+// Entry: pointer to keys in ascending order
+//        number of keys
+EytzingerIndex::EytzingerIndex(const hedger::S_T *sorted, std::size_t n)
+{
+  void *mem = nullptr;
+  if (posix_memalign(&mem, kCacheLine, (n + 1) * sizeof(hedger::S_T))) {
+    throw std::bad_alloc();
+  }
+  keys_ = (hedger::S_T *) mem;
+  keys_[0] = 0;
+  n_ = n;
+  height_ = 0;
+  for (std::size_t k = n; k; k >>= 1) {
+    height_++;
+  }
+  Build(sorted, 0, 1);
+}
+
+// Destructor
+EytzingerIndex::~EytzingerIndex()
+{
+  free(keys_);
+}
+
+// Build
+//
+// In-order walk of the implicit tree, filling slots from the sorted
+// array.  Calls itself recursively.
+//
+// Entry: pointer to sorted keys
+//        next index in sorted array
+//        current slot
+// Exit:  next index in sorted array
+std::size_t EytzingerIndex::Build(const hedger::S_T *sorted, std::size_t i, std::size_t k)
+{
+  if (k <= n_) {
+    i = Build(sorted, i, 2 * k);
+    keys_[k] = sorted[i++];
+    i = Build(sorted, i, 2 * k + 1);
+  }
+  return i;
+}
+
+// LowerBoundSlot
+//
+// Branchless descent: each step moves to child 2k or 2k + 1 depending on
+// a comparison, never on a branch.  Once the walk falls off the bottom,
+// the trailing right turns plus the final left turn are stripped off k,
+// leaving the slot where the walk last went left.
+//
+// Entry: key
+// Exit:  slot of the smallest key >= key, or 0 if there is none
+std::size_t EytzingerIndex::LowerBoundSlot(hedger::S_T key)
+{
+  std::size_t k = 1;
+  while (k <= n_) {
+    __builtin_prefetch(keys_ + k * kPrefetchStride);
+    k = 2 * k + (keys_[k] < key);
+  }
+  k >>= __builtin_ffsll(~k);
+  return k;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool EytzingerIndex::Find(hedger::S_T key)
+{
+  std::size_t k = LowerBoundSlot(key);
+  return k && keys_[k] == key;
+}
+
+// LowerBound
+//
+// Entry: key
+// Exit:  pointer to the smallest key >= key, or nullptr if there is none
+const hedger::S_T *EytzingerIndex::LowerBound(hedger::S_T key)
+{
+  std::size_t k = LowerBoundSlot(key);
+  return k ? &keys_[k] : nullptr;
+}
+
+// FindBatch
+//
+// Look up a batch of keys, descending kEytzingerBatch of them in
+// lockstep so their cache misses overlap.
+//
+// Entry: pointer to keys to find
+//        number of keys
+//        pointer to per-key result array, or nullptr
+// Exit:  number of keys found
+std::size_t EytzingerIndex::FindBatch(const hedger::S_T *keys, std::size_t n, bool *found)
+{
+  std::size_t hits = 0;
+  std::size_t k[kEytzingerBatch];
+
+  for (std::size_t base = 0; base < n; base += kEytzingerBatch) {
+    std::size_t m = n - base < (std::size_t) kEytzingerBatch ? n - base : kEytzingerBatch;
+    const hedger::S_T *batch = keys + base;
+    for (std::size_t j = 0; j < m; j++) {
+      k[j] = 1;
+    }
+    for (int level = 0; level < height_; level++) {
+      for (std::size_t j = 0; j < m; j++) {
+        if (k[j] <= n_) {
+          __builtin_prefetch(keys_ + k[j] * kPrefetchStride);
+          k[j] = 2 * k[j] + (keys_[k[j]] < batch[j]);
+        }
+      }
+    }
+    for (std::size_t j = 0; j < m; j++) {
+      std::size_t slot = k[j] >> __builtin_ffsll(~k[j]);
+      bool hit = slot && keys_[slot] == batch[j];
+      if (found) {
+        found[base + j] = hit;
+      }
+      hits += hit;
+    }
+  }
+  return hits;
+}
+} // namespace hedger
@@ -0,0 +1,62 @@
+// eytzinger_index.h
+//
+// Implements an immutable search index stored in Eytzinger (BFS) order.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef EYTZINGER_INDEX_H_
+#define EYTZINGER_INDEX_H_
+
+#include <cstddef>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Keys handled in lockstep by FindBatch
+const int kEytzingerBatch = 8;
+
+// EytzingerIndex
+//
+// Keys live in a 1-based array where the children of slot k are 2k and
+// 2k + 1.  The top levels of the implicit tree share a handful of cache
+// lines, and the 16 descendants four levels below slot k are contiguous,
+// so a descent can prefetch them before it needs them.
+class EytzingerIndex
+{
+ public:
+  EytzingerIndex(const hedger::S_T *sorted, std::size_t n);
+  virtual ~EytzingerIndex();
+
+  bool Find(hedger::S_T key);
+  const hedger::S_T *LowerBound(hedger::S_T key);
+  std::size_t FindBatch(const hedger::S_T *keys, std::size_t n, bool *found);
+  std::size_t Size() { return n_; }
+  std::size_t MemoryUsage() { return (n_ + 1) * sizeof(hedger::S_T); }
+
+ protected:
+  std::size_t LowerBoundSlot(hedger::S_T key);
+  std::size_t Build(const hedger::S_T *sorted, std::size_t i, std::size_t k);
+
+  hedger::S_T *   keys_;    // keys_[1..n_] in BFS order; keys_[0] unused
+  std::size_t     n_;
+  int             height_;
+};
+} // namespace hedger
+#endif // #ifndef EYTZINGER_INDEX_H_
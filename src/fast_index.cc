@@ -0,0 +1,235 @@
+// fast_index.cc
+//
+// Implements an immutable search tree in the FAST (Fast Architecture
+// Sensitive Tree) blocked layout.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <new>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "fast_index.h"
+
+namespace hedger
+{
+// Spare slots after the tree so a SIMD block at the end can be loaded
+// a whole register at a time.
+static const std::size_t kFastSpare = 8;
+
+// Constructor
+//
+// Entry: pointer to keys in ascending order
+//        number of keys
+//        SIMD block depth, 1 to kFastMaxSimdDepth
+//        cache line block depth, 0 == none
+//        page block depth, 0 == none
+FastIndex::FastIndex(const hedger::S_T *sorted, std::size_t n, int simdDepth,
+  int lineDepth, int pageDepth)
+{
+  if (simdDepth < 1 || simdDepth > kFastMaxSimdDepth) {
+    throw std::invalid_argument("FastIndex: SIMD block depth must be 1 to 3");
+  }
+  // A disabled level takes the depth of the next finer one, which leaves
+  // the layout unchanged: each of its blocks is a single finer block.
+  simdDepth_ = simdDepth;
+  lineDepth_ = lineDepth > simdDepth_ ? lineDepth : simdDepth_;
+  pageDepth_ = pageDepth > lineDepth_ ? pageDepth : lineDepth_;
+
+  n_ = n;
+  height_ = 0;
+  for (std::size_t k = n; k; k >>= 1) {
+    height_++;
+  }
+  if (height_ > kFastMaxHeight) {
+    throw std::length_error("FastIndex: too many keys");
+  }
+  slotTot_ = ((std::size_t) 1 << height_) - 1;
+
+  void *mem = nullptr;
+  if (posix_memalign(&mem, kCacheLine, (slotTot_ + kFastSpare) * sizeof(hedger::S_T))) {
+    throw std::bad_alloc();
+  }
+  keys_ = (hedger::S_T *) mem;
+  for (std::size_t i = 0; i < kFastSpare; i++) {
+    keys_[slotTot_ + i] = INT_MAX;
+  }
+  if (height_) {
+    Place(sorted, 0, 1, 1, height_, 0);
+  }
+}
+
+// Destructor
+FastIndex::~FastIndex()
+{
+  free(keys_);
+}
+
+// Place
+//
+// Lay out the subtree of the given height rooted at BFS node root,
+// starting at slot base: its top block (recursively, at the next finer
+// level), then each subtree below the top block.  Calls itself
+// recursively.
+//
+// Entry: pointer to sorted keys
+//        first slot of the subtree
+//        BFS index of the subtree root
+//        depth of the subtree root (root of the tree == 1)
+//        height of the subtree
+//        block level: 0 == page, 1 == line, 2 == SIMD
+void FastIndex::Place(const hedger::S_T *sorted, std::size_t base, std::size_t root,
+  int rootDepth, int height, int level)
+{
+  int blockDepth = 0 == level ? pageDepth_ : 1 == level ? lineDepth_ : simdDepth_;
+  int d = blockDepth < height ? blockDepth : height;
+  std::size_t topSize = ((std::size_t) 1 << d) - 1;
+  std::size_t bottomSize = ((std::size_t) 1 << (height - d)) - 1;
+
+  if (2 == level) {
+    // SIMD block: BFS order within the block
+    for (std::size_t j = 1; j <= topSize; j++) {
+      int depth = 63 - __builtin_clzll(j);
+      std::size_t bfs = (root << depth) + (j - ((std::size_t) 1 << depth));
+      int treeDepth = rootDepth + depth;
+      std::size_t offset = bfs - ((std::size_t) 1 << (treeDepth - 1));
+      std::size_t rank = ((2 * offset + 1) << (height_ - treeDepth)) - 1;
+      keys_[base + j - 1] = rank < n_ ? sorted[rank] : INT_MAX;
+    }
+  } else {
+    Place(sorted, base, root, rootDepth, d, level + 1);
+  }
+
+  if (height > d) {
+    for (std::size_t c = 0; c <= topSize; c++) {
+      Place(sorted, base + topSize + c * bottomSize, (root << d) + c, rootDepth + d,
+        height - d, level);
+    }
+  }
+}
+
+// LowerBoundSlot
+//
+// Walk page blocks, the line blocks inside each, and the SIMD blocks
+// inside each line block.  A SIMD block is a complete search tree, so
+// the number of its keys below the search key, one vector compare and a
+// popcount, is the child the walk exits into, and the key of that
+// in-order rank within the block is the best candidate so far.  On
+// leaving the whole tree the walk index less 2^height is the rank of the
+// lower bound among all slots.
+//
+// Entry: key
+// Exit:  slot of the smallest key >= key, or slotTot_ if there is none
+std::size_t FastIndex::LowerBoundSlot(hedger::S_T key)
+{
+  // In-order rank within a SIMD block -> BFS position, by block depth
+  static const uint8_t kInOrder[kFastMaxSimdDepth + 1][8] = {
+    { 0 },
+    { 0 },
+    { 1, 0, 2 },
+    { 3, 1, 4, 0, 5, 2, 6 }
+  };
+#if defined(__AVX2__)
+  __m256i k = _mm256_set1_epi32(key);
+#elif defined(__SSE2__)
+  __m128i k = _mm_set1_epi32(key);
+#endif
+  std::size_t bfs = 1;
+  std::size_t best = slotTot_;
+
+  std::size_t pageBase = 0;
+  for (int pageHeight = height_; pageHeight > 0; ) {
+    int pd = pageDepth_ < pageHeight ? pageDepth_ : pageHeight;
+    std::size_t pageRoot = bfs;
+
+    std::size_t lineBase = pageBase;
+    for (int lineHeight = pd; lineHeight > 0; ) {
+      int ld = lineDepth_ < lineHeight ? lineDepth_ : lineHeight;
+      std::size_t lineRoot = bfs;
+
+      std::size_t simdBase = lineBase;
+      for (int simdHeight = ld; simdHeight > 0; ) {
+        int sd = simdDepth_ < simdHeight ? simdDepth_ : simdHeight;
+        unsigned int topSize = (1u << sd) - 1;
+        const hedger::S_T *block = &keys_[simdBase];
+        unsigned int mask;
+#if defined(__AVX2__)
+        mask = (unsigned int) _mm256_movemask_ps(_mm256_castsi256_ps(
+          _mm256_cmpgt_epi32(k, _mm256_loadu_si256((const __m256i *) block))));
+#elif defined(__SSE2__)
+        mask = (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(
+          _mm_cmpgt_epi32(k, _mm_loadu_si128((const __m128i *) block))));
+        if (sd > 2) {
+          mask |= (unsigned int) _mm_movemask_ps(_mm_castsi128_ps(
+            _mm_cmpgt_epi32(k, _mm_loadu_si128((const __m128i *) (block + 4))))) << 4;
+        }
+#else
+        mask = 0;
+        for (unsigned int j = 0; j < topSize; j++) {
+          mask |= (unsigned int) (key > block[j]) << j;
+        }
+#endif
+        unsigned int c = __builtin_popcount(mask & ((1u << topSize) - 1));
+        best = c < topSize ? simdBase + kInOrder[sd][c] : best;
+        bfs = (bfs << sd) + c;
+        simdBase += topSize + c * ((1u << (simdHeight - sd)) - 1);
+        simdHeight -= sd;
+      }
+
+      lineBase += ((std::size_t) 1 << ld) - 1 +
+        (bfs - (lineRoot << ld)) * (((std::size_t) 1 << (lineHeight - ld)) - 1);
+      lineHeight -= ld;
+    }
+
+    pageBase += ((std::size_t) 1 << pd) - 1 +
+      (bfs - (pageRoot << pd)) * (((std::size_t) 1 << (pageHeight - pd)) - 1);
+    pageHeight -= pd;
+  }
+
+  // Slots past the real keys hold INT_MAX padding.
+  return bfs - ((std::size_t) 1 << height_) < n_ ? best : slotTot_;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool FastIndex::Find(hedger::S_T key)
+{
+  std::size_t slot = LowerBoundSlot(key);
+  return slot < slotTot_ && keys_[slot] == key;
+}
+
+// LowerBound
+//
+// Entry: key
+// Exit:  pointer to the smallest key >= key, or nullptr if there is none
+const hedger::S_T *FastIndex::LowerBound(hedger::S_T key)
+{
+  std::size_t slot = LowerBoundSlot(key);
+  return slot < slotTot_ ? &keys_[slot] : nullptr;
+}
+} // namespace hedger
@@ -0,0 +1,76 @@
+// fast_index.h
+//
+// Implements an immutable search tree in the FAST (Fast Architecture
+// Sensitive Tree) blocked layout.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef FAST_INDEX_H_
+#define FAST_INDEX_H_
+
+#include <cstddef>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Default block depths: 3 keys per SSE register, 15 keys per 64-byte
+// line, 1023 keys per 4KB page.
+const int kFastSimdDepth = 2;
+const int kFastLineDepth = 4;
+const int kFastPageDepth = 10;
+const int kFastMaxSimdDepth = 3;    // 7 keys, one AVX2 register
+const int kFastMaxHeight = 48;
+
+// FastIndex
+//
+// A complete binary search tree, padded to full height, is cut into
+// page-sized blocks, each page block into cache-line blocks, and each
+// line block into SIMD blocks.  At every level the top block is stored
+// first, followed by the subtrees hanging below it in key order.  Keys
+// of a SIMD block are stored in BFS order and compared against the
+// search key with one vector compare; the resulting bit mask picks the
+// exit child.  Any block level can be disabled by giving it depth 0.
+class FastIndex
+{
+ public:
+  FastIndex(const hedger::S_T *sorted, std::size_t n, int simdDepth = kFastSimdDepth,
+    int lineDepth = kFastLineDepth, int pageDepth = kFastPageDepth);
+  virtual ~FastIndex();
+
+  bool Find(hedger::S_T key);
+  const hedger::S_T *LowerBound(hedger::S_T key);
+  std::size_t Size() { return n_; }
+  std::size_t MemoryUsage() { return slotTot_ * sizeof(hedger::S_T); }
+
+ protected:
+  void Place(const hedger::S_T *sorted, std::size_t base, std::size_t root, int rootDepth,
+    int height, int level);
+  std::size_t LowerBoundSlot(hedger::S_T key);
+
+  hedger::S_T *   keys_;                  // slots in blocked order
+  std::size_t     n_;                     // real keys
+  std::size_t     slotTot_;               // 2^height_ - 1
+  int             height_;
+  int             simdDepth_;             // block depths, in levels
+  int             lineDepth_;
+  int             pageDepth_;
+};
+} // namespace hedger
+#endif // #ifndef FAST_INDEX_H_
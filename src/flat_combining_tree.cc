@@ -0,0 +1,183 @@
+// flat_combining_tree.cc
+//
+// Implements a flat-combining wrapper around ScapegoatTree.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <new>
+#include <thread>
+
+#include "epoch.h"
+#include "flat_combining_tree.h"
+
+namespace hedger
+{
+// Constructor
+FlatCombiningTree::FlatCombiningTree()
+{
+  void *mem;
+  if (posix_memalign(&mem, kCacheLine, kEpochThreadMax * sizeof(hedger::CombineSlot))) {
+    throw std::bad_alloc();
+  }
+  slots_ = (hedger::CombineSlot *) mem;
+  for (int i = 0; i < kEpochThreadMax; i++) {
+    hedger::CombineSlot *slot = new (&slots_[i]) hedger::CombineSlot();
+    slot->state = kCombineIdle;
+    slot->key = 0;
+    slot->result = false;
+  }
+  slotTot_ = 0;
+  combineTot_ = 0;
+  combinedTot_ = 0;
+}
+
+// Destructor
+//
+// No other thread may be using the tree.
+FlatCombiningTree::~FlatCombiningTree()
+{
+  for (int i = 0; i < kEpochThreadMax; i++) {
+    slots_[i].~CombineSlot();
+  }
+  free(slots_);
+}
+
+// MemoryUsage
+//
+// Exit:  bytes held by the tree and the request slots
+std::size_t FlatCombiningTree::MemoryUsage()
+{
+  std::lock_guard<std::mutex> guard(lock_);
+  return tree_.MemoryUsage() + kEpochThreadMax * sizeof(hedger::CombineSlot);
+}
+
+//
+// Helper functions
+//
+
+// Request
+//
+// Post a request in the calling thread's slot, then either combine or
+// wait for a combiner to complete it.
+//
+// Entry: operation
+//        key
+// Exit:  result of the operation
+bool FlatCombiningTree::Request(hedger::CombineState op, hedger::S_T key)
+{
+  int index = EpochReclaimer::ThreadIndex();
+  hedger::CombineSlot *slot = &slots_[index];
+  int slotTot = slotTot_.load(std::memory_order_relaxed);
+  while (slotTot <= index && !slotTot_.compare_exchange_weak(slotTot, index + 1)) {
+  }
+  slot->key = key;
+  slot->state.store(op, std::memory_order_release);
+
+  while (kCombineDone != slot->state.load(std::memory_order_acquire)) {
+    if (lock_.try_lock()) {
+      Combine();
+      lock_.unlock();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  bool result = slot->result;
+  slot->state.store(kCombineIdle, std::memory_order_relaxed);
+  return result;
+}
+
+// Combine
+//
+// Gather the pending requests, sort them by key and apply them in one
+// sweep.  Each operation starts from the node the previous one left
+// behind, which is still in the tree: a found or added node, or for a
+// delete the deleted node's parent, unless the node had two children and
+// so stays in place holding its successor's key.  Adds skip the
+// scapegoat depth test, which runs once for the batch at the end (or
+// before a delete).  A batch adding a large share of the tree's keys
+// merges them in with one balanced Build instead.  Called with the lock
+// held.
+void FlatCombiningTree::Combine()
+{
+  batch_.clear();
+  int slotTot = slotTot_.load(std::memory_order_acquire);
+  std::size_t addTot = 0;
+  for (int i = 0; i < slotTot; i++) {
+    int state = slots_[i].state.load(std::memory_order_acquire);
+    if (kCombineIdle != state && kCombineDone != state) {
+      batch_.push_back(hedger::CombineRequest { slots_[i].key, state, &slots_[i] });
+      addTot += kCombineAdd == state;
+    }
+  }
+  std::sort(batch_.begin(), batch_.end(),
+    [](const hedger::CombineRequest &a, const hedger::CombineRequest &b) {
+      return a.key < b.key;
+    });
+
+  // Requests in one batch are concurrent, so the adds may all take
+  // effect after the rest
+  bool build = addTot >= kCombineBuildMin && addTot * kCombineBuildShare >= (std::size_t) tree_.Size();
+  addKeys_.clear();
+  hedger::Node *hint = nullptr;
+  for (const auto &request : batch_) {
+    hedger::Node *node = tree_.Find(request.key, hint);
+    bool result = node != nullptr;
+    if (node) {
+      hint = node;
+    }
+    if (kCombineAdd == request.state) {
+      if (build) {
+        result = !node && (addKeys_.empty() || addKeys_.back() != request.key);
+        if (result) {
+          addKeys_.push_back(request.key);
+        }
+      } else {
+        result = !node;
+        if (!node) {
+          hint = tree_.AddDeferred(request.key, hint);
+        }
+      }
+    } else if (kCombineDelete == request.state && node) {
+      // Pending depth tests may rebuild around node, so they run before
+      // the hint is chosen from its children
+      tree_.CheckDeferred();
+      hint = (node->left && node->right) ? node : node->parent;
+      tree_.DeleteNode(node, request.key);
+    }
+    request.slot->result = result;
+  }
+  if (build) {
+    tree_.Build(addKeys_.data(), addKeys_.size());
+  } else {
+    tree_.CheckDeferred();
+  }
+
+  // Results are published once the tree is whole again
+  for (const auto &request : batch_) {
+    request.slot->state.store(kCombineDone, std::memory_order_release);
+  }
+  // Only the combiner writes the counters, so no read-modify-write
+  combineTot_.store(combineTot_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  combinedTot_.store(combinedTot_.load(std::memory_order_relaxed) + batch_.size(),
+    std::memory_order_relaxed);
+}
+} // namespace hedger
@@ -0,0 +1,111 @@
+// flat_combining_tree.h
+//
+// Implements a flat-combining wrapper around ScapegoatTree.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef FLAT_COMBINING_TREE_H_
+#define FLAT_COMBINING_TREE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "algo.h"
+#include "scapegoat_tree.h"
+
+namespace hedger
+{
+// A combining pass whose adds number at least kCombineBuildMin and one
+// kCombineBuildShare-th of the tree rebuilds it with them in one Build
+const std::size_t kCombineBuildMin = 16;
+const std::size_t kCombineBuildShare = 8;
+
+enum CombineState
+{
+  kCombineIdle,                 // slot free for its owner's next request
+  kCombineAdd,                  // request posted, not yet applied
+  kCombineFind,
+  kCombineDelete,
+  kCombineDone                  // applied; result is valid
+};
+
+// CombineSlot
+//
+// One thread's request.  Only the owner posts into it and only the
+// combiner completes it; each sits on its own cache line.
+struct alignas(kCacheLine) CombineSlot
+{
+  std::atomic<int>    state;    // CombineState
+  hedger::S_T         key;
+  bool                result;
+};
+
+// CombineRequest
+//
+// A pending request gathered by the combiner.
+struct CombineRequest
+{
+  hedger::S_T         key;
+  int                 state;
+  hedger::CombineSlot *slot;
+};
+
+// FlatCombiningTree
+//
+// Threads post Add, Find and DeleteKey requests into per-thread slots
+// instead of queueing on the lock.  Whichever thread takes the lock
+// becomes the combiner: it gathers every pending request, sorts them by
+// key and applies the batch in one ascending sweep, starting each
+// operation from the node the previous one touched (finger search), so
+// neighbouring keys share most of their descent.  The scapegoat depth
+// test runs once per batch rather than once per add, and a batch adding
+// many keys to a small tree merges them in with one Build.  Other
+// threads only watch their own slot until their request is done or the
+// lock is free.
+// Add and DeleteKey report whether the set changed, as in LockedTree.
+class FlatCombiningTree
+{
+ public:
+  FlatCombiningTree();
+  virtual ~FlatCombiningTree();
+
+  bool Add(hedger::S_T key) { return Request(kCombineAdd, key); }
+  bool Find(hedger::S_T key) { return Request(kCombineFind, key); }
+  bool DeleteKey(hedger::S_T key) { return Request(kCombineDelete, key); }
+  std::size_t MemoryUsage();
+  std::size_t CombineTot() { return combineTot_.load(std::memory_order_relaxed); }
+  std::size_t CombinedTot() { return combinedTot_.load(std::memory_order_relaxed); }
+
+ protected:
+  bool Request(hedger::CombineState op, hedger::S_T key);
+  void Combine();
+
+  hedger::CombineSlot *               slots_;       // kEpochThreadMax, by thread slot
+  std::atomic<int>                    slotTot_;     // slots ever used
+  std::mutex                          lock_;        // held by the combiner
+  hedger::ScapegoatTree               tree_;
+  std::vector<hedger::CombineRequest> batch_;       // combiner's scratch
+  std::vector<hedger::S_T>            addKeys_;     // keys a batch Build merges in
+  std::atomic<std::size_t>            combineTot_;  // combining passes
+  std::atomic<std::size_t>            combinedTot_; // requests applied
+};
+} // namespace hedger
+#endif // #ifndef FLAT_COMBINING_TREE_H_
@@ -0,0 +1,228 @@
+// learned_index.cc
+//
+// Implements an immutable learned index: a RadixSpline model over a
+// sorted key snapshot.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <new>
+
+#include "learned_index.h"
+
+namespace hedger
+{
+//
+// Helper functions
+//
+
+// Orientation
+//
+// Sign of the turn from vector (dx1, dy1) to vector (dx2, dy2).  Exact:
+// key differences need 33 bits and position differences 40 at most.
+//
+// Exit:  > 0 == clockwise, < 0 == counterclockwise, 0 == collinear
+static int Orientation(int64_t dx1, int64_t dy1, int64_t dx2, int64_t dy2)
+{
+  __int128 expr = (__int128) dy1 * dx2 - (__int128) dy2 * dx1;
+  return expr > 0 ? 1 : expr < 0 ? -1 : 0;
+}
+
+// Constructor
+//
+// Copies the keys and fits the spline in the same pass.
+//
+// Entry: pointer to keys in ascending order, no duplicates
+//        number of keys
+//        maximum prediction error, in positions
+//        radix table bits
+LearnedIndex::LearnedIndex(const hedger::S_T *sorted, std::size_t n, int maxError,
+  int radixBits)
+{
+  void *mem = nullptr;
+  if (posix_memalign(&mem, kCacheLine, (n ? n : 1) * sizeof(hedger::S_T))) {
+    throw std::bad_alloc();
+  }
+  keys_ = (hedger::S_T *) mem;
+  n_ = n;
+  maxError_ = maxError;
+  radixBits_ = radixBits;
+  shift_ = 0;
+
+  // Corridor of lines from the last knot that keep every key seen since
+  // within maxError_: bounded above through upper, below through lower.
+  hedger::SplinePoint prev = { 0, 0 };
+  hedger::SplinePoint upper = { 0, 0 };
+  hedger::SplinePoint lower = { 0, 0 };
+  for (std::size_t i = 0; i < n; i++) {
+    keys_[i] = sorted[i];
+    int64_t key = sorted[i];
+    int64_t pos = (int64_t) i;
+
+    if (0 == i) {
+      AddKnot(key, pos);
+    } else if (1 == i) {
+      upper = { key, pos + maxError_ };
+      lower = { key, pos - maxError_ };
+    } else {
+      const hedger::SplinePoint &last = spline_.back();
+      int64_t dx = key - last.key;
+      int64_t dy = pos - last.pos;
+      int64_t upperDx = upper.key - last.key;
+      int64_t upperDy = upper.pos - last.pos;
+      int64_t lowerDx = lower.key - last.key;
+      int64_t lowerDy = lower.pos - last.pos;
+
+      if (Orientation(upperDx, upperDy, dx, dy) <= 0 ||
+        Orientation(lowerDx, lowerDy, dx, dy) >= 0) {
+        // This key leaves the corridor: close the segment at the previous key.
+        AddKnot(prev.key, prev.pos);
+        upper = { key, pos + maxError_ };
+        lower = { key, pos - maxError_ };
+      } else {
+        if (Orientation(upperDx, upperDy, dx, dy + maxError_) > 0) {
+          upper = { key, pos + maxError_ };
+        }
+        if (Orientation(lowerDx, lowerDy, dx, dy - maxError_) < 0) {
+          lower = { key, pos - maxError_ };
+        }
+      }
+    }
+    prev = { key, pos };
+  }
+  if (n > 1) {
+    AddKnot(prev.key, prev.pos);
+  }
+  BuildRadixTable();
+}
+
+// Destructor
+LearnedIndex::~LearnedIndex()
+{
+  free(keys_);
+}
+
+// AddKnot
+//
+// Entry: key
+//        position of key
+void LearnedIndex::AddKnot(int64_t key, int64_t pos)
+{
+  hedger::SplinePoint knot = { key, pos };
+  spline_.push_back(knot);
+}
+
+// BuildRadixTable
+//
+// Index the knots by the top radixBits_ bits of their offset from the
+// smallest key: entry p is the first knot whose prefix is >= p.
+void LearnedIndex::BuildRadixTable()
+{
+  if (spline_.empty()) {
+    return;
+  }
+  uint64_t range = (uint64_t) (spline_.back().key - spline_.front().key);
+  int bits = range ? 64 - __builtin_clzll(range) : 0;
+  shift_ = bits > radixBits_ ? bits - radixBits_ : 0;
+
+  std::size_t tableTot = (std::size_t) (range >> shift_) + 2;
+  radix_.resize(tableTot);
+  std::size_t p = 0;
+  for (std::size_t i = 0; i < spline_.size(); i++) {
+    std::size_t prefix = (std::size_t) ((uint64_t) (spline_[i].key - spline_.front().key) >> shift_);
+    while (p <= prefix) {
+      radix_[p++] = (uint32_t) i;
+    }
+  }
+  while (p < tableTot) {
+    radix_[p++] = (uint32_t) spline_.size();
+  }
+}
+
+// ModelSize
+//
+// Exit:  bytes held by the spline and the radix table
+std::size_t LearnedIndex::ModelSize()
+{
+  return spline_.size() * sizeof(hedger::SplinePoint) + radix_.size() * sizeof(uint32_t);
+}
+
+// LowerBoundPos
+//
+// The radix table bounds the knots to search; the first knot >= key and
+// its predecessor give the segment to interpolate on, and the keys
+// within maxError_ of the prediction are binary searched.
+//
+// Entry: key
+// Exit:  position of the smallest key >= key, or n_ if there is none
+std::size_t LearnedIndex::LowerBoundPos(hedger::S_T key)
+{
+  if (0 == n_ || key <= keys_[0]) {
+    return 0;
+  }
+  if (key > keys_[n_ - 1]) {
+    return n_;
+  }
+
+  int64_t offset = (int64_t) key - spline_.front().key;
+  std::size_t prefix = (std::size_t) ((uint64_t) offset >> shift_);
+  std::size_t begin = radix_[prefix];
+  std::size_t end = radix_[prefix + 1];
+  if (end >= spline_.size()) {
+    end = spline_.size() - 1;
+  }
+  const hedger::SplinePoint *knot = std::lower_bound(&spline_[begin], &spline_[end],
+    (int64_t) key, [](const hedger::SplinePoint &p, int64_t k) { return p.key < k; });
+  if (knot->key == key) {
+    return (std::size_t) knot->pos;
+  }
+
+  const hedger::SplinePoint *left = knot - 1;
+  double slope = (double) (knot->pos - left->pos) / (double) (knot->key - left->key);
+  int64_t predicted = left->pos + (int64_t) (slope * (double) ((int64_t) key - left->key));
+  std::size_t lo = predicted > maxError_ ? (std::size_t) (predicted - maxError_) : 0;
+  std::size_t hi = (std::size_t) (predicted + maxError_ + 2);
+  if (hi > n_) {
+    hi = n_;
+  }
+  return std::lower_bound(keys_ + lo, keys_ + hi, key) - keys_;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool LearnedIndex::Find(hedger::S_T key)
+{
+  std::size_t pos = LowerBoundPos(key);
+  return pos < n_ && keys_[pos] == key;
+}
+
+// LowerBound
+//
+// Entry: key
+// Exit:  pointer to the smallest key >= key, or nullptr if there is none
+const hedger::S_T *LearnedIndex::LowerBound(hedger::S_T key)
+{
+  std::size_t pos = LowerBoundPos(key);
+  return pos < n_ ? &keys_[pos] : nullptr;
+}
+} // namespace hedger
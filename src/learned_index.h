@@ -0,0 +1,84 @@
+// learned_index.h
+//
+// Implements an immutable learned index: a RadixSpline model over a
+// sorted key snapshot.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef LEARNED_INDEX_H_
+#define LEARNED_INDEX_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#include "algo.h"
+
+namespace hedger
+{
+const int kLearnedMaxError = 32;        // positions either side of a prediction
+const int kLearnedRadixBits = 18;       // radix table has 2^bits + 1 entries
+
+// SplinePoint
+//
+// A knot of the linear spline: key -> position in the sorted keys.
+struct SplinePoint
+{
+  int64_t             key;
+  int64_t             pos;
+};
+
+// LearnedIndex
+//
+// The spline is fitted by one greedy pass over the sorted keys (greedy
+// spline corridor): a knot is emitted only when the next key would leave
+// the corridor of slopes that keeps every key since the last knot within
+// maxError positions of the line.  Linear interpolation between the two
+// knots around a key therefore predicts its position to within maxError,
+// and a binary search of that window finishes the lookup.  A radix table
+// on the top bits of the key narrows the knot search to a few knots.
+class LearnedIndex
+{
+ public:
+  LearnedIndex(const hedger::S_T *sorted, std::size_t n, int maxError = kLearnedMaxError,
+    int radixBits = kLearnedRadixBits);
+  virtual ~LearnedIndex();
+
+  bool Find(hedger::S_T key);
+  const hedger::S_T *LowerBound(hedger::S_T key);
+  std::size_t Size() { return n_; }
+  std::size_t SplineTot() { return spline_.size(); }
+  std::size_t ModelSize();
+  std::size_t MemoryUsage() { return n_ * sizeof(hedger::S_T) + ModelSize(); }
+
+ protected:
+  void AddKnot(int64_t key, int64_t pos);
+  void BuildRadixTable();
+  std::size_t LowerBoundPos(hedger::S_T key);
+
+  hedger::S_T *                     keys_;          // copy of the sorted keys
+  std::size_t                       n_;
+  int64_t                           maxError_;
+  int                               radixBits_;
+  int                               shift_;         // key offset >> shift_ == prefix
+  std::vector<hedger::SplinePoint>  spline_;
+  std::vector<uint32_t>             radix_;         // prefix -> first knot with >= prefix
+};
+} // namespace hedger
+#endif // #ifndef LEARNED_INDEX_H_
@@ -0,0 +1,142 @@
+// locked_tree.h
+//
+// Wraps a single-threaded engine in one mutex, as the baseline for the
+// concurrent engines.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef LOCKED_TREE_H_
+#define LOCKED_TREE_H_
+
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+
+#include "algo.h"
+
+namespace hedger
+{
+
+// LockedTree
+//
+// Every operation takes the one lock, so any number of threads may share
+// the engine but only one runs at a time.  Add and DeleteKey report
+// whether the set changed, whatever the engine's own return type.
+template <class TREE>
+class LockedTree
+{
+ public:
+  LockedTree() {};
+  virtual ~LockedTree() {};
+
+  bool Add(hedger::S_T key)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (tree_.Find(key)) {
+      return false;
+    }
+    tree_.Add(key);
+    return true;
+  }
+
+  bool Find(hedger::S_T key)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    return tree_.Find(key) ? true : false;
+  }
+
+  bool DeleteKey(hedger::S_T key)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    return tree_.DeleteKey(key);
+  }
+
+  // Holds the lock for the whole scan; TREE must provide RangeScan
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max)
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    return tree_.RangeScan(lo, hi, out, max);
+  }
+
+  std::size_t MemoryUsage()
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    return tree_.MemoryUsage() + sizeof(std::mutex);
+  }
+
+ private:
+  std::mutex  lock_;
+  TREE        tree_;
+};
+
+// SharedLockedTree
+//
+// As LockedTree, but lookups share a reader-writer lock, so they run
+// together unless a writer holds it.  Every lookup still writes the
+// lock word, so readers on different cores contend for its cache line.
+// TREE::Find must not modify the engine.
+template <class TREE>
+class SharedLockedTree
+{
+ public:
+  SharedLockedTree() {};
+  virtual ~SharedLockedTree() {};
+
+  bool Add(hedger::S_T key)
+  {
+    std::lock_guard<std::shared_timed_mutex> guard(lock_);
+    if (tree_.Find(key)) {
+      return false;
+    }
+    tree_.Add(key);
+    return true;
+  }
+
+  bool Find(hedger::S_T key)
+  {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    return tree_.Find(key) ? true : false;
+  }
+
+  bool DeleteKey(hedger::S_T key)
+  {
+    std::lock_guard<std::shared_timed_mutex> guard(lock_);
+    return tree_.DeleteKey(key);
+  }
+
+  // Holds the lock shared for the whole scan, so writers wait it out;
+  // TREE must provide RangeScan
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max)
+  {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    return tree_.RangeScan(lo, hi, out, max);
+  }
+
+  std::size_t MemoryUsage()
+  {
+    std::shared_lock<std::shared_timed_mutex> guard(lock_);
+    return tree_.MemoryUsage() + sizeof(std::shared_timed_mutex);
+  }
+
+ private:
+  std::shared_timed_mutex lock_;
+  TREE                    tree_;
+};
+} // namespace hedger
+#endif // #ifndef LOCKED_TREE_H_
@@ -0,0 +1,363 @@
+// lsm_tree.cc
+//
+// Implements an in-memory log-structured merge engine: a scapegoat tree
+// memtable over immutable sorted runs.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <algorithm>
+#include <chrono>
+
+#include "lsm_tree.h"
+
+namespace hedger
+{
+//
+// Helper functions
+//
+
+// BloomHash
+//
+// 64-bit finalizer (splitmix64); the two halves seed double hashing.
+static uint64_t BloomHash(hedger::S_T key)
+{
+  uint64_t h = (uint64_t) (uint32_t) key + 0x9e3779b97f4a7c15ULL;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+// Constructor
+//
+// Entry: merge policy
+//        memtable keys and tombstones before a flush
+//        level size ratio (leveling) or runs per level (tiering)
+LsmTree::LsmTree(hedger::LsmPolicy policy, int memtableTot, int sizeRatio)
+{
+  policy_ = policy;
+  memtableTot_ = memtableTot > 0 ? memtableTot : 1;
+  sizeRatio_ = sizeRatio > 1 ? sizeRatio : 2;
+  memtable_ = new hedger::ScapegoatTree();
+  tombstones_ = new hedger::ScapegoatTree();
+  updateTot_ = 0;
+  writeTot_ = 0;
+  findTot_ = 0;
+  searchTot_ = 0;
+  mergeSeconds_ = 0.0;
+}
+
+// Destructor
+LsmTree::~LsmTree()
+{
+  delete memtable_;
+  delete tombstones_;
+  for (auto &level : levels_) {
+    for (hedger::LsmRun *run : level) {
+      delete run;
+    }
+  }
+}
+
+// Add
+//
+// Entry: key
+void LsmTree::Add(hedger::S_T key)
+{
+  updateTot_++;
+  if (tombstones_->Find(key)) {
+    tombstones_->DeleteKey(key);
+  }
+  if (!memtable_->Find(key)) {
+    memtable_->Add(key);
+  }
+  CheckFlush();
+}
+
+// DeleteKey
+//
+// Blind: records a tombstone whether or not the key is present.
+//
+// Entry: key
+void LsmTree::DeleteKey(hedger::S_T key)
+{
+  updateTot_++;
+  if (memtable_->Find(key)) {
+    memtable_->DeleteKey(key);
+  }
+  if (!tombstones_->Find(key)) {
+    tombstones_->Add(key);
+  }
+  CheckFlush();
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool LsmTree::Find(hedger::S_T key)
+{
+  findTot_++;
+  if (memtable_->Find(key)) {
+    return true;
+  }
+  if (tombstones_->Find(key)) {
+    return false;
+  }
+  for (auto &level : levels_) {
+    for (auto it = level.rbegin(); it != level.rend(); ++it) {
+      const hedger::LsmRun *run = *it;
+      if (!BloomMayContain(run, key)) {
+        continue;
+      }
+      searchTot_++;
+      auto pos = std::lower_bound(run->keys.begin(), run->keys.end(), key);
+      if (pos != run->keys.end() && *pos == key) {
+        return !run->tombstone[pos - run->keys.begin()];
+      }
+    }
+  }
+  return false;
+}
+
+// CheckFlush
+//
+// Freeze the memtable once it holds memtableTot_ keys and tombstones.
+void LsmTree::CheckFlush()
+{
+  if ((std::size_t) (memtable_->Size() + tombstones_->Size()) >= memtableTot_) {
+    Flush();
+  }
+}
+
+// Flush
+//
+// Pack the memtable in order into a run, merging the live and deleted
+// keys, and hand it to level 0.
+void LsmTree::Flush()
+{
+  int liveTot = memtable_->Size();
+  int deadTot = tombstones_->Size();
+  if (0 == liveTot + deadTot) {
+    return;
+  }
+  std::vector<hedger::S_T> live(liveTot);
+  std::vector<hedger::S_T> dead(deadTot);
+  memtable_->PackKeys(live.data());
+  tombstones_->PackKeys(dead.data());
+
+  hedger::LsmRun *run = new hedger::LsmRun();
+  run->keys.reserve(liveTot + deadTot);
+  run->tombstone.reserve(liveTot + deadTot);
+  int i = 0;
+  int j = 0;
+  while (i < liveTot || j < deadTot) {
+    if (j == deadTot || (i < liveTot && live[i] < dead[j])) {
+      run->keys.push_back(live[i++]);
+      run->tombstone.push_back(0);
+    } else {
+      run->keys.push_back(dead[j++]);
+      run->tombstone.push_back(1);
+    }
+  }
+  writeTot_ += run->keys.size();
+  BuildBloom(run);
+
+  delete memtable_;
+  delete tombstones_;
+  memtable_ = new hedger::ScapegoatTree();
+  tombstones_ = new hedger::ScapegoatTree();
+  AddRun(run);
+}
+
+// AddRun
+//
+// Place a run at level 0 and cascade merges down the levels as the
+// policy requires.
+//
+// Entry: pointer to run
+void LsmTree::AddRun(hedger::LsmRun *run)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::size_t capacity = memtableTot_ * sizeRatio_;
+  for (std::size_t level = 0; ; level++, capacity *= sizeRatio_) {
+    if (levels_.size() <= level) {
+      levels_.resize(level + 1);
+    }
+    std::vector<hedger::LsmRun *> &runs = levels_[level];
+
+    if (kLsmLeveling == policy_) {
+      if (!runs.empty()) {
+        std::vector<hedger::LsmRun *> pair = { run, runs[0] };
+        hedger::LsmRun *merged = MergeRuns(pair, DeeperEmpty(level));
+        delete run;
+        delete runs[0];
+        runs.clear();
+        run = merged;
+      }
+      if (run->keys.size() <= capacity) {
+        runs.push_back(run);
+        break;
+      }
+    } else {
+      runs.push_back(run);
+      if (runs.size() < sizeRatio_) {
+        break;
+      }
+      std::vector<hedger::LsmRun *> newestFirst(runs.rbegin(), runs.rend());
+      run = MergeRuns(newestFirst, DeeperEmpty(level));
+      for (hedger::LsmRun *old : runs) {
+        delete old;
+      }
+      runs.clear();
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  mergeSeconds_ += std::chrono::duration<double>(end - start).count();
+}
+
+// MergeRuns
+//
+// k-way merge.  Where runs share a key the newest entry wins.
+//
+// Entry: runs, newest first
+//        true == no older runs remain below, so tombstones can go
+// Exit:  pointer to the merged run
+hedger::LsmRun *LsmTree::MergeRuns(const std::vector<hedger::LsmRun *> &runs,
+  bool dropTombstones)
+{
+  std::size_t total = 0;
+  for (const hedger::LsmRun *run : runs) {
+    total += run->keys.size();
+  }
+  hedger::LsmRun *merged = new hedger::LsmRun();
+  merged->keys.reserve(total);
+  merged->tombstone.reserve(total);
+
+  std::vector<std::size_t> cursor(runs.size(), 0);
+  for (;;) {
+    int winner = -1;
+    for (std::size_t r = 0; r < runs.size(); r++) {
+      if (cursor[r] < runs[r]->keys.size() &&
+        (winner < 0 || runs[r]->keys[cursor[r]] < runs[winner]->keys[cursor[winner]])) {
+        winner = (int) r;
+      }
+    }
+    if (winner < 0) {
+      break;
+    }
+    hedger::S_T key = runs[winner]->keys[cursor[winner]];
+    uint8_t dead = runs[winner]->tombstone[cursor[winner]];
+    for (std::size_t r = 0; r < runs.size(); r++) {
+      if (cursor[r] < runs[r]->keys.size() && runs[r]->keys[cursor[r]] == key) {
+        cursor[r]++;
+      }
+    }
+    if (!(dead && dropTombstones)) {
+      merged->keys.push_back(key);
+      merged->tombstone.push_back(dead);
+    }
+  }
+  writeTot_ += merged->keys.size();
+  BuildBloom(merged);
+  return merged;
+}
+
+// DeeperEmpty
+//
+// Entry: level
+// Exit:  true == no level below holds a run
+bool LsmTree::DeeperEmpty(std::size_t level)
+{
+  for (std::size_t i = level + 1; i < levels_.size(); i++) {
+    if (!levels_[i].empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// BuildBloom
+//
+// Size the filter to kLsmBloomBitsPerKey bits per key, rounded up to a
+// power of two, and set kLsmBloomHashTot bits for each key.
+//
+// Entry: pointer to run
+void LsmTree::BuildBloom(hedger::LsmRun *run)
+{
+  std::size_t bits = 64;
+  while (bits < run->keys.size() * kLsmBloomBitsPerKey) {
+    bits <<= 1;
+  }
+  run->bloom.assign(bits / 64, 0);
+  for (hedger::S_T key : run->keys) {
+    uint64_t h = BloomHash(key);
+    uint64_t delta = (h >> 32) | 1;
+    for (int i = 0; i < kLsmBloomHashTot; i++, h += delta) {
+      uint64_t bit = h & (bits - 1);
+      run->bloom[bit >> 6] |= 1ULL << (bit & 63);
+    }
+  }
+}
+
+// BloomMayContain
+//
+// Entry: pointer to run
+//        key
+// Exit:  false == key certainly not in the run
+bool LsmTree::BloomMayContain(const hedger::LsmRun *run, hedger::S_T key)
+{
+  uint64_t bits = run->bloom.size() * 64;
+  uint64_t h = BloomHash(key);
+  uint64_t delta = (h >> 32) | 1;
+  for (int i = 0; i < kLsmBloomHashTot; i++, h += delta) {
+    uint64_t bit = h & (bits - 1);
+    if (!(run->bloom[bit >> 6] & (1ULL << (bit & 63)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// RunTot
+//
+// Exit:  number of sorted runs across all levels
+std::size_t LsmTree::RunTot()
+{
+  std::size_t tot = 0;
+  for (auto &level : levels_) {
+    tot += level.size();
+  }
+  return tot;
+}
+
+// MemoryUsage
+//
+// Exit:  bytes held by the memtable, run keys, tombstone flags and filters
+std::size_t LsmTree::MemoryUsage()
+{
+  std::size_t bytes = memtable_->MemoryUsage() + tombstones_->MemoryUsage();
+  for (auto &level : levels_) {
+    for (hedger::LsmRun *run : level) {
+      bytes += run->keys.size() * (sizeof(hedger::S_T) + sizeof(uint8_t)) +
+        run->bloom.size() * sizeof(uint64_t);
+    }
+  }
+  return bytes;
+}
+} // namespace hedger
@@ -0,0 +1,111 @@
+// lsm_tree.h
+//
+// Implements an in-memory log-structured merge engine: a scapegoat tree
+// memtable over immutable sorted runs.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef LSM_TREE_H_
+#define LSM_TREE_H_
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+
+#include "algo.h"
+#include "scapegoat_tree.h"
+
+namespace hedger
+{
+const int kLsmMemtableTot = 4096;       // memtable keys and tombstones before a flush
+const int kLsmSizeRatio = 4;            // level growth factor; runs per tier
+const int kLsmBloomBitsPerKey = 10;
+const int kLsmBloomHashTot = 7;
+
+enum LsmPolicy
+{
+  kLsmLeveling,                         // one run per level, merged on arrival
+  kLsmTiering                           // up to kLsmSizeRatio runs per level
+};
+
+// LsmRun
+//
+// An immutable sorted run.  A tombstone shadows the key in older runs
+// until a merge reaches the bottom of the tree and drops it.
+struct LsmRun
+{
+  std::vector<hedger::S_T>  keys;       // sorted, unique
+  std::vector<uint8_t>      tombstone;  // 1 == keys[i] deleted
+  std::vector<uint64_t>     bloom;      // power-of-two bit count
+};
+
+// LsmTree
+//
+// Updates go to the memtable, a scapegoat tree of live keys plus one of
+// deleted keys.  When the two together reach the flush threshold they
+// are packed in order into a run at level 0.  Under leveling a level
+// holds one run, merged with each arrival, and moves down once it
+// outgrows memtableTot * sizeRatio^(level + 1) keys; under tiering a
+// level collects sizeRatio runs, then merges them into one run for the
+// next level.  Find checks the memtable, then runs newest to oldest,
+// skipping any run whose Bloom filter rules the key out.
+class LsmTree
+{
+ public:
+  LsmTree(hedger::LsmPolicy policy = kLsmLeveling, int memtableTot = kLsmMemtableTot,
+    int sizeRatio = kLsmSizeRatio);
+  virtual ~LsmTree();
+
+  void Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  void DeleteKey(hedger::S_T key);
+  void Flush();
+  std::size_t RunTot();
+  std::size_t MemoryUsage();
+
+  // Runs binary searched per Find, after the Bloom filters
+  double ReadAmplification() { return findTot_ ? (double) searchTot_ / findTot_ : 0.0; }
+  // Keys written into runs, by flushes and merges, per update
+  double WriteAmplification() { return updateTot_ ? (double) writeTot_ / updateTot_ : 0.0; }
+  double MergeSeconds() { return mergeSeconds_; }
+  void ResetCounters() { findTot_ = 0; searchTot_ = 0; }
+
+ protected:
+  void CheckFlush();
+  void AddRun(hedger::LsmRun *run);
+  hedger::LsmRun *MergeRuns(const std::vector<hedger::LsmRun *> &runs, bool dropTombstones);
+  bool DeeperEmpty(std::size_t level);
+  void BuildBloom(hedger::LsmRun *run);
+  bool BloomMayContain(const hedger::LsmRun *run, hedger::S_T key);
+
+  hedger::LsmPolicy                       policy_;
+  std::size_t                             memtableTot_;
+  std::size_t                             sizeRatio_;
+  hedger::ScapegoatTree *                 memtable_;      // live keys
+  hedger::ScapegoatTree *                 tombstones_;    // deleted keys
+  std::vector<std::vector<hedger::LsmRun *>> levels_;     // per level, oldest run first
+
+  std::size_t                             updateTot_;
+  std::size_t                             writeTot_;
+  std::size_t                             findTot_;
+  std::size_t                             searchTot_;
+  double                                  mergeSeconds_;
+};
+} // namespace hedger
+#endif // #ifndef LSM_TREE_H_
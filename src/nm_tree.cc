@@ -0,0 +1,283 @@
+// nm_tree.cc
+//
+// Implements a lock-free external binary search tree after Natarajan and
+// Mittal: edges are flagged and tagged by CAS instead of nodes locked.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <new>
+
+#include "nm_tree.h"
+
+namespace hedger
+{
+// Constructor
+//
+// Sentinel skeleton: R(inf2) over S(inf1) and leaf inf2; S over leaves
+// inf0 and inf1.  Every real key lands in S's left subtree, so a seek
+// always has an ancestor, a successor and a parent.
+//
+// Entry: pinned (EBR) or quiescent (QSBR) reclamation
+NmTree::NmTree(hedger::EpochMode mode) : pool_(sizeof(hedger::NmNode)), epoch_(mode)
+{
+  hedger::NmNode *s = NewNode(kNmInf1, (uintptr_t) NewNode(kNmInf0), (uintptr_t) NewNode(kNmInf1));
+  root_ = NewNode(kNmInf2, (uintptr_t) s, (uintptr_t) NewNode(kNmInf2));
+  keyTot_ = 0;
+}
+
+// Destructor
+//
+// No other thread may be using the tree.  Nodes, linked or retired, go
+// with the pool's slabs.
+NmTree::~NmTree()
+{
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == added, false == already present
+bool NmTree::Add(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  int64_t k = key;
+  hedger::NmSeek seek;
+  hedger::NmNode *leaf = nullptr;       // allocated once, kept across retries
+  hedger::NmNode *internal = nullptr;
+  for (;;) {
+    Seek(k, &seek);
+    hedger::NmNode *sibling = seek.leaf;
+    if (sibling->key == k) {
+      if (leaf) {
+        pool_.Free(leaf);
+        pool_.Free(internal);
+      }
+      return false;
+    }
+    if (!leaf) {
+      leaf = NewNode(k);
+      internal = NewNode(0);
+    }
+    // The internal node takes the larger key; the smaller leaf goes left.
+    internal->key = k > sibling->key ? k : sibling->key;
+    internal->left.store((uintptr_t) (k < sibling->key ? leaf : sibling), std::memory_order_relaxed);
+    internal->right.store((uintptr_t) (k < sibling->key ? sibling : leaf), std::memory_order_relaxed);
+
+    uintptr_t expected = (uintptr_t) sibling;
+    if (Child(seek.parent, k).compare_exchange_strong(expected, (uintptr_t) internal,
+        std::memory_order_acq_rel)) {
+      keyTot_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    // A delete has marked the link: finish it before retrying.
+    if (Address(expected) == sibling && (expected & kNmMarks)) {
+      Cleanup(k, &seek);
+    }
+  }
+}
+
+// Find
+//
+// Wait-free: one descent, no stores.
+//
+// Entry: key
+// Exit:  true == key present
+bool NmTree::Find(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  int64_t k = key;
+  hedger::NmNode *node = root_;
+  for (;;) {
+    // Load both links and select; see OlcTree::Locate.
+    uintptr_t left = node->left.load(std::memory_order_acquire);
+    uintptr_t right = node->right.load(std::memory_order_acquire);
+    hedger::NmNode *next = Address(k < node->key ? left : right);
+    if (!next) {
+      return node->key == k;
+    }
+    node = next;
+  }
+}
+
+// DeleteKey
+//
+// Flagging the leaf's link removes the key; the loop then runs, or
+// waits for a helper to run, the splice that unlinks it.
+//
+// Entry: key
+// Exit:  true == deleted, false == not present
+bool NmTree::DeleteKey(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  int64_t k = key;
+  hedger::NmSeek seek;
+  hedger::NmNode *leaf = nullptr;       // set once the flag is in
+  for (;;) {
+    Seek(k, &seek);
+    if (leaf) {
+      // Gone from the path: a helper spliced it out.
+      if (seek.leaf != leaf || Cleanup(k, &seek)) {
+        return true;
+      }
+      continue;
+    }
+    if (seek.leaf->key != k) {
+      return false;
+    }
+    uintptr_t expected = (uintptr_t) seek.leaf;
+    if (Child(seek.parent, k).compare_exchange_strong(expected, expected | kNmFlag,
+        std::memory_order_acq_rel)) {
+      leaf = seek.leaf;
+      keyTot_.fetch_sub(1, std::memory_order_relaxed);
+      if (Cleanup(k, &seek)) {
+        return true;
+      }
+    } else if (Address(expected) == seek.leaf && (expected & kNmMarks)) {
+      Cleanup(k, &seek);
+    }
+  }
+}
+
+//
+// Helper functions
+//
+
+// NewNode
+// Entry: key
+//        left and right links
+// Exit:  pointer to node, from the pool
+hedger::NmNode *NmTree::NewNode(int64_t key, uintptr_t left, uintptr_t right)
+{
+  return new (pool_.Alloc()) hedger::NmNode(key, left, right);
+}
+
+// Child
+//
+// Entry: internal node
+//        key
+// Exit:  the link key descends through
+std::atomic<uintptr_t> &NmTree::Child(hedger::NmNode *node, int64_t key)
+{
+  return key < node->key ? node->left : node->right;
+}
+
+// Seek
+//
+// Descend to the leaf for key, noting the last untagged edge passed.
+//
+// Entry: key
+//        pointer to seek record to fill in
+void NmTree::Seek(int64_t key, hedger::NmSeek *seek)
+{
+  hedger::NmNode *s = Address(root_->left.load(std::memory_order_acquire));
+  hedger::NmNode *ancestor = root_;
+  hedger::NmNode *successor = s;
+  hedger::NmNode *parent = s;
+  uintptr_t parentLink = s->left.load(std::memory_order_acquire);
+  hedger::NmNode *leaf = Address(parentLink);
+  uintptr_t link = Child(leaf, key).load(std::memory_order_acquire);
+  hedger::NmNode *current = Address(link);
+  while (current) {
+    if (!(parentLink & kNmTag)) {
+      ancestor = parent;
+      successor = leaf;
+    }
+    parent = leaf;
+    leaf = current;
+    parentLink = link;
+    link = Child(current, key).load(std::memory_order_acquire);
+    current = Address(link);
+  }
+  seek->ancestor = ancestor;
+  seek->successor = successor;
+  seek->parent = parent;
+  seek->leaf = leaf;
+}
+
+// Cleanup
+//
+// Splice out a delete marked under seek->parent: tag the link to the
+// sibling of the flagged leaf so it cannot change, then swing the
+// ancestor's link from the successor to that sibling, keeping the
+// sibling's own flag.  Anyone may run this for anyone's delete.
+//
+// Entry: key
+//        seek record of the caller
+// Exit:  true == this call made the splice
+bool NmTree::Cleanup(int64_t key, const hedger::NmSeek *seek)
+{
+  hedger::NmNode *parent = seek->parent;
+  std::atomic<uintptr_t> *childLink = &parent->left;
+  std::atomic<uintptr_t> *siblingLink = &parent->right;
+  if (key >= parent->key) {
+    childLink = &parent->right;
+    siblingLink = &parent->left;
+  }
+  if (!(childLink->load(std::memory_order_acquire) & kNmFlag)) {
+    // The leaf on key's side is not flagged, so its sibling is: keep it.
+    siblingLink = childLink;
+  }
+  uintptr_t sibling = siblingLink->fetch_or(kNmTag, std::memory_order_acq_rel);
+  uintptr_t expected = (uintptr_t) seek->successor;
+  if (!Child(seek->ancestor, key).compare_exchange_strong(expected, sibling & ~kNmTag,
+      std::memory_order_acq_rel)) {
+    return false;
+  }
+  RetireSpliced(key, seek->successor, parent, Address(sibling));
+  return true;
+}
+
+// RetireSpliced
+//
+// Retire what a splice cut off: the internal nodes from successor down
+// to parent and the flagged leaf under each.  Every link among them is
+// marked, so they cannot have changed.
+//
+// Entry: key whose path runs through them
+//        successor (first internal node cut off)
+//        parent (last)
+//        child of parent that was kept
+void NmTree::RetireSpliced(int64_t key, hedger::NmNode *successor, hedger::NmNode *parent,
+  hedger::NmNode *kept)
+{
+  hedger::NmNode *node = successor;
+  while (node != parent) {
+    // The path link is tagged; the other holds a flagged leaf.
+    std::atomic<uintptr_t> &path = Child(node, key);
+    std::atomic<uintptr_t> &other = &path == &node->left ? node->right : node->left;
+    Retire(Address(other.load(std::memory_order_relaxed)));
+    Retire(node);
+    node = Address(path.load(std::memory_order_relaxed));
+  }
+  hedger::NmNode *left = Address(parent->left.load(std::memory_order_relaxed));
+  Retire(left == kept ? Address(parent->right.load(std::memory_order_relaxed)) : left);
+  Retire(parent);
+}
+
+// Retire
+//
+// Hand a removed node to the reclaimer, as a reader may still be looking
+// at it.
+//
+// Entry: removed node
+void NmTree::Retire(hedger::NmNode *node)
+{
+  epoch_.Retire(node, hedger::NodePool::Release, &pool_, sizeof(hedger::NmNode));
+}
+} // namespace hedger
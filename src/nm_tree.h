@@ -0,0 +1,120 @@
+// nm_tree.h
+//
+// Implements a lock-free external binary search tree after Natarajan and
+// Mittal: edges are flagged and tagged by CAS instead of nodes locked.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef NM_TREE_H_
+#define NM_TREE_H_
+
+#include <limits.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include "algo.h"
+#include "epoch.h"
+#include "node_pool.h"
+
+namespace hedger
+{
+// Edge marks, kept in the low bits of child links.  A flagged edge leads
+// to a leaf being deleted; a tagged edge is frozen so its node can be
+// spliced out.  Neither link may change once marked.
+const uintptr_t kNmFlag = 1;
+const uintptr_t kNmTag = 2;
+const uintptr_t kNmMarks = kNmFlag | kNmTag;
+
+// Sentinel keys, above every S_T
+const int64_t kNmInf0 = (int64_t) INT_MAX + 1;
+const int64_t kNmInf1 = (int64_t) INT_MAX + 2;
+const int64_t kNmInf2 = (int64_t) INT_MAX + 3;
+
+// NmNode
+//
+// Internal nodes route (key < node key goes left) and always have two
+// children; leaves hold the keys and have none.  Keys are widened so
+// that the three sentinels sort above every S_T.
+struct NmNode
+{
+  NmNode(int64_t newKey, uintptr_t newLeft = 0, uintptr_t newRight = 0)
+    : key(newKey), left(newLeft), right(newRight) {}
+
+  int64_t                   key;
+  std::atomic<uintptr_t>    left;
+  std::atomic<uintptr_t>    right;
+};
+
+// NmSeek
+//
+// Where a seek for a key ended.  parent holds the link to leaf;
+// ancestor's link to successor is the last untagged edge on the way, so
+// splicing ancestor to parent's other child removes everything between.
+struct NmSeek
+{
+  hedger::NmNode *    ancestor;
+  hedger::NmNode *    successor;
+  hedger::NmNode *    parent;
+  hedger::NmNode *    leaf;
+};
+
+// NmTree
+//
+// Find only reads.  Add swings one link from a leaf to a new internal
+// node over the old and new leaves.  DeleteKey flags the link to the
+// leaf, then tags the sibling link and splices the sibling up to the
+// ancestor; a thread finding a marked link completes that delete before
+// retrying its own, so a preempted thread never blocks the others.
+//
+// Every operation runs inside an epoch guard.  Removed nodes may still
+// be under a reader, so they are retired to the reclaimer, which returns
+// them to the node pool once no thread can reach them.
+class NmTree
+{
+ public:
+  NmTree(hedger::EpochMode mode = kEpochPinned);
+  virtual ~NmTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  int Size() { return keyTot_.load(std::memory_order_relaxed); }
+  std::size_t MemoryUsage() { return pool_.SlabBytes(); }
+  void ReclaimStats(hedger::EpochStats *stats) { epoch_.Stats(stats); }
+  void Offline() { epoch_.Offline(); }
+  hedger::EpochMode Mode() { return epoch_.Mode(); }
+
+ protected:
+  static hedger::NmNode *Address(uintptr_t link) { return (hedger::NmNode *) (link & ~kNmMarks); }
+  hedger::NmNode *NewNode(int64_t key, uintptr_t left = 0, uintptr_t right = 0);
+  static std::atomic<uintptr_t> &Child(hedger::NmNode *node, int64_t key);
+  void Seek(int64_t key, hedger::NmSeek *seek);
+  bool Cleanup(int64_t key, const hedger::NmSeek *seek);
+  void RetireSpliced(int64_t key, hedger::NmNode *successor, hedger::NmNode *parent,
+    hedger::NmNode *kept);
+  void Retire(hedger::NmNode *node);
+
+  hedger::NmNode *                root_;        // sentinel R; its left is S
+  std::atomic<int>                keyTot_;
+  hedger::NodePool                pool_;        // outlives epoch_, which releases into it
+  hedger::EpochReclaimer          epoch_;
+};
+} // namespace hedger
+#endif // #ifndef NM_TREE_H_
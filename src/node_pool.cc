@@ -0,0 +1,157 @@
+// node_pool.cc
+//
+// Implements a fixed-size node allocator with per-thread free lists.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdlib.h>
+
+#include <new>
+
+#include "epoch.h"
+#include "node_pool.h"
+
+namespace hedger
+{
+// Constructor
+//
+// Entry: block size in bytes
+NodePool::NodePool(std::size_t size)
+{
+  const std::size_t align = alignof(std::max_align_t);
+  size_ = (size + align - 1) / align * align;
+  void *mem;
+  if (posix_memalign(&mem, kCacheLine, kEpochThreadMax * sizeof(hedger::PoolCache))) {
+    throw std::bad_alloc();
+  }
+  caches_ = (hedger::PoolCache *) mem;
+  for (int i = 0; i < kEpochThreadMax; i++) {
+    hedger::PoolCache *cache = new (&caches_[i]) hedger::PoolCache();
+    cache->allocTot = 0;
+    cache->freeTot = 0;
+  }
+}
+
+// Destructor
+//
+// Blocks still out are freed with their slabs.
+NodePool::~NodePool()
+{
+  for (int i = 0; i < kEpochThreadMax; i++) {
+    caches_[i].~PoolCache();
+  }
+  free(caches_);
+  for (void *slab : slabs_) {
+    free(slab);
+  }
+}
+
+// Alloc
+//
+// Exit:  pointer to an uninitialized block
+void *NodePool::Alloc()
+{
+  hedger::PoolCache *cache = &caches_[EpochReclaimer::ThreadIndex()];
+  if (cache->free.empty()) {
+    Refill(cache);
+  }
+  void *block = cache->free.back();
+  cache->free.pop_back();
+  cache->allocTot.store(cache->allocTot.load(std::memory_order_relaxed) + 1,
+    std::memory_order_relaxed);
+  return block;
+}
+
+// Free
+//
+// Entry: block from Alloc, on any thread
+void NodePool::Free(void *block)
+{
+  hedger::PoolCache *cache = &caches_[EpochReclaimer::ThreadIndex()];
+  cache->free.push_back(block);
+  cache->freeTot.store(cache->freeTot.load(std::memory_order_relaxed) + 1,
+    std::memory_order_relaxed);
+  if (cache->free.size() > 2 * kPoolBatch) {
+    Spill(cache);
+  }
+}
+
+// SlabBytes
+//
+// Exit:  bytes obtained from the system
+std::size_t NodePool::SlabBytes()
+{
+  std::lock_guard<std::mutex> guard(lock_);
+  return slabs_.size() * kPoolSlab * size_;
+}
+
+// LiveBytes
+//
+// Exit:  bytes in blocks handed out and not yet freed; exact only while
+//        no other thread is allocating or freeing
+std::size_t NodePool::LiveBytes()
+{
+  int64_t live = 0;
+  for (int i = 0; i < kEpochThreadMax; i++) {
+    live += caches_[i].allocTot.load(std::memory_order_relaxed) -
+      caches_[i].freeTot.load(std::memory_order_relaxed);
+  }
+  return live > 0 ? (std::size_t) live * size_ : 0;
+}
+
+//
+// Helper functions
+//
+
+// Refill
+//
+// Take a batch from the shared list, carving a new slab if it runs dry.
+//
+// Entry: empty cache
+void NodePool::Refill(hedger::PoolCache *cache)
+{
+  std::lock_guard<std::mutex> guard(lock_);
+  if (shared_.empty()) {
+    char *slab = (char *) malloc(kPoolSlab * size_);
+    if (!slab) {
+      throw std::bad_alloc();
+    }
+    slabs_.push_back(slab);
+    for (int i = kPoolSlab - 1; i >= 0; i--) {
+      shared_.push_back(slab + i * size_);
+    }
+  }
+  std::size_t n = shared_.size() < (std::size_t) kPoolBatch ? shared_.size() : kPoolBatch;
+  cache->free.insert(cache->free.end(), shared_.end() - n, shared_.end());
+  shared_.resize(shared_.size() - n);
+}
+
+// Spill
+//
+// Hand a batch back to the shared list, so that a thread that mostly
+// frees does not hoard blocks another thread mostly allocates.
+//
+// Entry: overfull cache
+void NodePool::Spill(hedger::PoolCache *cache)
+{
+  std::lock_guard<std::mutex> guard(lock_);
+  shared_.insert(shared_.end(), cache->free.end() - kPoolBatch, cache->free.end());
+  cache->free.resize(cache->free.size() - kPoolBatch);
+}
+} // namespace hedger
@@ -0,0 +1,86 @@
+// node_pool.h
+//
+// Implements a fixed-size node allocator with per-thread free lists.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef NODE_POOL_H_
+#define NODE_POOL_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Blocks moved between a thread's cache and the shared list at once
+const int kPoolBatch = 64;
+
+// Blocks carved from each slab
+const int kPoolSlab = 256;
+
+// PoolCache
+//
+// One thread's free blocks.  The list is its owner's alone; the counters
+// are written by the owner and read by anyone.
+struct alignas(kCacheLine) PoolCache
+{
+  std::vector<void *>     free;
+  std::atomic<int64_t>    allocTot;
+  std::atomic<int64_t>    freeTot;
+};
+
+// NodePool
+//
+// Hands out blocks of one size from slabs that are only returned with
+// the pool.  Alloc and Free work on the calling thread's cache and take
+// the pool lock once per kPoolBatch blocks, to move a batch to or from
+// the shared list, or to carve a new slab.  Release matches the
+// EpochReclaimer release signature, so retired nodes come back to the
+// cache of the thread that releases them.
+class NodePool
+{
+ public:
+  NodePool(std::size_t size);
+  virtual ~NodePool();
+
+  void *Alloc();
+  void Free(void *block);
+  static void Release(void *pool, void *block) { ((hedger::NodePool *) pool)->Free(block); }
+  std::size_t BlockSize() { return size_; }
+  std::size_t SlabBytes();
+  std::size_t LiveBytes();
+
+ protected:
+  void Refill(hedger::PoolCache *cache);
+  void Spill(hedger::PoolCache *cache);
+
+  std::size_t             size_;          // block size, rounded up for alignment
+  hedger::PoolCache *     caches_;        // kEpochThreadMax, by thread slot
+  std::mutex              lock_;          // guards shared_ and slabs_
+  std::vector<void *>     shared_;
+  std::vector<void *>     slabs_;
+};
+} // namespace hedger
+#endif // #ifndef NODE_POOL_H_
@@ -0,0 +1,574 @@
+// olc_tree.cc
+//
+// Implements a scapegoat tree for concurrent use by optimistic lock
+// coupling: readers validate per-node versions instead of locking.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <math.h>
+
+#include <new>
+#include <thread>
+#include <utility>
+
+#include "olc_tree.h"
+
+namespace hedger
+{
+// Constructor
+//
+// Entry: pinned (EBR) or quiescent (QSBR) reclamation
+OlcTree::OlcTree(hedger::EpochMode mode) : head_(0), pool_(sizeof(hedger::OlcNode)), epoch_(mode)
+{
+  nodeTot_ = 0;
+  restartTot_ = 0;
+  rebuildTot_ = 0;
+  skippedTot_ = 0;
+}
+
+// Destructor
+//
+// No other thread may be using the tree.  Nodes, linked or retired, go
+// with the pool's slabs.
+OlcTree::~OlcTree()
+{
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == added, false == already present
+bool OlcTree::Add(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  hedger::OlcNode *fresh = nullptr;   // allocated once, kept across restarts
+  int depth;
+  int result;
+  while (kOlcRestart == (result = TryAdd(key, &fresh, &depth))) {
+    Restart();
+  }
+  if (!result) {
+    if (fresh) {
+      pool_.Free(fresh);
+    }
+    return false;
+  }
+  nodeTot_.fetch_add(1, std::memory_order_relaxed);
+  CheckDepth(key, depth);
+  return true;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool OlcTree::Find(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  hedger::OlcNode *parent;
+  hedger::OlcNode *node;
+  uint64_t parentVersion;
+  uint64_t version;
+  int depth;
+  int result;
+  while (kOlcRestart == (result = Locate(key, &parent, &parentVersion, &node, &version, &depth))) {
+    Restart();
+  }
+  return result != 0;
+}
+
+// DeleteKey
+//
+// Entry: key
+// Exit:  true == deleted, false == not present
+bool OlcTree::DeleteKey(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  int result;
+  while (kOlcRestart == (result = TryDelete(key))) {
+    Restart();
+  }
+  if (!result) {
+    return false;
+  }
+  nodeTot_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+//
+// Helper functions
+//
+
+// Log32
+//
+// Gets the log-base 3/2, as ScapegoatTree does
+int const OlcTree::Log32(int q)
+{
+  double const log23 = 2.4663034623764317;
+  return (int) ceil(log23 * log(q));
+}
+
+// ReadLock
+//
+// Wait out a writer, then note the version to validate against.
+//
+// Entry: node
+//        pointer to version to fill in
+// Exit:  false == node unlinked; restart
+bool OlcTree::ReadLock(hedger::OlcNode *node, uint64_t *version)
+{
+  uint64_t v = node->version.load(std::memory_order_acquire);
+  while (v & kOlcLocked) {
+    std::this_thread::yield();
+    v = node->version.load(std::memory_order_acquire);
+  }
+  *version = v;
+  return !(v & kOlcObsolete);
+}
+
+// Validate
+//
+// Entry: node
+//        version noted by ReadLock
+// Exit:  true == no writer has locked the node since; the fields read
+//        in between are consistent
+bool OlcTree::Validate(hedger::OlcNode *node, uint64_t version)
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return node->version.load(std::memory_order_relaxed) == version;
+}
+
+// Upgrade
+//
+// Take the write lock, provided nothing changed since the version read.
+// Never waits, so a writer holding locks cannot deadlock on another.
+//
+// Entry: node
+//        version noted by ReadLock
+// Exit:  true == locked
+bool OlcTree::Upgrade(hedger::OlcNode *node, uint64_t version)
+{
+  if (!node->version.compare_exchange_strong(version, version + kOlcLocked,
+      std::memory_order_acquire)) {
+    return false;
+  }
+  // Order the writes that follow after the lock for validating readers.
+  std::atomic_thread_fence(std::memory_order_release);
+  return true;
+}
+
+// Unlock
+//
+// Clear the lock bit and carry into the count, so readers that saw the
+// old version fail validation.
+//
+// Entry: locked node
+void OlcTree::Unlock(hedger::OlcNode *node)
+{
+  node->version.fetch_add(kOlcLocked, std::memory_order_release);
+}
+
+// UnlockObsolete
+//
+// Unlock a node that has been unlinked; readers reaching it restart.
+//
+// Entry: locked node
+void OlcTree::UnlockObsolete(hedger::OlcNode *node)
+{
+  node->version.fetch_add(kOlcLocked + kOlcObsolete, std::memory_order_release);
+}
+
+// Child
+//
+// Entry: node; its key must be stable (locked) or validated afterwards
+//        key
+// Exit:  the child link key descends through
+std::atomic<hedger::OlcNode *> &OlcTree::Child(hedger::OlcNode *node, hedger::S_T key)
+{
+  if (node == &head_ || key < node->key.load(std::memory_order_relaxed)) {
+    return node->left;
+  }
+  return node->right;
+}
+
+// Locate
+//
+// Optimistic descent.  Each child is version-read before its parent is
+// validated, so the pair was linked at one instant.
+//
+// Entry: key
+//        pointers to the parent and its version to fill in
+//        pointers to the node and its version to fill in
+//        pointer to nodes passed, root == 1
+// Exit:  1 == found at node, 0 == absent below parent's null link,
+//        kOlcRestart == conflict
+int OlcTree::Locate(hedger::S_T key, hedger::OlcNode **parent, uint64_t *parentVersion,
+  hedger::OlcNode **node, uint64_t *version, int *depth)
+{
+  // Locals rather than the out parameters: the fences in Validate would
+  // otherwise force them through memory on every level.
+  hedger::OlcNode *up = &head_;
+  hedger::OlcNode *down;
+  uint64_t upVersion;
+  uint64_t downVersion = 0;
+  int passed = 0;
+  int result = 0;
+  ReadLock(&head_, &upVersion);
+  down = head_.left.load(std::memory_order_acquire);
+  while (down) {
+    if (!ReadLock(down, &downVersion) || !Validate(up, upVersion)) {
+      return kOlcRestart;
+    }
+    passed++;
+    hedger::S_T downKey = down->key.load(std::memory_order_relaxed);
+    if (downKey == key) {
+      result = 1;
+      break;
+    }
+    // Load both links and select: a branch here mispredicts half the
+    // time and sends the CPU down the wrong child.
+    hedger::OlcNode *left = down->left.load(std::memory_order_acquire);
+    hedger::OlcNode *right = down->right.load(std::memory_order_acquire);
+    hedger::OlcNode *next = key < downKey ? left : right;
+    up = down;
+    upVersion = downVersion;
+    down = next;
+  }
+  if (!Validate(result ? down : up, result ? downVersion : upVersion)) {
+    return kOlcRestart;
+  }
+  *parent = up;
+  *parentVersion = upVersion;
+  *node = down;
+  *version = downVersion;
+  *depth = passed;
+  return result;
+}
+
+// TryAdd
+//
+// Entry: key
+//        pointer to the new node, allocated here on first need
+//        pointer to depth of the new node to fill in
+// Exit:  1 == linked, 0 == already present, kOlcRestart == conflict
+int OlcTree::TryAdd(hedger::S_T key, hedger::OlcNode **fresh, int *depth)
+{
+  hedger::OlcNode *parent;
+  hedger::OlcNode *node;
+  uint64_t parentVersion;
+  uint64_t version;
+  int result = Locate(key, &parent, &parentVersion, &node, &version, depth);
+  if (result) {
+    return kOlcRestart == result ? kOlcRestart : 0;
+  }
+  if (!*fresh) {
+    *fresh = new (pool_.Alloc()) hedger::OlcNode(key);
+  }
+  if (!Upgrade(parent, parentVersion)) {
+    return kOlcRestart;
+  }
+  Child(parent, key).store(*fresh, std::memory_order_release);
+  Unlock(parent);
+  (*depth)++;
+  return 1;
+}
+
+// TryDelete
+//
+// A node with at most one child is spliced out under its parent's lock
+// and its own.  A node with two children takes its successor's key
+// instead, under its own lock and those of every node down to the
+// successor; the parent above is untouched.
+//
+// Entry: key
+// Exit:  1 == deleted, 0 == not present, kOlcRestart == conflict
+int OlcTree::TryDelete(hedger::S_T key)
+{
+  hedger::OlcNode *parent;
+  hedger::OlcNode *node;
+  uint64_t parentVersion;
+  uint64_t version;
+  int depth;
+  int result = Locate(key, &parent, &parentVersion, &node, &version, &depth);
+  if (1 != result) {
+    return result;
+  }
+
+  if (!node->left.load(std::memory_order_relaxed) || !node->right.load(std::memory_order_relaxed)) {
+    if (!Upgrade(parent, parentVersion)) {
+      return kOlcRestart;
+    }
+    if (!Upgrade(node, version)) {
+      Unlock(parent);
+      return kOlcRestart;
+    }
+    // The children read above may be stale; these are not.
+    hedger::OlcNode *child = node->left.load(std::memory_order_relaxed);
+    if (!child) {
+      child = node->right.load(std::memory_order_relaxed);
+    }
+    Child(parent, key).store(child, std::memory_order_release);
+    UnlockObsolete(node);
+    Unlock(parent);
+    Retire(node);
+    return 1;
+  }
+
+  if (!Upgrade(node, version)) {
+    return kOlcRestart;
+  }
+  // Two children, and they stay put while node is locked.  Every node on
+  // the way down to the successor is locked as well: a reader already
+  // past node on that path would otherwise miss the key moving up into
+  // node, and validate nothing that changed.
+  std::vector<std::pair<hedger::OlcNode *, uint64_t>> path;
+  hedger::OlcNode *succ = node->right.load(std::memory_order_relaxed);
+  uint64_t succVersion;
+  if (!ReadLock(succ, &succVersion)) {
+    Unlock(node);
+    return kOlcRestart;
+  }
+  hedger::OlcNode *next;
+  while (nullptr != (next = succ->left.load(std::memory_order_acquire))) {
+    uint64_t nextVersion;
+    if (!ReadLock(next, &nextVersion) || !Validate(succ, succVersion)) {
+      Unlock(node);
+      return kOlcRestart;
+    }
+    path.push_back(std::make_pair(succ, succVersion));
+    succ = next;
+    succVersion = nextVersion;
+  }
+  path.push_back(std::make_pair(succ, succVersion));
+  for (std::size_t i = 0; i < path.size(); i++) {
+    if (!Upgrade(path[i].first, path[i].second)) {
+      while (i--) {
+        Unlock(path[i].first);
+      }
+      Unlock(node);
+      return kOlcRestart;
+    }
+  }
+  path.pop_back();
+  hedger::OlcNode *succParent = path.empty() ? node : path.back().first;
+  node->key.store(succ->key.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  (succParent == node ? node->right : succParent->left).store(
+    succ->right.load(std::memory_order_relaxed), std::memory_order_release);
+  UnlockObsolete(succ);
+  for (const auto &step : path) {
+    Unlock(step.first);
+  }
+  Unlock(node);
+  Retire(succ);
+  return 1;
+}
+
+// Restart
+//
+// Count a conflict.  Only conflicts write here, so readers that do not
+// meet a writer never store to shared memory.
+void OlcTree::Restart()
+{
+  restartTot_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Retire
+//
+// Hand an unlinked node to the reclaimer, as a reader may still be
+// looking at it.
+//
+// Entry: unlinked node
+void OlcTree::Retire(hedger::OlcNode *node)
+{
+  epoch_.Retire(node, hedger::NodePool::Release, &pool_, sizeof(hedger::OlcNode));
+}
+
+// CheckDepth
+//
+// Rebuild at the scapegoat if a new node landed too deep, with the same
+// depth bound and scapegoat test as ScapegoatTree.  The path is found
+// again by optimistic descent and subtree sizes counted optimistically,
+// so they can be off under concurrent updates; that only moves the
+// choice of scapegoat, since Rebuild counts again under its locks.
+//
+// Entry: key of the new node
+//        its depth, root == 1
+void OlcTree::CheckDepth(hedger::S_T key, int depth)
+{
+  if (depth <= Log32(Size())) {
+    return;
+  }
+
+  std::vector<hedger::OlcNode *> path(1, &head_);
+  uint64_t parentVersion;
+  ReadLock(&head_, &parentVersion);
+  hedger::OlcNode *node = head_.left.load(std::memory_order_acquire);
+  for (;;) {
+    uint64_t version;
+    if (!node || !ReadLock(node, &version) || !Validate(path.back(), parentVersion)) {
+      return;                         // deleted or moved meanwhile
+    }
+    path.push_back(node);
+    if (node->key.load(std::memory_order_relaxed) == key) {
+      break;
+    }
+    node = Child(node, key).load(std::memory_order_acquire);
+    parentVersion = version;
+  }
+
+  // path[1] is the root and path.back() the new node.  The visit budget
+  // bounds a count that wanders through a subtree being relinked.
+  int budget = 2 * Size() + 64;
+  int last = (int) path.size() - 1;
+  if (last < 2) {
+    return;
+  }
+  int size = CountRecurse(path[last - 1], &budget);
+  for (int i = last - 2; i >= 1 && size >= 0; i--) {
+    hedger::OlcNode *left = path[i]->left.load(std::memory_order_acquire);
+    hedger::OlcNode *sibling = left == path[i + 1] ? path[i]->right.load(std::memory_order_acquire) : left;
+    int siblingSize = CountRecurse(sibling, &budget);
+    if (siblingSize < 0) {
+      break;
+    }
+    int parentSize = size + siblingSize + 1;
+    if (3 * size > 2 * parentSize) {
+      Rebuild(path[i - 1], path[i], key);
+      return;
+    }
+    size = parentSize;
+  }
+}
+
+// Rebuild
+//
+// Lock the scapegoat's parent, then every node under the scapegoat,
+// relink those nodes into a balanced subtree and hang it from the
+// parent.  Only the parent's link changes above the subtree.  Any lock
+// already taken means a writer is inside; then the rebuild is skipped.
+//
+// Entry: scapegoat's parent
+//        scapegoat
+//        key whose path runs through both
+void OlcTree::Rebuild(hedger::OlcNode *parent, hedger::OlcNode *scapegoat, hedger::S_T key)
+{
+  uint64_t parentVersion;
+  if (!ReadLock(parent, &parentVersion)) {
+    skippedTot_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  std::atomic<hedger::OlcNode *> &link = Child(parent, key);
+  if (link.load(std::memory_order_relaxed) != scapegoat || !Upgrade(parent, parentVersion)) {
+    skippedTot_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  std::vector<hedger::OlcNode *> locked;
+  std::vector<hedger::OlcNode *> inOrder;
+  bool complete = LockRecurse(scapegoat, &locked, &inOrder);
+  if (complete) {
+    link.store(BuildBalanced(inOrder.data(), (int) inOrder.size()), std::memory_order_release);
+    rebuildTot_.fetch_add(inOrder.size(), std::memory_order_relaxed);
+  } else {
+    skippedTot_.fetch_add(1, std::memory_order_relaxed);
+  }
+  for (hedger::OlcNode *node : locked) {
+    Unlock(node);
+  }
+  Unlock(parent);
+}
+
+// CountRecurse
+//
+// Optimistic subtree size.
+//
+// Entry: subtree root
+//        pointer to nodes left to visit
+// Exit:  node total, or -1 == conflict or budget spent
+int OlcTree::CountRecurse(hedger::OlcNode *node, int *budget)
+{
+  if (!node) {
+    return 0;
+  }
+  uint64_t version;
+  if (--*budget < 0 || !ReadLock(node, &version)) {
+    return -1;
+  }
+  hedger::OlcNode *left = node->left.load(std::memory_order_acquire);
+  hedger::OlcNode *right = node->right.load(std::memory_order_acquire);
+  if (!Validate(node, version)) {
+    return -1;
+  }
+  int leftTot = CountRecurse(left, budget);
+  if (leftTot < 0) {
+    return -1;
+  }
+  int rightTot = CountRecurse(right, budget);
+  if (rightTot < 0 || !Validate(node, version)) {
+    return -1;
+  }
+  return leftTot + rightTot + 1;
+}
+
+// LockRecurse
+//
+// Lock a subtree top down, collecting its nodes in key order.  Once a
+// node is locked its links are fixed, so the walk sees one tree.
+//
+// Entry: subtree root
+//        nodes locked so far, for the caller to unlock
+//        nodes in key order
+// Exit:  false == met a node already locked; gave up
+bool OlcTree::LockRecurse(hedger::OlcNode *node, std::vector<hedger::OlcNode *> *locked,
+  std::vector<hedger::OlcNode *> *inOrder)
+{
+  if (!node) {
+    return true;
+  }
+  uint64_t version = node->version.load(std::memory_order_acquire);
+  if ((version & (kOlcLocked | kOlcObsolete)) || !Upgrade(node, version)) {
+    return false;
+  }
+  locked->push_back(node);
+  if (!LockRecurse(node->left.load(std::memory_order_relaxed), locked, inOrder)) {
+    return false;
+  }
+  inOrder->push_back(node);
+  return LockRecurse(node->right.load(std::memory_order_relaxed), locked, inOrder);
+}
+
+// BuildBalanced
+//
+// Relink locked nodes into a balanced subtree.  Readers see the new
+// links once each node is unlocked.
+//
+// Entry: nodes in key order
+//        number of nodes
+// Exit:  subtree root
+hedger::OlcNode *OlcTree::BuildBalanced(hedger::OlcNode **nodes, int nodeTot)
+{
+  if (!nodeTot) {
+    return nullptr;
+  }
+  int m = nodeTot / 2;
+  nodes[m]->left.store(BuildBalanced(nodes, m), std::memory_order_relaxed);
+  nodes[m]->right.store(BuildBalanced(nodes + m + 1, nodeTot - m - 1), std::memory_order_relaxed);
+  return nodes[m];
+}
+} // namespace hedger
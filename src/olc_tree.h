@@ -0,0 +1,124 @@
+// olc_tree.h
+//
+// Implements a scapegoat tree for concurrent use by optimistic lock
+// coupling: readers validate per-node versions instead of locking.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef OLC_TREE_H_
+#define OLC_TREE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "algo.h"
+#include "epoch.h"
+#include "node_pool.h"
+
+namespace hedger
+{
+// Version word bits: obsolete (unlinked) and write-locked.  The rest
+// counts write unlocks.
+const uint64_t kOlcObsolete = 1;
+const uint64_t kOlcLocked = 2;
+
+// Attempt result asking the caller to start again from the root
+const int kOlcRestart = -1;
+
+// OlcNode
+//
+// Fields a reader can see change under it are atomics read relaxed and
+// checked afterwards against the version.  No parent pointer: writers
+// would have to lock the children of every node they relink to keep it.
+struct OlcNode
+{
+  OlcNode(hedger::S_T newKey) : version(0), key(newKey), left(nullptr), right(nullptr) {}
+
+  std::atomic<uint64_t>           version;
+  std::atomic<hedger::S_T>        key;
+  std::atomic<hedger::OlcNode *>  left;
+  std::atomic<hedger::OlcNode *>  right;
+};
+
+// OlcTree
+//
+// Scapegoat tree whose nodes each carry a version lock.  Find never
+// writes shared memory: it reads a node's version, its key and child,
+// then checks the version is unchanged, restarting from the root if a
+// writer got in between.  Add locks only the parent it links below,
+// DeleteKey only the nodes it relinks, and a rebuild the scapegoat's
+// parent and the subtree under it.  A rebuild that cannot take every
+// lock at once is skipped; the tree stays correct, only deeper, and the
+// next deep insert tries again.
+//
+// Every operation runs inside an epoch guard.  Unlinked nodes may still
+// be under a reader, so they are retired to the reclaimer, which returns
+// them to the node pool once no thread can reach them.
+class OlcTree
+{
+ public:
+  OlcTree(hedger::EpochMode mode = kEpochPinned);
+  virtual ~OlcTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  int Size() { return nodeTot_.load(std::memory_order_relaxed); }
+  std::size_t MemoryUsage() { return pool_.SlabBytes(); }
+  void ReclaimStats(hedger::EpochStats *stats) { epoch_.Stats(stats); }
+  void Offline() { epoch_.Offline(); }
+  hedger::EpochMode Mode() { return epoch_.Mode(); }
+  std::size_t RestartTot() { return restartTot_.load(std::memory_order_relaxed); }
+  std::size_t RebuildTot() { return rebuildTot_.load(std::memory_order_relaxed); }
+  std::size_t SkippedRebuildTot() { return skippedTot_.load(std::memory_order_relaxed); }
+
+ protected:
+  static int const Log32(int q);
+  static bool ReadLock(hedger::OlcNode *node, uint64_t *version);
+  static bool Validate(hedger::OlcNode *node, uint64_t version);
+  static bool Upgrade(hedger::OlcNode *node, uint64_t version);
+  static void Unlock(hedger::OlcNode *node);
+  static void UnlockObsolete(hedger::OlcNode *node);
+  std::atomic<hedger::OlcNode *> &Child(hedger::OlcNode *node, hedger::S_T key);
+  int Locate(hedger::S_T key, hedger::OlcNode **parent, uint64_t *parentVersion,
+    hedger::OlcNode **node, uint64_t *version, int *depth);
+  int TryAdd(hedger::S_T key, hedger::OlcNode **fresh, int *depth);
+  int TryDelete(hedger::S_T key);
+  void Restart();
+  void Retire(hedger::OlcNode *node);
+  void CheckDepth(hedger::S_T key, int depth);
+  void Rebuild(hedger::OlcNode *parent, hedger::OlcNode *scapegoat, hedger::S_T key);
+  int CountRecurse(hedger::OlcNode *node, int *budget);
+  bool LockRecurse(hedger::OlcNode *node, std::vector<hedger::OlcNode *> *locked,
+    std::vector<hedger::OlcNode *> *inOrder);
+  hedger::OlcNode *BuildBalanced(hedger::OlcNode **nodes, int nodeTot);
+
+  hedger::OlcNode                 head_;        // sentinel; left is the root
+  std::atomic<int>                nodeTot_;
+  std::atomic<std::size_t>        restartTot_;
+  std::atomic<std::size_t>        rebuildTot_;  // nodes relinked by rebuilds
+  std::atomic<std::size_t>        skippedTot_;  // rebuilds abandoned on conflict
+  hedger::NodePool                pool_;        // outlives epoch_, which releases into it
+  hedger::EpochReclaimer          epoch_;
+};
+} // namespace hedger
+#endif // #ifndef OLC_TREE_H_
@@ -0,0 +1,315 @@
+// packed_memory_array.cc
+//
+// Implements an ordered set on a packed memory array: a sorted array
+// with gaps, kept within density bounds by windowed rebalances.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <algorithm>
+
+#include "packed_memory_array.h"
+
+namespace hedger
+{
+// Constructor
+PackedMemoryArray::PackedMemoryArray()
+{
+  keyTot_ = 0;
+  updateTot_ = 0;
+  moveTot_ = 0;
+  Resize(kPmaMinSegment, false, 0);
+}
+
+// Destructor
+PackedMemoryArray::~PackedMemoryArray()
+{
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == added, false == already present
+bool PackedMemoryArray::Add(hedger::S_T key)
+{
+  std::size_t s = FindSegment(key);
+  hedger::S_T *segment = &slots_[s * segSize_];
+  std::size_t count = counts_[s];
+  std::size_t pos = std::lower_bound(segment, segment + count, key) - segment;
+  if (pos < count && segment[pos] == key) {
+    return false;
+  }
+  keyTot_++;
+  updateTot_++;
+
+  if (count < segSize_) {
+    std::copy_backward(segment + pos, segment + count, segment + count + 1);
+    segment[pos] = key;
+    counts_[s]++;
+    moveTot_ += count - pos + 1;
+    return true;
+  }
+
+  // Segment full: rebalance the smallest window with room to spare.
+  for (int h = 1; h <= height_; h++) {
+    std::size_t w = (std::size_t) 1 << h;
+    std::size_t first = s & ~(w - 1);
+    std::size_t m = 1;
+    for (std::size_t i = first; i < first + w; i++) {
+      m += counts_[i];
+    }
+    if (m <= UpperDensity(h) * w * segSize_) {
+      Spread(first, w, Gather(first, w, true, key));
+      return true;
+    }
+  }
+  Resize(slots_.size() * 2, true, key);
+  return true;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool PackedMemoryArray::Find(hedger::S_T key)
+{
+  std::size_t s = FindSegment(key);
+  const hedger::S_T *segment = &slots_[s * segSize_];
+  const hedger::S_T *end = segment + counts_[s];
+  const hedger::S_T *pos = std::lower_bound(segment, end, key);
+  return pos != end && *pos == key;
+}
+
+// DeleteKey
+//
+// Entry: key
+// Exit:  true == deleted, false == not present
+bool PackedMemoryArray::DeleteKey(hedger::S_T key)
+{
+  std::size_t s = FindSegment(key);
+  hedger::S_T *segment = &slots_[s * segSize_];
+  std::size_t count = counts_[s];
+  std::size_t pos = std::lower_bound(segment, segment + count, key) - segment;
+  if (pos == count || segment[pos] != key) {
+    return false;
+  }
+  std::copy(segment + pos + 1, segment + count, segment + pos);
+  counts_[s]--;
+  keyTot_--;
+  updateTot_++;
+  moveTot_ += count - pos - 1;
+
+  if (counts_[s] >= LowerDensity(0) * segSize_) {
+    return true;
+  }
+  if (0 == keyTot_) {
+    Resize(kPmaMinSegment, false, 0);
+    return true;
+  }
+
+  // Segment thin: rebalance the smallest window dense enough.
+  for (int h = 1; h <= height_; h++) {
+    std::size_t w = (std::size_t) 1 << h;
+    std::size_t first = s & ~(w - 1);
+    std::size_t m = 0;
+    for (std::size_t i = first; i < first + w; i++) {
+      m += counts_[i];
+    }
+    if (m >= LowerDensity(h) * w * segSize_) {
+      Spread(first, w, Gather(first, w, false, 0));
+      return true;
+    }
+  }
+  if (slots_.size() > (std::size_t) kPmaMinSegment) {
+    Resize(slots_.size() / 2, false, 0);
+  }
+  return true;
+}
+
+// RangeScan
+//
+// Copy the keys in [lo, hi] into out, in order, streaming through the
+// segments from the one holding lo.
+//
+// Entry: lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr to only count
+//        maximum number of keys to return
+// Exit:  number of keys returned
+std::size_t PackedMemoryArray::RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out,
+  std::size_t max)
+{
+  std::size_t n = 0;
+  std::size_t s = FindSegment(lo);
+  const hedger::S_T *segment = &slots_[s * segSize_];
+  std::size_t i = std::lower_bound(segment, segment + counts_[s], lo) - segment;
+  for (; s < segTot_; s++, i = 0) {
+    segment = &slots_[s * segSize_];
+    for (std::size_t count = counts_[s]; i < count; i++) {
+      if (segment[i] > hi || n >= max) {
+        return n;
+      }
+      if (out) {
+        out[n] = segment[i];
+      }
+      n++;
+    }
+  }
+  return n;
+}
+
+//
+// Helper functions
+//
+
+// FindSegment
+//
+// Binary search on the first key of each segment; none is empty unless
+// the whole array is.
+//
+// Entry: key
+// Exit:  last segment whose first key is <= key, or 0
+std::size_t PackedMemoryArray::FindSegment(hedger::S_T key)
+{
+  std::size_t lo = 0;
+  std::size_t hi = segTot_;
+  while (hi - lo > 1) {
+    std::size_t mid = (lo + hi) / 2;
+    if (slots_[mid * segSize_] <= key) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// UpperDensity
+//
+// Entry: window height, 0 == one segment
+// Exit:  largest fraction of the window's slots it may fill
+double PackedMemoryArray::UpperDensity(int height)
+{
+  if (0 == height_) {
+    return kPmaUpperLeaf;
+  }
+  return kPmaUpperLeaf - (kPmaUpperLeaf - kPmaUpperRoot) * height / height_;
+}
+
+// LowerDensity
+//
+// Entry: window height, 0 == one segment
+// Exit:  smallest fraction of the window's slots it must fill
+double PackedMemoryArray::LowerDensity(int height)
+{
+  if (0 == height_) {
+    return 0.0;
+  }
+  return kPmaLowerLeaf + (kPmaLowerRoot - kPmaLowerLeaf) * height / height_;
+}
+
+// Gather
+//
+// Copy the keys of a window into scratch_, in order, optionally merging
+// in one new key.
+//
+// Entry: first segment of the window
+//        segments in the window
+//        true == merge key in
+//        key
+// Exit:  number of keys gathered
+std::size_t PackedMemoryArray::Gather(std::size_t first, std::size_t segTot, bool insert,
+  hedger::S_T key)
+{
+  scratch_.clear();
+  for (std::size_t s = first; s < first + segTot; s++) {
+    const hedger::S_T *segment = &slots_[s * segSize_];
+    for (int i = 0; i < counts_[s]; i++) {
+      if (insert && key < segment[i]) {
+        scratch_.push_back(key);
+        insert = false;
+      }
+      scratch_.push_back(segment[i]);
+    }
+  }
+  if (insert) {
+    scratch_.push_back(key);
+  }
+  return scratch_.size();
+}
+
+// Spread
+//
+// Deal the first n keys of scratch_ evenly across a window.
+//
+// Entry: first segment of the window
+//        segments in the window
+//        number of keys
+void PackedMemoryArray::Spread(std::size_t first, std::size_t segTot, std::size_t n)
+{
+  std::size_t k = 0;
+  for (std::size_t i = 0; i < segTot; i++) {
+    std::size_t count = n * (i + 1) / segTot - n * i / segTot;
+    std::copy(&scratch_[k], &scratch_[k] + count, &slots_[(first + i) * segSize_]);
+    counts_[first + i] = (int) count;
+    k += count;
+  }
+  moveTot_ += n;
+}
+
+// Resize
+//
+// Rebuild the array at a new capacity, with segments of the power of two
+// nearest above log2(capacity), and spread every key evenly over it.
+//
+// Entry: capacity in slots, a power of two
+//        true == merge key in
+//        key
+void PackedMemoryArray::Resize(std::size_t capacity, bool insert, hedger::S_T key)
+{
+  std::size_t n = 0;
+  if (!slots_.empty()) {
+    n = Gather(0, counts_.size(), insert, key);
+  } else if (insert) {
+    scratch_.assign(1, key);
+    n = 1;
+  }
+
+  int log = 0;
+  while (((std::size_t) 1 << log) < capacity) {
+    log++;
+  }
+  segSize_ = kPmaMinSegment;
+  while (segSize_ < (std::size_t) log) {
+    segSize_ <<= 1;
+  }
+  if (capacity < segSize_) {
+    capacity = segSize_;
+  }
+  segTot_ = capacity / segSize_;
+  height_ = 0;
+  while (((std::size_t) 1 << height_) < segTot_) {
+    height_++;
+  }
+  slots_.assign(capacity, 0);
+  counts_.assign(segTot_, 0);
+  if (n) {
+    Spread(0, segTot_, n);
+  }
+}
+} // namespace hedger
@@ -0,0 +1,91 @@
+// packed_memory_array.h
+//
+// Implements an ordered set on a packed memory array: a sorted array
+// with gaps, kept within density bounds by windowed rebalances.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef PACKED_MEMORY_ARRAY_H_
+#define PACKED_MEMORY_ARRAY_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "algo.h"
+
+namespace hedger
+{
+const int kPmaMinSegment = 16;          // smallest segment, in slots
+
+// Density bounds, interpolated linearly from a segment (leaf) up to the
+// whole array (root).  Lower bounds stay below half the upper ones so a
+// resize lands well inside both.
+const double kPmaUpperLeaf = 1.0;
+const double kPmaUpperRoot = 0.75;
+const double kPmaLowerLeaf = 0.125;
+const double kPmaLowerRoot = 0.3;
+
+// PackedMemoryArray
+//
+// The array is cut into power-of-two segments of about log2(capacity)
+// slots, each holding its keys packed at its left end; every segment
+// holds at least one key once there are any.  Segments pair up into
+// windows of 2, 4, ... segments, like the nodes of a scapegoat tree's
+// subtrees.  An insert into a full segment, or a delete that thins one
+// below its lower bound, spreads the keys of the smallest enclosing
+// window that is within its bounds evenly across it; when even the whole
+// array is out of bounds, its capacity doubles or halves.  Keys stay in
+// contiguous memory, so a range scan streams through the array.
+class PackedMemoryArray
+{
+ public:
+  PackedMemoryArray();
+  virtual ~PackedMemoryArray();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max);
+  int Size() { return (int) keyTot_; }
+  std::size_t Capacity() { return slots_.size(); }
+  std::size_t MemoryUsage() { return slots_.size() * sizeof(hedger::S_T) + counts_.size() * sizeof(int); }
+
+  // Keys written into slots per successful Add or DeleteKey
+  double MovesPerUpdate() { return updateTot_ ? (double) moveTot_ / updateTot_ : 0.0; }
+
+ protected:
+  std::size_t FindSegment(hedger::S_T key);
+  double UpperDensity(int height);
+  double LowerDensity(int height);
+  std::size_t Gather(std::size_t first, std::size_t segTot, bool insert, hedger::S_T key);
+  void Spread(std::size_t first, std::size_t segTot, std::size_t n);
+  void Resize(std::size_t capacity, bool insert, hedger::S_T key);
+
+  std::vector<hedger::S_T>  slots_;     // segTot_ * segSize_ slots
+  std::vector<int>          counts_;    // keys in each segment
+  std::vector<hedger::S_T>  scratch_;   // keys of the window being rebalanced
+  std::size_t               segSize_;
+  std::size_t               segTot_;
+  int                       height_;    // log2(segTot_)
+  std::size_t               keyTot_;
+  std::size_t               updateTot_;
+  std::size_t               moveTot_;
+};
+} // namespace hedger
+#endif // #ifndef PACKED_MEMORY_ARRAY_H_
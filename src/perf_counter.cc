@@ -0,0 +1,90 @@
+// perf_counter.cc
+//
+// Counts hardware cache misses around a block of code.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "perf_counter.h"
+
+namespace hedger
+{
+// Constructor
+// Open the counter disabled; Start() enables it.
+PerfCounter::PerfCounter()
+{
+  fd_ = -1;
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  fd_ = (int) syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+// Destructor
+PerfCounter::~PerfCounter()
+{
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+// Start
+// Zero the counter and begin counting.
+void PerfCounter::Start()
+{
+#ifdef __linux__
+  if (fd_ >= 0) {
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+// Stop
+// Stop counting.
+// Exit: cache misses since Start(), or -1 if unavailable
+long long PerfCounter::Stop()
+{
+  long long count = -1;
+#ifdef __linux__
+  if (fd_ >= 0) {
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) {
+      count = -1;
+    }
+  }
+#endif
+  return count;
+}
+} // namespace hedger
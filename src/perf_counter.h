@@ -0,0 +1,49 @@
+// perf_counter.h
+//
+// Counts hardware cache misses around a block of code.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef PERF_COUNTER_H_
+#define PERF_COUNTER_H_
+
+namespace hedger
+{
+
+// PerfCounter
+//
+// Wraps a Linux perf_event counter for last-level cache misses of the
+// calling thread.  Where perf events are unavailable (other platforms,
+// containers, perf_event_paranoid) Available() is false and Stop()
+// returns -1.
+class PerfCounter
+{
+ public:
+  PerfCounter();
+  virtual ~PerfCounter();
+
+  bool Available() { return fd_ >= 0; }
+  void Start();
+  long long Stop();
+
+ private:
+  int fd_;
+};
+} // namespace hedger
+#endif // #ifndef PERF_COUNTER_H_
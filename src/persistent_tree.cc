@@ -0,0 +1,445 @@
+// persistent_tree.cc
+//
+// Implements a persistent (path-copying) scapegoat tree whose snapshots
+// are taken in O(1) and never block writers.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <math.h>
+
+#include <algorithm>
+#include <new>
+
+#include "persistent_tree.h"
+
+namespace hedger
+{
+// Constructor
+PersistentSnapshot::PersistentSnapshot(hedger::PersistentSnapshot &&other) :
+  tree_(other.tree_), root_(other.root_)
+{
+  other.root_ = nullptr;
+}
+
+// Destructor
+//
+// Drops the version; nodes no later version shares are retired.
+PersistentSnapshot::~PersistentSnapshot()
+{
+  if (root_) {
+    tree_->Release(root_);
+  }
+}
+
+// operator=
+//
+// Entry: snapshot to take over
+// Exit:  this snapshot
+hedger::PersistentSnapshot &PersistentSnapshot::operator=(hedger::PersistentSnapshot &&other)
+{
+  if (this != &other) {
+    if (root_) {
+      tree_->Release(root_);
+    }
+    tree_ = other.tree_;
+    root_ = other.root_;
+    other.root_ = nullptr;
+  }
+  return *this;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == present in this version
+bool PersistentSnapshot::Find(hedger::S_T key)
+{
+  hedger::PersistentNode *node = root_;
+  while (node) {
+    if (node->key == key) {
+      return true;
+    }
+    node = key < node->key ? node->left : node->right;
+  }
+  return false;
+}
+
+// RangeScan
+//
+// Copy the keys in [lo, hi] of this version into out, in order.
+//
+// Entry: lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr to only count
+//        maximum number of keys to return
+// Exit:  number of keys returned
+std::size_t PersistentSnapshot::RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out,
+  std::size_t max)
+{
+  return RangeScanRecurse(root_, lo, hi, out, max, 0);
+}
+
+// RangeScanRecurse
+//
+// In-order walk that skips subtrees outside [lo, hi].
+//
+// Entry: pointer to node
+//        lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr
+//        maximum number of keys to return
+//        keys returned so far
+// Exit:  keys returned so far
+std::size_t PersistentSnapshot::RangeScanRecurse(hedger::PersistentNode *node, hedger::S_T lo,
+  hedger::S_T hi, hedger::S_T *out, std::size_t max, std::size_t n)
+{
+  if (!node || n >= max) {
+    return n;
+  }
+  if (node->key > lo) {
+    n = RangeScanRecurse(node->left, lo, hi, out, max, n);
+  }
+  if (node->key >= lo && node->key <= hi && n < max) {
+    if (out) {
+      out[n] = node->key;
+    }
+    n++;
+  }
+  if (node->key < hi) {
+    n = RangeScanRecurse(node->right, lo, hi, out, max, n);
+  }
+  return n;
+}
+
+// Constructor
+PersistentTree::PersistentTree() : pool_(sizeof(hedger::PersistentNode))
+{
+  root_ = nullptr;
+  nodeTot_ = 0;
+  maxNodeTot_ = 0;
+  copiedTot_ = 0;
+}
+
+// Destructor
+//
+// No other thread may be using the tree, and every snapshot must have
+// been released.  Nodes, linked or retired, go with the pool's slabs.
+PersistentTree::~PersistentTree()
+{
+}
+
+// Add
+//
+// Copy the path down to the new leaf.  If the leaf lands deeper than
+// the scapegoat bound, the copied ancestor whose child holds more than
+// two thirds of its nodes is rebuilt balanced on the way back up.
+//
+// Entry: key
+// Exit:  true == added, false == already present
+bool PersistentTree::Add(hedger::S_T key)
+{
+  std::lock_guard<std::mutex> lock(writeLock_);
+  bool deep = false;
+  hedger::PersistentNode *root = Insert(root_.load(std::memory_order_relaxed), key, 1,
+    Log32(nodeTot_.load(std::memory_order_relaxed) + 1), &deep);
+  if (!root) {
+    return false;
+  }
+  Publish(root);
+  int nodeTot = nodeTot_.load(std::memory_order_relaxed) + 1;
+  nodeTot_.store(nodeTot, std::memory_order_relaxed);
+  maxNodeTot_ = std::max(maxNodeTot_, nodeTot);
+  return true;
+}
+
+// Find
+//
+// Walk the current version.  The guard keeps the nodes of a version
+// replaced during the walk from being freed under it.
+//
+// Entry: key
+// Exit:  true == present
+bool PersistentTree::Find(hedger::S_T key)
+{
+  hedger::EpochGuard guard(epoch_);
+  hedger::PersistentNode *node = root_.load(std::memory_order_acquire);
+  while (node) {
+    if (node->key == key) {
+      return true;
+    }
+    node = key < node->key ? node->left : node->right;
+  }
+  return false;
+}
+
+// DeleteKey
+//
+// Copy the path down to the key, and to its successor if it has two
+// children.  Once the tree has shrunk below two thirds of its largest
+// size since the last full rebuild, the whole tree is rebuilt.
+//
+// Entry: key
+// Exit:  true == removed, false == not present
+bool PersistentTree::DeleteKey(hedger::S_T key)
+{
+  std::lock_guard<std::mutex> lock(writeLock_);
+  bool found = false;
+  hedger::PersistentNode *root = Remove(root_.load(std::memory_order_relaxed), key, &found);
+  if (!found) {
+    return false;
+  }
+  Publish(root);
+  int nodeTot = nodeTot_.load(std::memory_order_relaxed) - 1;
+  nodeTot_.store(nodeTot, std::memory_order_relaxed);
+  if (3 * nodeTot < 2 * maxNodeTot_) {
+    if (root) {
+      Publish(Rebuild(root));
+    }
+    maxNodeTot_ = nodeTot;
+  }
+  return true;
+}
+
+// Snapshot
+//
+// Take a reference on the current version.  A root whose count has
+// already reached zero has just been replaced, so the current root is
+// read again.
+//
+// Exit:  snapshot of the current version
+hedger::PersistentSnapshot PersistentTree::Snapshot()
+{
+  hedger::EpochGuard guard(epoch_);
+  for (;;) {
+    hedger::PersistentNode *root = root_.load(std::memory_order_acquire);
+    if (!root) {
+      return hedger::PersistentSnapshot(this, nullptr);
+    }
+    int refs = root->refs.load(std::memory_order_relaxed);
+    while (refs > 0 && !root->refs.compare_exchange_weak(refs, refs + 1,
+      std::memory_order_acquire, std::memory_order_relaxed)) {
+    }
+    if (refs > 0) {
+      return hedger::PersistentSnapshot(this, root);
+    }
+  }
+}
+
+//
+// Helper functions
+//
+
+// Log32
+//
+// Gets the log-base 3/2 of q
+int const PersistentTree::Log32(int q)
+{
+  double const log23 = 2.4663034623764317;
+  return (int) ceil(log23 * log(q));
+}
+
+// NewNode
+//
+// Entry: key
+//        left child, whose reference the node takes over
+//        right child, likewise
+// Exit:  node with one reference, owned by the caller
+hedger::PersistentNode *PersistentTree::NewNode(hedger::S_T key, hedger::PersistentNode *left,
+  hedger::PersistentNode *right)
+{
+  copiedTot_.fetch_add(1, std::memory_order_relaxed);
+  return new (pool_.Alloc()) hedger::PersistentNode(key, left, right);
+}
+
+// Share
+//
+// Take another reference on a node already held.
+//
+// Entry: node, or nullptr
+// Exit:  the same node
+hedger::PersistentNode *PersistentTree::Share(hedger::PersistentNode *node)
+{
+  if (node) {
+    node->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  return node;
+}
+
+// Release
+//
+// Drop a reference.  A node left with none drops its children and is
+// retired, as a reader may still be walking it.
+//
+// Entry: node, or nullptr
+void PersistentTree::Release(hedger::PersistentNode *node)
+{
+  while (node && 1 == node->refs.fetch_sub(1, std::memory_order_acq_rel)) {
+    Release(node->left);
+    hedger::PersistentNode *right = node->right;
+    epoch_.Retire(node, hedger::NodePool::Release, &pool_, sizeof(hedger::PersistentNode));
+    node = right;
+  }
+}
+
+// Publish
+//
+// Make a new version current and drop the tree's reference on the old
+// one.  Called with the writer lock held.
+//
+// Entry: root of the new version, owned by the caller
+void PersistentTree::Publish(hedger::PersistentNode *root)
+{
+  hedger::PersistentNode *old = root_.load(std::memory_order_relaxed);
+  root_.store(root, std::memory_order_release);
+  Release(old);
+}
+
+// Insert
+//
+// Entry: subtree root
+//        key
+//        depth of node, root == 1
+//        deepest depth allowed for a new leaf
+//        set on return while a deep leaf still wants its scapegoat
+// Exit:  new subtree root, owned by the caller, or nullptr == key present
+hedger::PersistentNode *PersistentTree::Insert(hedger::PersistentNode *node, hedger::S_T key,
+  int depth, int bound, bool *deep)
+{
+  if (!node) {
+    *deep = depth > bound;
+    return NewNode(key, nullptr, nullptr);
+  }
+  if (key == node->key) {
+    return nullptr;
+  }
+
+  hedger::PersistentNode *child;
+  hedger::PersistentNode *copy;
+  if (key < node->key) {
+    child = Insert(node->left, key, depth + 1, bound, deep);
+    if (!child) {
+      return nullptr;
+    }
+    copy = NewNode(node->key, child, Share(node->right));
+  } else {
+    child = Insert(node->right, key, depth + 1, bound, deep);
+    if (!child) {
+      return nullptr;
+    }
+    copy = NewNode(node->key, Share(node->left), child);
+  }
+  if (*deep && 3 * child->size > 2 * copy->size) {
+    hedger::PersistentNode *balanced = Rebuild(copy);
+    Release(copy);
+    copy = balanced;
+    *deep = false;
+  }
+  return copy;
+}
+
+// Remove
+//
+// Entry: subtree root
+//        key
+//        set on return if the key was found
+// Exit:  new subtree root, owned by the caller; nullptr if empty or if
+//        the key was not found
+hedger::PersistentNode *PersistentTree::Remove(hedger::PersistentNode *node, hedger::S_T key,
+  bool *found)
+{
+  if (!node) {
+    *found = false;
+    return nullptr;
+  }
+  if (key < node->key) {
+    hedger::PersistentNode *left = Remove(node->left, key, found);
+    return *found ? NewNode(node->key, left, Share(node->right)) : nullptr;
+  }
+  if (key > node->key) {
+    hedger::PersistentNode *right = Remove(node->right, key, found);
+    return *found ? NewNode(node->key, Share(node->left), right) : nullptr;
+  }
+
+  *found = true;
+  if (!node->left) {
+    return Share(node->right);
+  }
+  if (!node->right) {
+    return Share(node->left);
+  }
+  hedger::PersistentNode *successor = node->right;
+  while (successor->left) {
+    successor = successor->left;
+  }
+  return NewNode(successor->key, Share(node->left), RemoveMin(node->right));
+}
+
+// RemoveMin
+//
+// Entry: subtree root, not nullptr
+// Exit:  new subtree root without its smallest key, owned by the caller
+hedger::PersistentNode *PersistentTree::RemoveMin(hedger::PersistentNode *node)
+{
+  if (!node->left) {
+    return Share(node->right);
+  }
+  return NewNode(node->key, RemoveMin(node->left), Share(node->right));
+}
+
+// Rebuild
+//
+// Entry: subtree root, still owned by the caller
+// Exit:  fresh balanced subtree with the same keys, owned by the caller
+hedger::PersistentNode *PersistentTree::Rebuild(hedger::PersistentNode *node)
+{
+  std::vector<hedger::S_T> keys;
+  keys.reserve(node->size);
+  PackRecurse(node, &keys);
+  return BuildBalanced(keys.data(), (int) keys.size());
+}
+
+// PackRecurse
+//
+// Entry: subtree root
+//        keys to append to, in order
+void PersistentTree::PackRecurse(hedger::PersistentNode *node, std::vector<hedger::S_T> *keys)
+{
+  if (node) {
+    PackRecurse(node->left, keys);
+    keys->push_back(node->key);
+    PackRecurse(node->right, keys);
+  }
+}
+
+// BuildBalanced
+//
+// Entry: pointer to sorted keys
+//        number of keys
+// Exit:  subtree root, owned by the caller
+hedger::PersistentNode *PersistentTree::BuildBalanced(const hedger::S_T *keys, int nodeTot)
+{
+  if (!nodeTot) {
+    return nullptr;
+  }
+  int m = nodeTot / 2;
+  hedger::PersistentNode *left = BuildBalanced(keys, m);
+  hedger::PersistentNode *right = BuildBalanced(keys + m + 1, nodeTot - m - 1);
+  return NewNode(keys[m], left, right);
+}
+} // namespace hedger
@@ -0,0 +1,142 @@
+// persistent_tree.h
+//
+// Implements a persistent (path-copying) scapegoat tree whose snapshots
+// are taken in O(1) and never block writers.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef PERSISTENT_TREE_H_
+#define PERSISTENT_TREE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "algo.h"
+#include "epoch.h"
+#include "node_pool.h"
+
+namespace hedger
+{
+// PersistentNode
+//
+// Never changed once built.  Each node holds one reference to each of
+// its children, so a version stays whole for as long as its root is
+// referenced; refs counts the parents and versions pointing here.
+struct PersistentNode
+{
+  PersistentNode(hedger::S_T newKey, hedger::PersistentNode *newLeft,
+    hedger::PersistentNode *newRight) :
+    key(newKey), left(newLeft), right(newRight),
+    size(1 + (newLeft ? newLeft->size : 0) + (newRight ? newRight->size : 0)), refs(1) {}
+
+  const hedger::S_T                 key;
+  hedger::PersistentNode * const    left;
+  hedger::PersistentNode * const    right;
+  const int                         size;     // nodes in this subtree
+  std::atomic<int>                  refs;
+};
+
+class PersistentTree;
+
+// PersistentSnapshot
+//
+// One version of a PersistentTree, held by reference count.  Lookups
+// and scans on it take no lock and see no later writes, however long
+// they run.  Snapshots may move but not be copied, and must be released
+// before their tree is destroyed.
+class PersistentSnapshot
+{
+ public:
+  PersistentSnapshot() : tree_(nullptr), root_(nullptr) {}
+  PersistentSnapshot(hedger::PersistentSnapshot &&other);
+  PersistentSnapshot(const hedger::PersistentSnapshot &other) = delete;
+  virtual ~PersistentSnapshot();
+  hedger::PersistentSnapshot &operator=(hedger::PersistentSnapshot &&other);
+  hedger::PersistentSnapshot &operator=(const hedger::PersistentSnapshot &other) = delete;
+
+  bool Find(hedger::S_T key);
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max);
+  int Size() { return root_ ? root_->size : 0; }
+
+ protected:
+  friend class PersistentTree;
+  PersistentSnapshot(hedger::PersistentTree *tree, hedger::PersistentNode *root) :
+    tree_(tree), root_(root) {}
+  static std::size_t RangeScanRecurse(hedger::PersistentNode *node, hedger::S_T lo,
+    hedger::S_T hi, hedger::S_T *out, std::size_t max, std::size_t n);
+
+  hedger::PersistentTree *    tree_;
+  hedger::PersistentNode *    root_;
+};
+
+// PersistentTree
+//
+// Functional scapegoat tree.  An update copies the path from the root to
+// the change and publishes the new root with one store, sharing every
+// untouched subtree with the version before; a rebuild likewise builds
+// fresh nodes for the scapegoat's subtree.  Writers are serialized by a
+// lock, but readers never take it: Find walks the current version under
+// an epoch guard, and Snapshot pins the current version by raising its
+// root's count.  A node whose count drops to zero drops its children in
+// turn and is retired through an EpochReclaimer, so a reader that loaded
+// the old root just before it was replaced can still finish its walk.
+class PersistentTree
+{
+ public:
+  PersistentTree();
+  virtual ~PersistentTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  hedger::PersistentSnapshot Snapshot();
+  int Size() { return nodeTot_.load(std::memory_order_relaxed); }
+  std::size_t MemoryUsage() { return pool_.SlabBytes(); }
+  std::size_t LiveBytes() { return pool_.LiveBytes(); }
+  std::size_t CopiedTot() { return copiedTot_.load(std::memory_order_relaxed); }
+
+ protected:
+  friend class PersistentSnapshot;
+  static int const Log32(int q);
+  static int SizeOf(hedger::PersistentNode *node) { return node ? node->size : 0; }
+  hedger::PersistentNode *NewNode(hedger::S_T key, hedger::PersistentNode *left,
+    hedger::PersistentNode *right);
+  static hedger::PersistentNode *Share(hedger::PersistentNode *node);
+  void Release(hedger::PersistentNode *node);
+  void Publish(hedger::PersistentNode *root);
+  hedger::PersistentNode *Insert(hedger::PersistentNode *node, hedger::S_T key, int depth,
+    int bound, bool *deep);
+  hedger::PersistentNode *Remove(hedger::PersistentNode *node, hedger::S_T key, bool *found);
+  hedger::PersistentNode *RemoveMin(hedger::PersistentNode *node);
+  hedger::PersistentNode *Rebuild(hedger::PersistentNode *node);
+  void PackRecurse(hedger::PersistentNode *node, std::vector<hedger::S_T> *keys);
+  hedger::PersistentNode *BuildBalanced(const hedger::S_T *keys, int nodeTot);
+
+  std::atomic<hedger::PersistentNode *>   root_;        // current version; holds one reference
+  std::atomic<int>                        nodeTot_;
+  int                                     maxNodeTot_;  // most nodes since the last full rebuild
+  std::atomic<std::size_t>                copiedTot_;   // nodes built by updates and rebuilds
+  std::mutex                              writeLock_;   // one writer at a time
+  hedger::NodePool                        pool_;        // outlives epoch_, which releases into it
+  hedger::EpochReclaimer                  epoch_;
+};
+} // namespace hedger
+#endif // #ifndef PERSISTENT_TREE_H_
@@ -0,0 +1,146 @@
+// radix_sort.cc
+//
+// Parallel least-significant-digit radix sort of S_T keys.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "radix_sort.h"
+
+namespace hedger
+{
+typedef std::make_unsigned<hedger::S_T>::type RadixKey;
+
+// Flipping the sign bit orders signed keys as unsigned
+const RadixKey kRadixSign = (RadixKey) 1 << (sizeof(hedger::S_T) * 8 - 1);
+
+// Digit
+//
+// Entry: key
+//        bit offset of the digit
+// Exit:  digit of the key with its sign bit flipped
+static inline int Digit(hedger::S_T key, int shift)
+{
+  return (int) ((((RadixKey) key ^ kRadixSign) >> shift) & (kRadixBuckets - 1));
+}
+
+// RadixSort
+//
+// Sort keys in place, one kRadixBits digit per pass from the least
+// significant.  Each pass splits the keys into one contiguous chunk per
+// thread.  Every thread counts the digits in its chunk, the counts are
+// turned into a start offset per thread and bucket, in bucket order
+// then thread order, and every thread then scatters its chunk to the
+// other buffer from its own offsets, so the pass stays stable without
+// any locking.  A pass whose digit is the same for every key is
+// skipped.
+//
+// Entry: pointer to keys
+//        number of keys
+//        number of threads
+void RadixSort(hedger::S_T *keys, std::size_t n, int threadTot)
+{
+  if (n < 2) {
+    return;
+  }
+  threadTot = (int) std::max((std::size_t) 1, std::min((std::size_t) threadTot,
+    n / kRadixGrain));
+
+  void *block;
+  if (posix_memalign(&block, kCacheLine, n * sizeof(hedger::S_T))) {
+    throw std::bad_alloc();
+  }
+  hedger::S_T *from = keys;
+  hedger::S_T *to = (hedger::S_T *) block;
+  std::vector<std::size_t> offsets(threadTot * kRadixBuckets);
+
+  for (int shift = 0; shift < (int) sizeof(hedger::S_T) * 8; shift += kRadixBits) {
+    // Count
+    auto count = [&](int t) {
+      std::size_t *counts = &offsets[t * kRadixBuckets];
+      std::fill(counts, counts + kRadixBuckets, 0);
+      for (std::size_t i = n * t / threadTot; i < n * (t + 1) / threadTot; i++) {
+        counts[Digit(from[i], shift)]++;
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadTot; t++) {
+      threads.emplace_back(count, t);
+    }
+    count(0);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    threads.clear();
+
+    // Skip the pass if every key has the same digit
+    bool same = false;
+    for (int b = 0; b < kRadixBuckets && !same; b++) {
+      std::size_t total = 0;
+      for (int t = 0; t < threadTot; t++) {
+        total += offsets[t * kRadixBuckets + b];
+      }
+      same = (total == n);
+    }
+    if (same) {
+      continue;
+    }
+
+    // Turn counts into offsets
+    std::size_t sum = 0;
+    for (int b = 0; b < kRadixBuckets; b++) {
+      for (int t = 0; t < threadTot; t++) {
+        std::size_t c = offsets[t * kRadixBuckets + b];
+        offsets[t * kRadixBuckets + b] = sum;
+        sum += c;
+      }
+    }
+
+    // Scatter
+    auto scatter = [&](int t) {
+      std::size_t *next = &offsets[t * kRadixBuckets];
+      for (std::size_t i = n * t / threadTot; i < n * (t + 1) / threadTot; i++) {
+        to[next[Digit(from[i], shift)]++] = from[i];
+      }
+    };
+    for (int t = 1; t < threadTot; t++) {
+      threads.emplace_back(scatter, t);
+    }
+    scatter(0);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    std::swap(from, to);
+  }
+
+  if (from != keys) {
+    memcpy(keys, from, n * sizeof(hedger::S_T));
+  }
+  free(block);
+}
+} // namespace hedger
@@ -0,0 +1,43 @@
+// radix_sort.h
+//
+// Parallel least-significant-digit radix sort of S_T keys.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef RADIX_SORT_H_
+#define RADIX_SORT_H_
+
+#include <cstddef>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Bits per radix digit
+const int kRadixBits = 8;
+
+// Buckets per digit
+const int kRadixBuckets = 1 << kRadixBits;
+
+// Keys below which a sort runs on one thread
+const std::size_t kRadixGrain = 1 << 16;
+
+void RadixSort(hedger::S_T *keys, std::size_t n, int threadTot = 1);
+} // namespace hedger
+#endif // #ifndef RADIX_SORT_H_
@@ -21,7 +21,15 @@
 //
 
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include <algorithm>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "radix_sort.h"
 #include "scapegoat_tree.h"
 
 namespace hedger
@@ -29,12 +37,15 @@ namespace hedger
 // Constructor
 ScapegoatTree::ScapegoatTree() : BSTree::BSTree()
 {
+  rebuildTot_ = 0;
+  finger_ = nullptr;
+  fingerDepth_ = 0;
 }
 
 // Destructor
 ScapegoatTree::~ScapegoatTree()
 {
-  // TODO: delete all nodes to eliminate memory leaks
+  // Nodes are released by BSTree::~BSTree
 }
 
 // Log32
@@ -56,26 +67,250 @@ int const ScapegoatTree::Log32(int q)
 // Exit:  pointer to new node
 hedger::Node *ScapegoatTree::Add(hedger::S_T key)
 {
-  // Use BSTree's regular unbalanced insertion
+  return Add(key, nullptr);
+}
+
+// add
+//
+// Finger insert from a node returned earlier.  The depth test needs the
+// new node's depth from the root, which is carried over from the hint's.
+// The tree keeps the depth of the node its last Add returned, the usual
+// hint, until a rebuild or delete can move it; any other hint has its
+// depth counted up its parent pointers.
+//
+// Entry: key of new node
+//        hint node, or nullptr to start at the root
+// Exit:  pointer to new node
+hedger::Node *ScapegoatTree::Add(hedger::S_T key, hedger::Node *hint)
+{
+  int depth;
+  hedger::Node *node = AddUnchecked(key, hint, &depth);
+  CheckDepth(node, depth);
+  return node;
+}
+
+// AddDeferred
+//
+// Add as above, but leave the depth test for CheckDeferred, so a batch
+// of adds pays for one scapegoat search and rebuild rather than one per
+// add.  Only nodes that landed deeper than the bound are kept.  Until
+// CheckDeferred runs the tree may exceed its height bound.
+//
+// Entry: key of new node
+//        hint node, or nullptr to start at the root
+// Exit:  pointer to new node
+hedger::Node *ScapegoatTree::AddDeferred(hedger::S_T key, hedger::Node *hint)
+{
   int depth;
-  hedger::Node *node = BSTree::Add(key, &depth);
+  hedger::Node *node = AddUnchecked(key, hint, &depth);
+  if (depth > Log32(nodeTot_)) {
+    deferred_.push_back(hedger::DeferredCheck { node, depth, rebuildTot_ });
+  }
+  return node;
+}
+
+// CheckDeferred
+//
+// Run the depth tests AddDeferred left, deepest node first.  Usually the
+// first rebuild takes in the rest; a node whose depth a rebuild may have
+// changed has it recounted, and is passed over if no longer too deep.
+// Several adds can stack up a path, so the lowest scapegoat may not lift
+// a node far enough; the test repeats from its new depth until no
+// rebuild is needed.
+void ScapegoatTree::CheckDeferred()
+{
+  std::sort(deferred_.begin(), deferred_.end(),
+    [](const hedger::DeferredCheck &a, const hedger::DeferredCheck &b) {
+      return a.depth > b.depth;
+    });
+  for (const auto &check : deferred_) {
+    int depth = check.rebuildTot == rebuildTot_ ? check.depth : Depth(check.node);
+    std::size_t rebuildTot;
+    do {
+      rebuildTot = rebuildTot_;
+      CheckDepth(check.node, depth);
+      depth = fingerDepth_;
+    } while (rebuildTot != rebuildTot_);
+  }
+  deferred_.clear();
+}
+
+// DeleteKey
+//
+// Removing a node can lift the nodes below it, so the kept finger depth
+// is dropped.  Deferred depth tests run first, while their nodes are
+// sure to be in the tree.
+//
+// Entry: key
+// Exit:  true == success
+bool ScapegoatTree::DeleteKey(hedger::S_T key)
+{
+  CheckDeferred();
+  finger_ = nullptr;
+  return BSTree::DeleteKey(key);
+}
+
+// DeleteNode
+//
+// As DeleteKey, from a subtree root.
+//
+// Entry: pointer to node
+//        key
+// Exit:  pointer to node
+hedger::Node *ScapegoatTree::DeleteNode(hedger::Node *node, hedger::S_T key)
+{
+  CheckDeferred();
+  finger_ = nullptr;
+  return BSTree::DeleteNode(node, key);
+}
+
+// Build
+//
+// Bulk load: merge the keys with those already held and rebuild the
+// whole tree perfectly balanced, holding what one Add per key would,
+// duplicates included.  The keys are radix sorted on threadTot threads,
+// then the top log2(threadTot) levels of the tree are split across
+// threads.  Each
+// thread places the nodes of its subtree in a slab of its own, so
+// allocation takes no shared lock and the slab's pages are first
+// touched by the thread that builds them.  Keys need not be sorted.
+// On allocation failure the tree is left empty and
+// std::bad_alloc is thrown.
+//
+// Entry: pointer to keys
+//        number of keys
+//        number of threads
+void ScapegoatTree::Build(const hedger::S_T *keys, std::size_t n, int threadTot)
+{
+  std::size_t keyTot = nodeTot_ + n;
+  if (!keyTot) {
+    return;
+  }
+  void *block;
+  if (posix_memalign(&block, kCacheLine, keyTot * sizeof(hedger::S_T))) {
+    throw std::bad_alloc();
+  }
+  hedger::S_T *sorted = (hedger::S_T *) block;
+  PackKeys(sorted);
+  if (n) {
+    memcpy(sorted + nodeTot_, keys, n * sizeof(hedger::S_T));
+  }
+  RadixSort(sorted, keyTot, threadTot);
+
+  DeleteRecursive(root_);
+  FreeSlabs();
+  root_ = nullptr;
+  finger_ = nullptr;
+  deferred_.clear();
+  nodeTot_ = 0;
+  size_ = 0;
+
+  // Tasks form a binary tree of ids from 1; the nodes splitting the top
+  // levels live in their own small slab, indexed by id
+  int levels = 0;
+  while ((1 << levels) < threadTot) {
+    levels++;
+  }
+  std::vector<hedger::NodeSlab> slabs(2 << levels, hedger::NodeSlab { nullptr, 0 });
+  hedger::NodeSlab top = { nullptr, 0 };
+  if (levels) {
+    if (posix_memalign(&block, kCacheLine, (1 << levels) * sizeof(hedger::Node))) {
+      free(sorted);
+      throw std::bad_alloc();
+    }
+    top = { (hedger::Node *) block, (std::size_t) 1 << levels };
+  }
+  hedger::Node *root = BuildParallel(sorted, (int) keyTot, 1, levels, slabs.data(), top.nodes);
+  free(sorted);
 
+  bool failed = false;
+  for (const auto &slab : slabs) {
+    failed = failed || (slab.nodeTot && !slab.nodes);
+  }
+  if (top.nodes) {
+    slabs_.push_back(top);
+  }
+  for (const auto &slab : slabs) {
+    if (slab.nodes) {
+      slabs_.push_back(slab);
+    }
+  }
+  if (failed) {
+    FreeSlabs();
+    throw std::bad_alloc();
+  }
+
+  root_ = root;
+  root_->parent = nullptr;
+  nodeTot_ = (int) keyTot;
+  size_ = nodeTot_;
+  maxSize_ = std::max(maxSize_, size_);
+}
+
+// AddUnchecked
+//
+// Link a new node, from the hint if there is one, and keep it as the
+// finger.  No depth test.
+//
+// Entry: key of new node
+//        hint node, or nullptr to start at the root
+//        pointer to depth int, root == 1
+// Exit:  pointer to new node
+hedger::Node *ScapegoatTree::AddUnchecked(hedger::S_T key, hedger::Node *hint, int *depth)
+{
+  hedger::Node *node;
+  if (nullptr == hint || nullptr == root_) {
+    // Use BSTree's regular unbalanced insertion
+    node = BSTree::Add(key, depth);
+  } else {
+    int hintDepth = hint == finger_ ? fingerDepth_ : Depth(hint);
+    node = AddNear(key, hint, hintDepth, depth);
+  }
+  finger_ = node;
+  fingerDepth_ = *depth;
+  return node;
+}
+
+// CheckDepth
+//
+// Rebuild at the scapegoat if a new node landed too deep.  A rebuild
+// moves the new node, so its depth is recounted up to the node above the
+// rebuilt subtree and kept as the finger depth.
+//
+// Entry: pointer to new node
+//        its depth, root == 1
+void ScapegoatTree::CheckDepth(hedger::Node *node, int depth)
+{
   // Is it time to rebalance?
   int q = Log32(nodeTot_);
   if (depth > q) {
-    // Walk up tree starting at our node.
+    // Walk up tree starting at our node.  Each parent's size is the
+    // child's plus the sibling's, so only the siblings are counted.
     hedger::Node *walk = node->parent;
     if (walk) {
-      while (3 * SizeOfSubstree(walk) <= 2 * SizeOfSubstree(walk->parent)) {
-        walk = walk->parent;
-      }
-      if (walk->parent) {
-        Rebalance(walk->parent);
+      int walkSize = SizeOfSubstree(walk);
+      int walkDepth = depth - 1;
+      while (walk->parent) {
+        hedger::Node *parent = walk->parent;
+        hedger::Node *sibling = parent->left == walk ? parent->right : parent->left;
+        int parentSize = walkSize + 1 + SizeOfSubstree(sibling);
+        if (3 * walkSize > 2 * parentSize) {
+          hedger::Node *above = parent->parent;
+          Rebalance(parent, parentSize);
+          int nodeDepth = walkDepth - 2;
+          for (hedger::Node *up = node; up != above; up = up->parent) {
+            nodeDepth++;
+          }
+          finger_ = node;
+          fingerDepth_ = nodeDepth;
+          break;
+        }
+        walk = parent;
+        walkSize = parentSize;
+        walkDepth--;
       }
     }
   }
-
-  return node;
 }
 
 // SizeOfSubstree
@@ -116,20 +351,22 @@ int ScapegoatTree::PackIntoArray(hedger::Node *node, hedger::Node *rebuildArray[
 // Flatten the tree and rebuild it from the designated root node.
 //
 // Entry: root node of substree to rebuild
+//        node total of the substree
 // Exit:
-void ScapegoatTree::Rebalance(hedger::Node *node)
+void ScapegoatTree::Rebalance(hedger::Node *node, int nodeTot)
 {
   // Allocate temporary array for new flattened tree.
   // This array holds pointers to nodes.
-  int nodeTot = SizeOfSubstree(node);
+  rebuildTot_ += nodeTot;
+  finger_ = nullptr;
   hedger::Node *parent = node->parent;
   hedger::Node **rebuildArray = new hedger::Node* [nodeTot];
   PackIntoArray(node, rebuildArray, 0);
 
   // Recursively rebuild of array from flattened tree
   if (!parent) {
-    hedger::Node *root = BuildBalanced(rebuildArray, 0, nodeTot);
-    root->parent = nullptr;
+    root_ = BuildBalanced(rebuildArray, 0, nodeTot);
+    root_->parent = nullptr;
   } else if (parent->right == node) {
     parent->right = BuildBalanced(rebuildArray, 0, nodeTot);
     parent->right->parent = parent;
@@ -137,6 +374,7 @@ void ScapegoatTree::Rebalance(hedger::Node *node)
     parent->left = BuildBalanced(rebuildArray, 0, nodeTot);
     parent->left->parent = parent;
   }
+  delete [] rebuildArray;
 }
 
 // BuildBalanced
@@ -166,4 +404,79 @@ hedger::Node *ScapegoatTree::BuildBalanced(hedger::Node **rebuildArray, int i, i
 
   return rebuildArray[i + m];
 }
+
+// BuildParallel
+//
+// Build a balanced subtree over sorted keys.  Above the last level of
+// tasks, the median node comes from the top slab, the left half is built
+// on a new thread and the right half on this one.  A task at the last
+// level, or too small to be worth a thread, allocates a slab for all of
+// its nodes and builds its subtree there.
+//
+// Entry: pointer to sorted keys
+//        number of keys
+//        task id, root == 1
+//        task levels left to split
+//        slab per task id, filled in
+//        top slab, indexed by task id
+// Exit:  subtree root, or nullptr == empty or allocation failed
+hedger::Node *ScapegoatTree::BuildParallel(const hedger::S_T *keys, int nodeTot, int id,
+  int levels, hedger::NodeSlab *slabs, hedger::Node *top)
+{
+  if (0 == levels || nodeTot < kBuildGrain) {
+    void *block = nullptr;
+    if (nodeTot && posix_memalign(&block, kCacheLine, nodeTot * sizeof(hedger::Node))) {
+      block = nullptr;
+    }
+    slabs[id] = { (hedger::Node *) block, (std::size_t) nodeTot };
+    return block ? BuildKeys(keys, nodeTot, (hedger::Node *) block) : nullptr;
+  }
+
+  int m = nodeTot / 2;
+  hedger::Node *node = new (&top[id]) hedger::Node(keys[m]);
+  node->slab = 1;
+  hedger::Node *left = nullptr;
+  std::thread worker([&]() {
+    left = BuildParallel(keys, m, 2 * id, levels - 1, slabs, top);
+  });
+  node->right = BuildParallel(keys + m + 1, nodeTot - m - 1, 2 * id + 1, levels - 1, slabs, top);
+  worker.join();
+  node->left = left;
+  if (node->left) {
+    node->left->parent = node;
+  }
+  if (node->right) {
+    node->right->parent = node;
+  }
+  return node;
+}
+
+// BuildKeys
+//
+// Build a balanced subtree over sorted keys, constructing the node for
+// keys[i] in nodes[i].
+//
+// Entry: pointer to sorted keys
+//        number of keys
+//        pointer to room for nodeTot nodes
+// Exit:  subtree root
+hedger::Node *ScapegoatTree::BuildKeys(const hedger::S_T *keys, int nodeTot, hedger::Node *nodes)
+{
+  if (!nodeTot) {
+    return nullptr;
+  }
+
+  int m = nodeTot / 2;
+  hedger::Node *node = new (&nodes[m]) hedger::Node(keys[m]);
+  node->slab = 1;
+  node->left = BuildKeys(keys, m, nodes);
+  if (node->left) {
+    node->left->parent = node;
+  }
+  node->right = BuildKeys(keys + m + 1, nodeTot - m - 1, nodes + m + 1);
+  if (node->right) {
+    node->right->parent = node;
+  }
+  return node;
+}
 } // namespace hedger
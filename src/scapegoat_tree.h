@@ -23,10 +23,25 @@
 #ifndef SCAPEGOAT_H_
 #define SCAPEGOAT_H_
 
+#include <cstddef>
+#include <vector>
+
 #include "bstree.h"
 
 namespace hedger
 {
+// Keys below which Build stops splitting work across threads
+const int kBuildGrain = 1 << 14;
+
+// DeferredCheck
+//
+// A node added too deep by AddDeferred, awaiting its depth test.
+struct DeferredCheck
+{
+  hedger::Node *      node;
+  int                 depth;      // root == 1
+  std::size_t         rebuildTot; // RebuildTot() when depth was taken
+};
 
 class ScapegoatTree : public hedger::BSTree
 {
@@ -34,15 +49,32 @@ class ScapegoatTree : public hedger::BSTree
     ScapegoatTree();
     virtual ~ScapegoatTree();
     hedger::Node *Add(hedger::S_T key);
+    hedger::Node *Add(hedger::S_T key, hedger::Node *hint);
+    hedger::Node *AddDeferred(hedger::S_T key, hedger::Node *hint);
+    void CheckDeferred();
+    bool DeleteKey(hedger::S_T key);
+    hedger::Node *DeleteNode(hedger::Node *node, hedger::S_T key);
+    void Build(const hedger::S_T *keys, std::size_t n, int threadTot = 1);
+    std::size_t RebuildTot() { return rebuildTot_; }
 
   private:
     static int const Log32(int q);
+    hedger::Node *AddUnchecked(hedger::S_T key, hedger::Node *hint, int *depth);
+    void CheckDepth(hedger::Node *node, int depth);
     hedger::Node *FindScapegoat(hedger::Node *node);
     bool IsBalancedAtNode(hedger::Node *node);
     int SizeOfSubstree(hedger::Node *node);
     int PackIntoArray(hedger::Node *node, hedger::Node *rebuildArray[], int i);
-    void Rebalance(hedger::Node *node);
+    void Rebalance(hedger::Node *node, int nodeTot);
     hedger::Node *BuildBalanced(hedger::Node **rebuildArray, int i, int nodeTot);
+    hedger::Node *BuildParallel(const hedger::S_T *keys, int nodeTot, int id, int levels,
+      hedger::NodeSlab *slabs, hedger::Node *top);
+    hedger::Node *BuildKeys(const hedger::S_T *keys, int nodeTot, hedger::Node *nodes);
+
+    std::size_t rebuildTot_;    // nodes relinked by Rebalance, for write amplification
+    hedger::Node *finger_;      // node last returned by Add, while its depth holds
+    int fingerDepth_;           // depth of finger_, root == 1
+    std::vector<hedger::DeferredCheck> deferred_;  // too-deep nodes from AddDeferred
 };
 } // namespace hedger
 #endif // #ifndef SCAPEGOAT_H_
@@ -0,0 +1,212 @@
+// sharded_tree.cc
+//
+// Implements a thread-safe ordered set split into independently locked
+// scapegoat tree shards.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include "sharded_tree.h"
+
+namespace hedger
+{
+// Constructor
+//
+// Entry: number of shards
+//        partitioning policy
+//        lowest key of the range partitioned key space
+//        highest key; keys outside [lo, hi] go to the end shards
+ShardedTree::ShardedTree(int shardTot, hedger::ShardPolicy policy, hedger::S_T lo,
+  hedger::S_T hi)
+{
+  if (shardTot < 1 || lo > hi) {
+    throw std::invalid_argument("ShardedTree: need shards and lo <= hi");
+  }
+  shardTot_ = shardTot;
+  policy_ = policy;
+  lo_ = lo;
+  hi_ = hi;
+  // C++14 new ignores alignas beyond the default, so align by hand.
+  void *mem;
+  if (posix_memalign(&mem, kCacheLine, shardTot * sizeof(hedger::Shard))) {
+    throw std::bad_alloc();
+  }
+  shards_ = (hedger::Shard *) mem;
+  for (int s = 0; s < shardTot; s++) {
+    new (&shards_[s]) hedger::Shard();
+  }
+}
+
+// Destructor
+ShardedTree::~ShardedTree()
+{
+  for (int s = 0; s < shardTot_; s++) {
+    shards_[s].~Shard();
+  }
+  free(shards_);
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == added, false == already present
+bool ShardedTree::Add(hedger::S_T key)
+{
+  hedger::Shard &shard = shards_[ShardOf(key)];
+  std::lock_guard<std::mutex> guard(shard.lock);
+  if (shard.tree.Find(key)) {
+    return false;
+  }
+  shard.tree.Add(key);
+  return true;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool ShardedTree::Find(hedger::S_T key)
+{
+  hedger::Shard &shard = shards_[ShardOf(key)];
+  std::lock_guard<std::mutex> guard(shard.lock);
+  return shard.tree.Find(key) != nullptr;
+}
+
+// DeleteKey
+//
+// Entry: key
+// Exit:  true == deleted, false == not present
+bool ShardedTree::DeleteKey(hedger::S_T key)
+{
+  hedger::Shard &shard = shards_[ShardOf(key)];
+  std::lock_guard<std::mutex> guard(shard.lock);
+  return shard.tree.DeleteKey(key);
+}
+
+// RangeScan
+//
+// Copy the keys in [lo, hi] into out, in order, across shards.
+//
+// Entry: lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr to only count
+//        maximum number of keys to return
+// Exit:  number of keys returned
+std::size_t ShardedTree::RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out,
+  std::size_t max)
+{
+  if (lo > hi) {
+    return 0;
+  }
+  int first = 0;
+  int last = shardTot_ - 1;
+  if (kShardRange == policy_) {
+    first = ShardOf(lo);
+    last = ShardOf(hi);
+  }
+  for (int s = first; s <= last; s++) {
+    shards_[s].lock.lock();
+  }
+
+  std::size_t n = 0;
+  if (kShardRange == policy_) {
+    // Shards hold consecutive key ranges: concatenate.
+    for (int s = first; s <= last && n < max; s++) {
+      n += shards_[s].tree.RangeScan(lo, hi, out ? out + n : nullptr, max - n);
+    }
+  } else {
+    // Every shard may hold part of the range: gather, sort, trim.
+    std::vector<hedger::S_T> keys;
+    for (int s = first; s <= last; s++) {
+      std::size_t tot = shards_[s].tree.RangeScan(lo, hi, nullptr, SIZE_MAX);
+      std::size_t at = keys.size();
+      keys.resize(at + tot);
+      shards_[s].tree.RangeScan(lo, hi, keys.data() + at, tot);
+    }
+    std::sort(keys.begin(), keys.end());
+    n = std::min(max, keys.size());
+    if (out) {
+      std::copy(keys.begin(), keys.begin() + n, out);
+    }
+  }
+
+  for (int s = first; s <= last; s++) {
+    shards_[s].lock.unlock();
+  }
+  return n;
+}
+
+// Size
+//
+// Exit:  keys across all shards; not a snapshot under concurrent updates
+int ShardedTree::Size()
+{
+  int tot = 0;
+  for (int s = 0; s < shardTot_; s++) {
+    std::lock_guard<std::mutex> guard(shards_[s].lock);
+    tot += shards_[s].tree.Size();
+  }
+  return tot;
+}
+
+// MemoryUsage
+//
+// Exit:  bytes held by the shard trees and the shard array
+std::size_t ShardedTree::MemoryUsage()
+{
+  std::size_t bytes = shardTot_ * sizeof(hedger::Shard);
+  for (int s = 0; s < shardTot_; s++) {
+    std::lock_guard<std::mutex> guard(shards_[s].lock);
+    bytes += shards_[s].tree.MemoryUsage();
+  }
+  return bytes;
+}
+
+//
+// Helper functions
+//
+
+// ShardOf
+//
+// Entry: key
+// Exit:  index of the shard owning key
+int ShardedTree::ShardOf(hedger::S_T key)
+{
+  if (kShardHash == policy_) {
+    // Fibonacci hashing; the high bits scale to [0, shardTot_).
+    uint32_t h = (uint32_t) key * 0x9e3779b1u;
+    return (int) (((uint64_t) h * shardTot_) >> 32);
+  }
+  if (key <= lo_) {
+    return 0;
+  }
+  if (key >= hi_) {
+    return shardTot_ - 1;
+  }
+  uint64_t span = (uint64_t) ((int64_t) hi_ - lo_) + 1;
+  return (int) ((uint64_t) ((int64_t) key - lo_) * shardTot_ / span);
+}
+} // namespace hedger
@@ -0,0 +1,89 @@
+// sharded_tree.h
+//
+// Implements a thread-safe ordered set split into independently locked
+// scapegoat tree shards.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef SHARDED_TREE_H_
+#define SHARDED_TREE_H_
+
+#include <limits.h>
+
+#include <cstddef>
+#include <mutex>
+
+#include "algo.h"
+#include "scapegoat_tree.h"
+
+namespace hedger
+{
+const int kShardTot = 16;
+
+enum ShardPolicy
+{
+  kShardHash,                   // key hash picks the shard
+  kShardRange                   // equal slices of [lo, hi] in key order
+};
+
+// Shard
+//
+// One partition.  Each sits on its own cache lines so that threads
+// locking neighbouring shards do not contend on a shared line.
+struct alignas(kCacheLine) Shard
+{
+  std::mutex                lock;
+  hedger::ScapegoatTree     tree;
+};
+
+// ShardedTree
+//
+// Add, Find and DeleteKey lock only the shard owning the key, so threads
+// working on different shards run in parallel.  RangeScan locks the
+// shards it covers in ascending order, which cannot deadlock, and holds
+// them all until done, so its result is a consistent snapshot.  Range
+// partitioning keeps shards in key order and visits only the shards
+// overlapping the range; hash partitioning spreads any key distribution
+// evenly but has to scan every shard and sort.
+class ShardedTree
+{
+ public:
+  ShardedTree(int shardTot = kShardTot, hedger::ShardPolicy policy = kShardHash,
+    hedger::S_T lo = 0, hedger::S_T hi = INT_MAX);
+  virtual ~ShardedTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max);
+  int Size();
+  std::size_t MemoryUsage();
+  int ShardTot() { return shardTot_; }
+
+ protected:
+  int ShardOf(hedger::S_T key);
+
+  hedger::Shard *       shards_;
+  int                   shardTot_;
+  hedger::ShardPolicy   policy_;
+  hedger::S_T           lo_;          // range partitioning bounds
+  hedger::S_T           hi_;
+};
+} // namespace hedger
+#endif // #ifndef SHARDED_TREE_H_
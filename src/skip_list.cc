@@ -0,0 +1,213 @@
+// skip_list.cc
+//
+// Implements a skip list ordered set.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <new>
+
+#include "skip_list.h"
+
+namespace hedger
+{
+// Constructor
+//
+// Entry: probability that a tower grows past each level
+SkipList::SkipList(double p)
+{
+  threshold_ = (uint32_t) (p * 4294967296.0);
+  seed_ = ((uint64_t) rand() << 32) ^ (uint64_t) rand() ^ 0x9e3779b97f4a7c15ull;
+  level_ = 1;
+  nodeTot_ = 0;
+  bytes_ = 0;
+  head_ = NewNode(0, kSkipListMaxLevel);
+}
+
+// Destructor
+SkipList::~SkipList()
+{
+  hedger::SkipNode *node = head_;
+  while (node) {
+    hedger::SkipNode *next = node->next[0];
+    FreeNode(node);
+    node = next;
+  }
+}
+
+// RandomLevel
+//
+// Draw a tower height from the geometric distribution with parameter p.
+//
+// Exit: level in [1, kSkipListMaxLevel]
+int SkipList::RandomLevel()
+{
+  int level = 1;
+  for (;;) {
+    seed_ ^= seed_ << 13;
+    seed_ ^= seed_ >> 7;
+    seed_ ^= seed_ << 17;
+    if ((uint32_t) (seed_ >> 32) >= threshold_ || level >= kSkipListMaxLevel) {
+      return level;
+    }
+    level++;
+  }
+}
+
+// FindPredecessors
+//
+// Walk down from the top level, recording at each level the last node
+// whose key is less than key.
+//
+// Entry: key
+//        array of kSkipListMaxLevel predecessors to fill, or nullptr
+// Exit:  first node at level 0 with key >= key, or nullptr
+hedger::SkipNode *SkipList::FindPredecessors(hedger::S_T key, hedger::SkipNode **update)
+{
+  hedger::SkipNode *node = head_;
+  for (int i = level_ - 1; i >= 0; i--) {
+    while (node->next[i] && node->next[i]->key < key) {
+      node = node->next[i];
+    }
+    if (update) {
+      update[i] = node;
+    }
+  }
+  return node->next[0];
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == inserted, false == key already present
+bool SkipList::Add(hedger::S_T key)
+{
+  hedger::SkipNode *update[kSkipListMaxLevel];
+  hedger::SkipNode *found = FindPredecessors(key, update);
+  if (found && found->key == key) {
+    return false;
+  }
+
+  int level = RandomLevel();
+  for (int i = level_; i < level; i++) {
+    update[i] = head_;
+  }
+  if (level > level_) {
+    level_ = level;
+  }
+
+  hedger::SkipNode *node = NewNode(key, level);
+  for (int i = 0; i < level; i++) {
+    node->next[i] = update[i]->next[i];
+    update[i]->next[i] = node;
+  }
+  nodeTot_++;
+  return true;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool SkipList::Find(hedger::S_T key)
+{
+  hedger::SkipNode *node = FindPredecessors(key, nullptr);
+  return node && node->key == key;
+}
+
+// DeleteKey
+//
+// Entry: key
+// Exit:  true == success
+bool SkipList::DeleteKey(hedger::S_T key)
+{
+  hedger::SkipNode *update[kSkipListMaxLevel];
+  hedger::SkipNode *node = FindPredecessors(key, update);
+  if (!node || node->key != key) {
+    return false;
+  }
+
+  for (int i = 0; i < node->level; i++) {
+    update[i]->next[i] = node->next[i];
+  }
+  FreeNode(node);
+  while (level_ > 1 && nullptr == head_->next[level_ - 1]) {
+    level_--;
+  }
+  nodeTot_--;
+  return true;
+}
+
+// RangeScan
+//
+// Copy the keys in [lo, hi] into out, in order, by walking level 0.
+//
+// Entry: lower bound (inclusive)
+//        upper bound (inclusive)
+//        output array, or nullptr to only count
+//        maximum number of keys to return
+// Exit:  number of keys returned
+std::size_t SkipList::RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max)
+{
+  std::size_t n = 0;
+  for (hedger::SkipNode *node = FindPredecessors(lo, nullptr);
+    node && node->key <= hi && n < max; node = node->next[0]) {
+    if (out) {
+      out[n] = node->key;
+    }
+    n++;
+  }
+  return n;
+}
+
+//
+// Helper functions
+//
+
+// NewNode
+// Allocate a node with its tower inline.
+// Entry: key
+//        tower height
+// Exit:  pointer to node, links cleared
+hedger::SkipNode *SkipList::NewNode(hedger::S_T key, int level)
+{
+  std::size_t size = offsetof(hedger::SkipNode, next) + level * sizeof(hedger::SkipNode *);
+  hedger::SkipNode *node = (hedger::SkipNode *) malloc(size);
+  if (!node) {
+    throw std::bad_alloc();
+  }
+  node->key = key;
+  node->level = level;
+  for (int i = 0; i < level; i++) {
+    node->next[i] = nullptr;
+  }
+  bytes_ += size;
+  return node;
+}
+
+// FreeNode
+// Entry: pointer to node
+void SkipList::FreeNode(hedger::SkipNode *node)
+{
+  bytes_ -= offsetof(hedger::SkipNode, next) + node->level * sizeof(hedger::SkipNode *);
+  free(node);
+}
+} // namespace hedger
@@ -0,0 +1,74 @@
+// skip_list.h
+//
+// Implements a skip list ordered set.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef SKIP_LIST_H_
+#define SKIP_LIST_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "algo.h"
+
+namespace hedger
+{
+const int kSkipListMaxLevel = 32;
+const double kSkipListP = 0.25;     // default promotion probability
+
+// SkipNode
+//
+// The tower of forward links is allocated inline with the node: next[]
+// really holds level entries.
+struct SkipNode
+{
+  hedger::S_T         key;
+  int                 level;        // tower height
+  hedger::SkipNode *  next[1];      // forward links, level entries
+};
+
+class SkipList
+{
+ public:
+  SkipList(double p = kSkipListP);
+  virtual ~SkipList();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  std::size_t RangeScan(hedger::S_T lo, hedger::S_T hi, hedger::S_T *out, std::size_t max);
+  int Size() { return nodeTot_; }
+  std::size_t MemoryUsage() { return bytes_; }
+
+ protected:
+  int RandomLevel();
+  hedger::SkipNode *NewNode(hedger::S_T key, int level);
+  void FreeNode(hedger::SkipNode *node);
+  hedger::SkipNode *FindPredecessors(hedger::S_T key, hedger::SkipNode **update);
+
+  hedger::SkipNode *  head_;        // sentinel with a full-height tower
+  int                 level_;       // highest level in use
+  uint32_t            threshold_;   // p scaled to 2^32
+  uint64_t            seed_;        // xorshift state
+  int                 nodeTot_;
+  std::size_t         bytes_;
+};
+} // namespace hedger
+#endif // #ifndef SKIP_LIST_H_
@@ -0,0 +1,96 @@
+// tree_algo.h
+//
+// Adapts an ordered-set engine to the Algo interface so that treebench
+// can time every engine through the same harness.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef TREE_ALGO_H_
+#define TREE_ALGO_H_
+
+#include <chrono>
+
+#include "algo.h"
+
+namespace hedger
+{
+
+// TreeAlgo
+//
+// Wraps any engine exposing Add(key), Find(key), DeleteKey(key) and
+// MemoryUsage().  Each call to Test() builds a fresh engine from the key
+// array, looks every key up again, then deletes every key, timing each
+// phase.  Memory is sampled once the engine is fully built.
+template <class TREE>
+class TreeAlgo : public hedger::Algo
+{
+ public:
+  TreeAlgo() : addTime_(0.0), findTime_(0.0), deleteTime_(0.0), memory_(0) {};
+  virtual ~TreeAlgo() {};
+
+  // Test
+  //
+  // Entry: pointer to key array
+  //        number of keys
+  // Exit:  number of keys found during the lookup phase
+  virtual int Test(hedger::S_T *t, std::size_t size)
+  {
+    TREE *tree = new TREE();
+    int found = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < size; i++) {
+      tree->Add(t[i]);
+    }
+    auto added = std::chrono::steady_clock::now();
+    memory_ = tree->MemoryUsage();
+    for (std::size_t i = 0; i < size; i++) {
+      if (tree->Find(t[i])) {
+        found++;
+      }
+    }
+    auto searched = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < size; i++) {
+      tree->DeleteKey(t[i]);
+    }
+    auto deleted = std::chrono::steady_clock::now();
+
+    addTime_ = std::chrono::duration<double>(added - start).count();
+    findTime_ = std::chrono::duration<double>(searched - added).count();
+    deleteTime_ = std::chrono::duration<double>(deleted - searched).count();
+    delete tree;
+    return found;
+  }
+
+  // Seconds spent in each phase of the most recent Test()
+  double AddTime() const { return addTime_; }
+  double FindTime() const { return findTime_; }
+  double DeleteTime() const { return deleteTime_; }
+
+  // Bytes held by the engine after the add phase of the most recent Test()
+  std::size_t Memory() const { return memory_; }
+
+ private:
+  double addTime_;
+  double findTime_;
+  double deleteTime_;
+  std::size_t memory_;
+};
+} // namespace hedger
+#endif // #ifndef TREE_ALGO_H_
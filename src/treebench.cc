@@ -17,20 +17,72 @@
 //
 
 // C headers
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 // C++ headers
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <string>
 #include <vector>
 #include <chrono>
+#include <atomic>
+#include <thread>
 
 // Project-specific
 #include "common.h"
 #include "algo.h"
 #include "bstree.h"
 #include "scapegoat_tree.h"
+#include "skip_list.h"
+#include "zip_tree.h"
+#include "art_tree.h"
+#include "be_tree.h"
+#include "bplus_tree.h"
+#include "concurrent_skip_list.h"
+#include "cow_scapegoat_tree.h"
+#include "csb_tree.h"
+#include "eytzinger_index.h"
+#include "flat_combining_tree.h"
+#include "fast_index.h"
+#include "learned_index.h"
+#include "locked_tree.h"
+#include "lsm_tree.h"
+#include "nm_tree.h"
+#include "olc_tree.h"
+#include "packed_memory_array.h"
+#include "perf_counter.h"
+#include "persistent_tree.h"
+#include "radix_sort.h"
+#include "sharded_tree.h"
+#include "veb_layout_index.h"
+#include "veb_tree.h"
+#include "weight_balanced_tree.h"
+#include "tree_algo.h"
+
+// Number of timed runs per engine
+const int kIterationTot = 5;
+
+// SkipListHalf
+//
+// Skip list with p = 1/2, for comparison with the default p = 1/4.
+class SkipListHalf : public hedger::SkipList
+{
+ public:
+  SkipListHalf() : hedger::SkipList(0.5) {}
+};
+
+// LsmTiered
+//
+// LSM engine with the tiering merge policy instead of leveling.
+class LsmTiered : public hedger::LsmTree
+{
+ public:
+  LsmTiered() : hedger::LsmTree(hedger::kLsmTiering) {}
+};
 
 // PrintUsage
 //
@@ -40,6 +92,13 @@ void PrintUsage()
   printf("treebench\n" );
   printf("Usage:\n" );
   printf("\ttreebench <array_size>\n");
+  printf("\ttreebench <array_size> <engine> [engine ...]\n");
+  printf("Engines:\n");
+  printf("\tbstree scapegoat zip wbtree bplus csb betree lsm pma art skiplist\n");
+  printf("\tskiplist-half veb sharded olc nmtree cskiplist cow\n");
+  printf("\tpersistent combining\n");
+  printf("\tfinger eytzinger fast learned layouts setops reclaim threads\n");
+  printf("\tbuild all\n");
 }
 
 // PrintArray
@@ -77,7 +136,7 @@ hedger::S_T * AllocArray(size_t size)
 void FreeArray(hedger::S_T *array)
 {
   if (array) {
-    delete array;
+    delete [] array;
   }
 }
 
@@ -108,6 +167,55 @@ hedger::S_T * CreateUniqueDataSet(hedger::S_T *array, size_t size)
   return array;
 }
 
+// CreateShuffledDataSet
+//
+// Fills an array with a random permutation of [0, size) by Fisher-Yates
+// shuffle.  Same distribution as CreateUniqueDataSet, but linear time,
+// for the large sizes the layout sweep reaches.
+//
+// Entry: pointer to array
+//        size
+// Exit:  pointer to array
+hedger::S_T * CreateShuffledDataSet(hedger::S_T *array, size_t size)
+{
+  for (size_t i = 0; i < size; i++) {
+    array[i] = (hedger::S_T) i;
+  }
+  for (size_t i = size; i > 1; i--) {
+    size_t j = (((size_t) rand() << 31) ^ (size_t) rand()) % i;
+    hedger::S_T t = array[i - 1];
+    array[i - 1] = array[j];
+    array[j] = t;
+  }
+  return array;
+}
+
+// CreateNearlySortedDataSet
+//
+// Fills an array with [0, size) in ascending order, then swaps each key
+// with one at most window - 1 places later, so no key lands far from its
+// sorted position.
+//
+// Entry: pointer to array
+//        size
+//        displacement window
+// Exit:  pointer to array
+hedger::S_T * CreateNearlySortedDataSet(hedger::S_T *array, size_t size, size_t window)
+{
+  for (size_t i = 0; i < size; i++) {
+    array[i] = (hedger::S_T) i;
+  }
+  for (size_t i = 0; i < size; i++) {
+    size_t j = i + rand() % window;
+    if (j < size) {
+      hedger::S_T t = array[i];
+      array[i] = array[j];
+      array[j] = t;
+    }
+  }
+  return array;
+}
+
 // Test
 //
 // Run the test on the Algo-derived search algorithm object
@@ -199,6 +307,1902 @@ void ReportTiming(std::vector<double>& v, int iteration_tot, const char *name)
     std::cout << "TIME SIGMA: " << sigma << std::endl;
 }
 
+// BenchTree
+//
+// Time an engine's add, find and delete phases over several runs on the
+// same key set, and report each phase.
+//
+// Entry: name of engine
+//        pointer to array
+//        size of array
+template <class TREE>
+void BenchTree(const char *name, hedger::S_T *array, size_t array_size)
+{
+  hedger::TreeAlgo<TREE> algo;
+  std::vector<double> addTimes, findTimes, deleteTimes;
+
+  for (int i = 0; i < kIterationTot; i++) {
+    int found = Test(&algo, array, array_size);
+    if (found != (int) array_size) {
+      printf("%s: found %d of %zu keys\n", name, found, array_size);
+    }
+    addTimes.push_back(algo.AddTime());
+    findTimes.push_back(algo.FindTime());
+    deleteTimes.push_back(algo.DeleteTime());
+  }
+
+  std::string label(name);
+  ReportTiming(addTimes, kIterationTot, (label + " ADD").c_str());
+  ReportTiming(findTimes, kIterationTot, (label + " FIND").c_str());
+  ReportTiming(deleteTimes, kIterationTot, (label + " DELETE").c_str());
+  std::cout << COUT_YELLOW << name << " MEMORY:" << COUT_NORMAL << std::endl;
+  std::cout << "BYTES/KEY: " << (double) algo.Memory() / array_size << std::endl;
+}
+
+// Seconds
+// Entry: start time
+//        end time
+// Exit:  elapsed seconds
+double Seconds(std::chrono::steady_clock::time_point start,
+  std::chrono::steady_clock::time_point end)
+{
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// BenchFreeze
+//
+// Build a scapegoat tree, then compare lookups on the live tree with
+// lookups on an Eytzinger snapshot of it, both one key at a time and
+// batched.  Freeze() itself is timed as well.
+//
+// Entry: pointer to array
+//        size of array
+void BenchFreeze(hedger::S_T *array, size_t array_size)
+{
+  hedger::ScapegoatTree tree;
+  for (size_t i = 0; i < array_size; i++) {
+    tree.Add(array[i]);
+  }
+
+  std::vector<double> liveTimes, freezeTimes, findTimes, batchTimes;
+  for (int i = 0; i < kIterationTot; i++) {
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t j = 0; j < array_size; j++) {
+      if (tree.Find(array[j])) {
+        found++;
+      }
+    }
+    auto live = std::chrono::steady_clock::now();
+    hedger::EytzingerIndex *index = tree.Freeze();
+    auto frozen = std::chrono::steady_clock::now();
+    for (size_t j = 0; j < array_size; j++) {
+      if (index->Find(array[j])) {
+        found++;
+      }
+    }
+    auto searched = std::chrono::steady_clock::now();
+    found += index->FindBatch(array, array_size, nullptr);
+    auto batched = std::chrono::steady_clock::now();
+    delete index;
+
+    if (found != 3 * array_size) {
+      printf("eytzinger: found %zu of %zu keys\n", found, 3 * array_size);
+    }
+    liveTimes.push_back(Seconds(start, live));
+    freezeTimes.push_back(Seconds(live, frozen));
+    findTimes.push_back(Seconds(frozen, searched));
+    batchTimes.push_back(Seconds(searched, batched));
+  }
+
+  ReportTiming(liveTimes, kIterationTot, "scapegoat FIND");
+  ReportTiming(freezeTimes, kIterationTot, "eytzinger FREEZE");
+  ReportTiming(findTimes, kIterationTot, "eytzinger FIND");
+  ReportTiming(batchTimes, kIterationTot, "eytzinger FIND BATCH");
+}
+
+// MeasureLookups
+//
+// Time a run of lookups against one layout and print nanoseconds and
+// cache misses per lookup.
+//
+// Entry: layout name
+//        number of keys in the layout
+//        layout exposing Find(key)
+//        pointer to query keys
+//        number of queries
+//        cache miss counter
+template <class INDEX>
+void MeasureLookups(const char *layout, size_t n, INDEX &index,
+  const hedger::S_T *queries, size_t q, hedger::PerfCounter &counter)
+{
+  size_t found = 0;
+  counter.Start();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < q; i++) {
+    if (index.Find(queries[i])) {
+      found++;
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  long long misses = counter.Stop();
+
+  if (found != q) {
+    printf("%s: found %zu of %zu keys\n", layout, found, q);
+  }
+  printf("%12zu  %-10s %10.1f", n, layout, Seconds(start, end) * 1e9 / q);
+  if (misses >= 0) {
+    printf(" %10.2f\n", (double) misses / q);
+  } else {
+    printf(" %10s\n", "n/a");
+  }
+}
+
+// BenchReadOptimized
+//
+// Compare lookups and memory of the CSB+-tree, once its pending updates
+// are flushed, with the B+tree and the scapegoat tree on the same keys.
+//
+// Entry: pointer to array
+//        size of array
+void BenchReadOptimized(hedger::S_T *array, size_t array_size)
+{
+  hedger::PerfCounter counter;
+  hedger::ScapegoatTree tree;
+  hedger::BPlusTree bplus;
+  hedger::CsbTree csb;
+  for (size_t i = 0; i < array_size; i++) {
+    tree.Add(array[i]);
+    bplus.Add(array[i]);
+    csb.Add(array[i]);
+  }
+  csb.Flush();
+
+  std::cout << COUT_YELLOW << "read-optimized:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %10s %10s\n", "KEYS", "LAYOUT", "NS/FIND", "MISS/FIND");
+  MeasureLookups("scapegoat", array_size, tree, array, array_size, counter);
+  MeasureLookups("bplus", array_size, bplus, array, array_size, counter);
+  MeasureLookups("csb", array_size, csb, array, array_size, counter);
+  printf("%12s  %-10s %10s\n", "KEYS", "LAYOUT", "BYTES/KEY");
+  printf("%12zu  %-10s %10.1f\n", array_size, "scapegoat", (double) tree.MemoryUsage() / array_size);
+  printf("%12zu  %-10s %10.1f\n", array_size, "bplus", (double) bplus.MemoryUsage() / array_size);
+  printf("%12zu  %-10s %10.1f\n", array_size, "csb", (double) csb.MemoryUsage() / array_size);
+}
+
+// BenchWriteOptimized
+//
+// Insert the key stream in random order into a scapegoat tree and a
+// B^epsilon-tree, then look every key up.  Reports insert and lookup
+// cost per key and write amplification: node writes (keys, buffered
+// messages, nodes relinked by rebuilds) per insert.
+//
+// Entry: pointer to array
+//        size of array
+void BenchWriteOptimized(hedger::S_T *array, size_t array_size)
+{
+  std::cout << COUT_YELLOW << "write-optimized:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %10s %10s %10s\n", "KEYS", "ENGINE", "NS/ADD", "NS/FIND", "WRITE AMP");
+
+  hedger::ScapegoatTree tree;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    tree.Add(array[i]);
+  }
+  auto added = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    tree.Find(array[i]);
+  }
+  auto searched = std::chrono::steady_clock::now();
+  printf("%12zu  %-10s %10.1f %10.1f %10.2f\n", array_size, "scapegoat",
+    Seconds(start, added) * 1e9 / array_size, Seconds(added, searched) * 1e9 / array_size,
+    (double) (array_size + tree.RebuildTot()) / array_size);
+
+  hedger::BeTree betree;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    betree.Add(array[i]);
+  }
+  added = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    betree.Find(array[i]);
+  }
+  searched = std::chrono::steady_clock::now();
+  printf("%12zu  %-10s %10.1f %10.1f %10.2f\n", array_size, "betree",
+    Seconds(start, added) * 1e9 / array_size, Seconds(added, searched) * 1e9 / array_size,
+    betree.WriteAmplification());
+}
+
+// MeasureLsm
+//
+// Ingest the key stream into one LSM engine, then look up every key and
+// as many absent keys.  Prints ns per insert and per lookup, runs
+// searched per lookup past the Bloom filters, keys written per insert
+// and time spent merging.
+//
+// Entry: engine name
+//        engine
+//        pointer to array
+//        size of array
+void MeasureLsm(const char *name, hedger::LsmTree &lsm, hedger::S_T *array, size_t array_size)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    lsm.Add(array[i]);
+  }
+  auto added = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    lsm.Find(array[i]);
+  }
+  auto searched = std::chrono::steady_clock::now();
+  double hitAmp = lsm.ReadAmplification();
+  lsm.ResetCounters();
+  for (size_t i = 0; i < array_size; i++) {
+    lsm.Find((hedger::S_T) (array_size + i));
+  }
+  double missAmp = lsm.ReadAmplification();
+
+  printf("%12zu  %-10s %10.1f %10.1f %6zu %8.2f %8.2f %9.2f %10.1f\n", array_size, name,
+    Seconds(start, added) * 1e9 / array_size, Seconds(added, searched) * 1e9 / array_size,
+    lsm.RunTot(), hitAmp, missAmp, lsm.WriteAmplification(), lsm.MergeSeconds() * 1e3);
+}
+
+// BenchLsm
+//
+// Ingest into a scapegoat tree and into LSM engines with leveling and
+// tiering.  READ AMP is runs binary searched per lookup of present keys,
+// MISS AMP the same for absent keys, which the Bloom filters mostly
+// turn away; WRITE AMP is keys written into runs per insert.
+//
+// Entry: pointer to array
+//        size of array
+void BenchLsm(hedger::S_T *array, size_t array_size)
+{
+  std::cout << COUT_YELLOW << "lsm:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %10s %10s %6s %8s %8s %9s %10s\n", "KEYS", "ENGINE", "NS/ADD", "NS/FIND",
+    "RUNS", "READ AMP", "MISS AMP", "WRITE AMP", "MERGE MS");
+
+  hedger::ScapegoatTree tree;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    tree.Add(array[i]);
+  }
+  auto added = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    tree.Find(array[i]);
+  }
+  auto searched = std::chrono::steady_clock::now();
+  printf("%12zu  %-10s %10.1f %10.1f\n", array_size, "scapegoat",
+    Seconds(start, added) * 1e9 / array_size, Seconds(added, searched) * 1e9 / array_size);
+
+  hedger::LsmTree leveled(hedger::kLsmLeveling);
+  MeasureLsm("lsm", leveled, array, array_size);
+  hedger::LsmTree tiered(hedger::kLsmTiering);
+  MeasureLsm("lsm-tier", tiered, array, array_size);
+}
+
+// MeasureScans
+//
+// Time range scans of one length at random start keys and print ns per
+// scan and per key returned.
+//
+// Entry: engine name
+//        engine exposing RangeScan
+//        number of keys, dense from 0
+//        range length
+//        output buffer of at least length keys
+template <class TREE>
+void MeasureScans(const char *name, TREE &tree, size_t n, size_t length, hedger::S_T *out)
+{
+  const size_t kScannedMax = 10000000;
+  size_t scanTot = kScannedMax / length;
+  if (scanTot > 100000) {
+    scanTot = 100000;
+  }
+  size_t returned = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < scanTot; i++) {
+    hedger::S_T lo = (hedger::S_T) (rand() % (n - length + 1));
+    returned += tree.RangeScan(lo, lo + (hedger::S_T) length - 1, out, length);
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("%12zu %10zu  %-10s %10.1f %10.2f\n", n, length, name,
+    Seconds(start, end) * 1e9 / scanTot, Seconds(start, end) * 1e9 / returned);
+}
+
+// BenchScan
+//
+// Insert the key stream into a scapegoat tree and a packed memory array,
+// then compare range scans from 10 keys up to the whole set, by factors
+// of ten.
+//
+// Entry: pointer to array
+//        size of array
+void BenchScan(hedger::S_T *array, size_t array_size)
+{
+  std::cout << COUT_YELLOW << "scan:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %10s %10s\n", "KEYS", "ENGINE", "NS/ADD", "MOVES/ADD");
+
+  hedger::ScapegoatTree tree;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    tree.Add(array[i]);
+  }
+  auto end = std::chrono::steady_clock::now();
+  printf("%12zu  %-10s %10.1f\n", array_size, "scapegoat", Seconds(start, end) * 1e9 / array_size);
+
+  hedger::PackedMemoryArray pma;
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < array_size; i++) {
+    pma.Add(array[i]);
+  }
+  end = std::chrono::steady_clock::now();
+  printf("%12zu  %-10s %10.1f %10.1f\n", array_size, "pma", Seconds(start, end) * 1e9 / array_size,
+    pma.MovesPerUpdate());
+
+  hedger::S_T *out = AllocArray(array_size);
+  if (!out) {
+    return;
+  }
+  printf("%12s %10s  %-10s %10s %10s\n", "KEYS", "RANGE", "ENGINE", "NS/SCAN", "NS/KEY");
+  for (size_t length = 10; length <= array_size; length *= 10) {
+    MeasureScans("scapegoat", tree, array_size, length, out);
+    MeasureScans("pma", pma, array_size, length, out);
+  }
+  FreeArray(out);
+}
+
+// MeasureFinger
+//
+// Insert keys into a scapegoat tree in the given order, then look them
+// up in the same order, once starting every operation at the root and
+// once passing the previous node as the finger.
+//
+// Entry: order name
+//        pointer to keys
+//        number of keys
+void MeasureFinger(const char *order, const hedger::S_T *keys, size_t n)
+{
+  for (int finger = 0; finger < 2; finger++) {
+    hedger::ScapegoatTree tree;
+    hedger::Node *hint = nullptr;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++) {
+      hint = finger ? tree.Add(keys[i], hint) : tree.Add(keys[i]);
+    }
+    auto added = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; i++) {
+      hedger::Node *node = finger ? tree.Find(keys[i], hint) : tree.Find(keys[i]);
+      if (node) {
+        hint = node;
+      }
+    }
+    auto searched = std::chrono::steady_clock::now();
+    printf("%12zu  %-14s %-8s %10.1f %10.1f\n", n, order, finger ? "finger" : "root",
+      Seconds(start, added) * 1e9 / n, Seconds(added, searched) * 1e9 / n);
+  }
+}
+
+// BenchFinger
+//
+// Finger against root-started inserts and lookups on keys that arrive
+// nearly sorted (each within 16 places of its sorted position), and on
+// the shuffled data set, where a finger cannot help.
+//
+// Entry: pointer to array
+//        size of array
+void BenchFinger(hedger::S_T *array, size_t array_size)
+{
+  const size_t kWindow = 16;
+  hedger::S_T *nearly = AllocArray(array_size);
+  if (!nearly) {
+    return;
+  }
+  CreateNearlySortedDataSet(nearly, array_size, kWindow);
+
+  std::cout << COUT_YELLOW << "finger:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-14s %-8s %10s %10s\n", "KEYS", "ORDER", "START", "NS/ADD", "NS/FIND");
+  MeasureFinger("nearly-sorted", nearly, array_size);
+  MeasureFinger("shuffled", array, array_size);
+  FreeArray(nearly);
+}
+
+// BenchVeb
+//
+// Bounded universe: a van Emde Boas tree over the smallest power-of-two
+// universe holding the data set, against a scapegoat tree.  Half of the
+// keys, a random half of the universe, are inserted; every key is then
+// looked up and its successor and predecessor found, and the inserted
+// half deleted.  The scapegoat successor is a one-key RangeScan; it has
+// no predecessor query.
+//
+// Entry: pointer to array
+//        size of array
+void BenchVeb(hedger::S_T *array, size_t array_size)
+{
+  size_t half = array_size / 2;
+  if (0 == half) {
+    return;
+  }
+  int bits = 1;
+  while (((size_t) 1 << bits) < array_size) {
+    bits++;
+  }
+
+  std::cout << COUT_YELLOW << "veb:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %5s %10s %10s %10s %10s %10s %10s\n", "KEYS", "ENGINE", "BITS",
+    "NS/ADD", "NS/FIND", "NS/SUCC", "NS/PRED", "NS/DELETE", "BYTES/KEY");
+
+  {
+    hedger::ScapegoatTree tree;
+    hedger::S_T next;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < half; i++) {
+      tree.Add(array[i]);
+    }
+    auto added = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < array_size; i++) {
+      tree.Find(array[i]);
+    }
+    auto searched = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < array_size; i++) {
+      tree.RangeScan(array[i] + 1, INT_MAX, &next, 1);
+    }
+    auto succeeded = std::chrono::steady_clock::now();
+    size_t bytes = tree.MemoryUsage();
+    for (size_t i = 0; i < half; i++) {
+      tree.DeleteKey(array[i]);
+    }
+    auto deleted = std::chrono::steady_clock::now();
+    printf("%12zu  %-10s %5s %10.1f %10.1f %10.1f %10s %10.1f %10.1f\n", half, "scapegoat", "-",
+      Seconds(start, added) * 1e9 / half, Seconds(added, searched) * 1e9 / array_size,
+      Seconds(searched, succeeded) * 1e9 / array_size, "-",
+      Seconds(succeeded, deleted) * 1e9 / half, (double) bytes / half);
+  }
+  {
+    hedger::VebTree veb(bits);
+    hedger::S_T next;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < half; i++) {
+      veb.Add(array[i]);
+    }
+    auto added = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < array_size; i++) {
+      veb.Find(array[i]);
+    }
+    auto searched = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < array_size; i++) {
+      veb.Successor(array[i], &next);
+    }
+    auto succeeded = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < array_size; i++) {
+      veb.Predecessor(array[i], &next);
+    }
+    auto preceded = std::chrono::steady_clock::now();
+    size_t bytes = veb.MemoryUsage();
+    for (size_t i = 0; i < half; i++) {
+      veb.DeleteKey(array[i]);
+    }
+    auto deleted = std::chrono::steady_clock::now();
+    printf("%12zu  %-10s %5d %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", half, "veb", bits,
+      Seconds(start, added) * 1e9 / half, Seconds(added, searched) * 1e9 / array_size,
+      Seconds(searched, succeeded) * 1e9 / array_size, Seconds(succeeded, preceded) * 1e9 / array_size,
+      Seconds(preceded, deleted) * 1e9 / half, (double) bytes / half);
+  }
+}
+
+// MeasureConcurrentAdds
+//
+// Insert keys into a shared engine from threadTot threads, thread t
+// taking every threadTot'th key from t.  The threads wait on a start
+// flag so that thread creation is not timed.
+//
+// Entry: engine
+//        pointer to keys
+//        number of keys
+//        number of threads
+// Exit:  seconds from start flag to last thread done
+template <class TREE>
+double MeasureConcurrentAdds(TREE &tree, const hedger::S_T *keys, size_t n, int threadTot)
+{
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadTot; t++) {
+    threads.emplace_back([&, t]() {
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (size_t i = t; i < n; i += threadTot) {
+        tree.Add(keys[i]);
+      }
+    });
+  }
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return Seconds(start, std::chrono::steady_clock::now());
+}
+
+// BenchSharded
+//
+// Insert throughput against thread count for one scapegoat tree behind a
+// single lock, and for range and hash sharded trees of kShardTot shards.
+// Each row is plotted as a bar of one '#' per 0.1 Mops/s.  Ends with a
+// cross-shard range scan on each sharded tree.
+//
+// Entry: pointer to array
+//        size of array
+void BenchSharded(hedger::S_T *array, size_t array_size)
+{
+  const int kThreadMax = 32;
+  const size_t kScanLength = 1000;
+  if (0 == array_size) {
+    return;
+  }
+
+  std::cout << COUT_YELLOW << "sharded:" << COUT_NORMAL << std::endl;
+  printf("%12s  %7s  %-14s %8s\n", "KEYS", "THREADS", "ENGINE", "MOPS/S");
+  for (int threadTot = 1; threadTot <= kThreadMax; threadTot *= 2) {
+    for (int engine = 0; engine < 3; engine++) {
+      double seconds;
+      const char *name;
+      if (0 == engine) {
+        hedger::LockedTree<hedger::ScapegoatTree> tree;
+        seconds = MeasureConcurrentAdds(tree, array, array_size, threadTot);
+        name = "locked";
+      } else if (1 == engine) {
+        hedger::ShardedTree tree(hedger::kShardTot, hedger::kShardRange, 0,
+          (hedger::S_T) array_size - 1);
+        seconds = MeasureConcurrentAdds(tree, array, array_size, threadTot);
+        name = "sharded-range";
+      } else {
+        hedger::ShardedTree tree(hedger::kShardTot, hedger::kShardHash);
+        seconds = MeasureConcurrentAdds(tree, array, array_size, threadTot);
+        name = "sharded-hash";
+      }
+      double mops = array_size / seconds / 1e6;
+      printf("%12zu  %7d  %-14s %8.2f  %s\n", array_size, threadTot, name, mops,
+        std::string(std::min(60, (int) (mops * 10.0)), '#').c_str());
+    }
+  }
+
+  std::vector<hedger::S_T> out(kScanLength);
+  printf("%12s  %-14s %8s %12s\n", "KEYS", "ENGINE", "LENGTH", "NS/KEY");
+  for (int engine = 0; engine < 2; engine++) {
+    hedger::ShardedTree tree(hedger::kShardTot, engine ? hedger::kShardHash : hedger::kShardRange,
+      0, (hedger::S_T) array_size - 1);
+    MeasureConcurrentAdds(tree, array, array_size, 1);
+    size_t scanTot = std::max((size_t) 1, array_size / kScanLength);
+    size_t keyTot = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < scanTot; i++) {
+      hedger::S_T lo = array[i];
+      keyTot += tree.RangeScan(lo, lo + kScanLength - 1, out.data(), kScanLength);
+    }
+    auto scanned = std::chrono::steady_clock::now();
+    printf("%12zu  %-14s %8zu %12.1f\n", array_size, engine ? "sharded-hash" : "sharded-range",
+      kScanLength, Seconds(start, scanned) * 1e9 / std::max((size_t) 1, keyTot));
+  }
+}
+
+// MeasureMix
+//
+// Run a mix of lookups and updates on a shared engine from threadTot
+// threads.  Each thread draws keys in [0, keyRange) and operations from
+// its own xorshift stream; updates alternate between Add and DeleteKey.
+//
+// Entry: engine
+//        key range
+//        total operations, split across the threads
+//        number of threads
+//        percentage of operations that are lookups
+// Exit:  seconds from start flag to last thread done
+template <class TREE>
+double MeasureMix(TREE &tree, size_t keyRange, size_t opTot, int threadTot, int readPercent)
+{
+  std::atomic<bool> go(false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < threadTot; t++) {
+    threads.emplace_back([&, t]() {
+      uint32_t x = 2463534242u + 7919u * t;
+      size_t ops = opTot / threadTot;
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (size_t i = 0; i < ops; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        hedger::S_T key = (hedger::S_T) (x % keyRange);
+        if ((int) ((x >> 8) % 100) < readPercent) {
+          tree.Find(key);
+        } else if (i & 1) {
+          tree.DeleteKey(key);
+        } else {
+          tree.Add(key);
+        }
+      }
+    });
+  }
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return Seconds(start, std::chrono::steady_clock::now());
+}
+
+// BenchOlc
+//
+// Read-mostly throughput (95% lookups) against thread count, on trees
+// preloaded with the data set: one scapegoat tree behind a mutex, behind
+// a reader-writer lock, the hash sharded tree, and the optimistic lock
+// coupling tree, whose restarts per million operations are also shown.
+//
+// Entry: pointer to array
+//        size of array
+void BenchOlc(hedger::S_T *array, size_t array_size)
+{
+  const int kThreadMax = 32;
+  const int kReadPercent = 95;
+  if (0 == array_size) {
+    return;
+  }
+
+  std::cout << COUT_YELLOW << "olc:" << COUT_NORMAL << std::endl;
+  printf("%12s  %7s  %-14s %8s %12s\n", "KEYS", "THREADS", "ENGINE", "MOPS/S", "RESTARTS/M");
+  for (int threadTot = 1; threadTot <= kThreadMax; threadTot *= 2) {
+    for (int engine = 0; engine < 4; engine++) {
+      double seconds;
+      const char *name;
+      char restarts[32] = "-";
+      if (0 == engine) {
+        hedger::LockedTree<hedger::ScapegoatTree> tree;
+        MeasureConcurrentAdds(tree, array, array_size, 1);
+        seconds = MeasureMix(tree, array_size, array_size, threadTot, kReadPercent);
+        name = "locked";
+      } else if (1 == engine) {
+        hedger::SharedLockedTree<hedger::ScapegoatTree> tree;
+        MeasureConcurrentAdds(tree, array, array_size, 1);
+        seconds = MeasureMix(tree, array_size, array_size, threadTot, kReadPercent);
+        name = "rwlocked";
+      } else if (2 == engine) {
+        hedger::ShardedTree tree;
+        MeasureConcurrentAdds(tree, array, array_size, 1);
+        seconds = MeasureMix(tree, array_size, array_size, threadTot, kReadPercent);
+        name = "sharded-hash";
+      } else {
+        hedger::OlcTree tree;
+        MeasureConcurrentAdds(tree, array, array_size, 1);
+        size_t before = tree.RestartTot();
+        seconds = MeasureMix(tree, array_size, array_size, threadTot, kReadPercent);
+        snprintf(restarts, sizeof(restarts), "%.1f", (tree.RestartTot() - before) * 1e6 / array_size);
+        name = "olc";
+      }
+      printf("%12zu  %7d  %-14s %8.2f %12s\n", array_size, threadTot, name,
+        array_size / seconds / 1e6, restarts);
+    }
+  }
+}
+
+// BenchLockFree
+//
+// Throughput against thread count, from 1 to 64, of the lock-free tree
+// beside one scapegoat tree behind a mutex and the optimistic lock
+// coupling tree, under a read-heavy (90% lookups) and a write-heavy
+// (10% lookups) mix, on trees preloaded with the data set.
+//
+// Entry: pointer to array
+//        size of array
+void BenchLockFree(hedger::S_T *array, size_t array_size)
+{
+  const int kThreadMax = 64;
+  const int kMixes[] = { 90, 10 };
+  if (0 == array_size) {
+    return;
+  }
+
+  std::cout << COUT_YELLOW << "nmtree:" << COUT_NORMAL << std::endl;
+  printf("%12s  %6s  %7s  %-10s %8s\n", "KEYS", "READS", "THREADS", "ENGINE", "MOPS/S");
+  for (int readPercent : kMixes) {
+    for (int threadTot = 1; threadTot <= kThreadMax; threadTot *= 2) {
+      for (int engine = 0; engine < 3; engine++) {
+        double seconds;
+        const char *name;
+        if (0 == engine) {
+          hedger::LockedTree<hedger::ScapegoatTree> tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          name = "locked";
+        } else if (1 == engine) {
+          hedger::OlcTree tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          name = "olc";
+        } else {
+          hedger::NmTree tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          name = "nmtree";
+        }
+        printf("%12zu  %5d%%  %7d  %-10s %8.2f\n", array_size, readPercent, threadTot, name,
+          array_size / seconds / 1e6);
+      }
+    }
+  }
+}
+
+// BenchConcurrentSkipList
+//
+// Throughput against thread count, from 1 to 64, of the lock-free skip
+// list beside a skip list and a scapegoat tree each behind a mutex and
+// the lock-free tree, under a read-heavy (90% lookups) and a write-heavy
+// (10% lookups) mix, on engines preloaded with the data set.  Ends with
+// range scans on the lock-free skip list while writers run beside them.
+//
+// Entry: pointer to array
+//        size of array
+void BenchConcurrentSkipList(hedger::S_T *array, size_t array_size)
+{
+  const int kThreadMax = 64;
+  const int kMixes[] = { 90, 10 };
+  const size_t kScanLength = 1000;
+  const int kWriterTot = 3;
+  if (0 == array_size) {
+    return;
+  }
+
+  std::cout << COUT_YELLOW << "cskiplist:" << COUT_NORMAL << std::endl;
+  printf("%12s  %6s  %7s  %-14s %8s\n", "KEYS", "READS", "THREADS", "ENGINE", "MOPS/S");
+  for (int readPercent : kMixes) {
+    for (int threadTot = 1; threadTot <= kThreadMax; threadTot *= 2) {
+      for (int engine = 0; engine < 4; engine++) {
+        double seconds;
+        const char *name;
+        if (0 == engine) {
+          hedger::LockedTree<hedger::SkipList> tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          name = "locked-skip";
+        } else if (1 == engine) {
+          hedger::LockedTree<hedger::ScapegoatTree> tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          name = "locked";
+        } else if (2 == engine) {
+          hedger::NmTree tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          name = "nmtree";
+        } else {
+          hedger::ConcurrentSkipList tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          name = "cskiplist";
+        }
+        printf("%12zu  %5d%%  %7d  %-14s %8.2f\n", array_size, readPercent, threadTot, name,
+          array_size / seconds / 1e6);
+      }
+    }
+  }
+
+  hedger::ConcurrentSkipList tree;
+  MeasureConcurrentAdds(tree, array, array_size, 1);
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> writers;
+  for (int t = 0; t < kWriterTot; t++) {
+    writers.emplace_back([&, t]() {
+      uint32_t x = 2463534242u + 7919u * t;
+      for (size_t i = 0; !stop.load(std::memory_order_relaxed); i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        hedger::S_T key = (hedger::S_T) (x % array_size);
+        if (i & 1) {
+          tree.DeleteKey(key);
+        } else {
+          tree.Add(key);
+        }
+      }
+    });
+  }
+  std::vector<hedger::S_T> out(kScanLength);
+  size_t scanTot = std::max((size_t) 1, array_size / kScanLength);
+  size_t keyTot = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < scanTot; i++) {
+    hedger::S_T lo = array[i];
+    keyTot += tree.RangeScan(lo, lo + kScanLength - 1, out.data(), kScanLength);
+  }
+  auto scanned = std::chrono::steady_clock::now();
+  stop.store(true, std::memory_order_relaxed);
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  printf("%12s  %-14s %8s %8s %12s\n", "KEYS", "ENGINE", "WRITERS", "LENGTH", "NS/KEY");
+  printf("%12zu  %-14s %8d %8zu %12.1f\n", array_size, "cskiplist", kWriterTot, kScanLength,
+    Seconds(start, scanned) * 1e9 / std::max((size_t) 1, keyTot));
+}
+
+// MeasureReclaim
+//
+// Run a half-lookup mix on a preloaded engine while sampling its
+// reclaimer every millisecond, then print one row: throughput, mean
+// reclamation lag, the peak of memory retired but not yet released, and
+// that peak as a share of what the engine holds at the end.
+//
+// Entry: engine
+//        engine name
+//        pointer to array
+//        size of array
+//        number of threads
+template <class TREE>
+void MeasureReclaim(TREE &tree, const char *name, hedger::S_T *array, size_t array_size,
+  int threadTot)
+{
+  const int kReadPercent = 50;
+  MeasureConcurrentAdds(tree, array, array_size, 1);
+  std::atomic<bool> stop(false);
+  size_t peak = 0;
+  std::thread sampler([&]() {
+    hedger::EpochStats stats;
+    while (!stop.load(std::memory_order_relaxed)) {
+      tree.ReclaimStats(&stats);
+      peak = std::max(peak, stats.pendingBytes);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  double seconds = MeasureMix(tree, array_size, array_size, threadTot, kReadPercent);
+  stop.store(true, std::memory_order_relaxed);
+  sampler.join();
+  hedger::EpochStats stats;
+  tree.ReclaimStats(&stats);
+  size_t bytes = tree.MemoryUsage();
+  printf("%12zu  %-10s %-6s %7d %8.2f %9.2f %9.1f %10.1f %10.1f %6.1f\n", array_size, name,
+    hedger::kEpochQuiescent == tree.Mode() ? "qsbr" : "ebr", threadTot, array_size / seconds / 1e6,
+    stats.lagEpochs, stats.lagMicros, peak / 1024.0, bytes / 1024.0,
+    bytes ? 100.0 * peak / bytes : 0.0);
+}
+
+// BenchReclaim
+//
+// Reclamation cost of the concurrent engines under a half-lookup mix,
+// with epoch pinning around each operation (ebr) and with quiescent
+// states announced after each operation (qsbr).  LAG is the mean time
+// from retire to release, in epochs and microseconds; PEAK-KB is the
+// most memory ever waiting in limbo and PEAK% its share of the engine's
+// final footprint.
+//
+// Entry: pointer to array
+//        size of array
+void BenchReclaim(hedger::S_T *array, size_t array_size)
+{
+  const int kThreads[] = { 1, 4, 16 };
+  if (0 == array_size) {
+    return;
+  }
+
+  std::cout << COUT_YELLOW << "reclaim:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %-6s %7s %8s %9s %9s %10s %10s %6s\n", "KEYS", "ENGINE", "MODE", "THREADS",
+    "MOPS/S", "LAG-EPOCH", "LAG-US", "PEAK-KB", "MEMORY-KB", "PEAK%");
+  for (int threadTot : kThreads) {
+    for (int mode = 0; mode < 2; mode++) {
+      hedger::EpochMode epochMode = mode ? hedger::kEpochQuiescent : hedger::kEpochPinned;
+      {
+        hedger::OlcTree tree(epochMode);
+        MeasureReclaim(tree, "olc", array, array_size, threadTot);
+      }
+      {
+        hedger::NmTree tree(epochMode);
+        MeasureReclaim(tree, "nmtree", array, array_size, threadTot);
+      }
+      {
+        hedger::ConcurrentSkipList tree(hedger::kSkipListP, epochMode);
+        MeasureReclaim(tree, "cskiplist", array, array_size, threadTot);
+      }
+    }
+  }
+}
+
+// MeasureWriterLatency
+//
+// Insert keys from one writer thread, timing every Add, while readerTot
+// threads look up random keys until the writer is done.
+//
+// Entry: engine
+//        pointer to keys
+//        number of keys
+//        number of reader threads
+//        pointer to per-Add latencies in nanoseconds to fill in, sorted
+// Exit:  lookups per second across the readers
+template <class TREE>
+double MeasureWriterLatency(TREE &tree, const hedger::S_T *keys, size_t n, int readerTot,
+  std::vector<double> *latency)
+{
+  std::atomic<bool> done(false);
+  std::atomic<size_t> readTot(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < readerTot; t++) {
+    readers.emplace_back([&, t]() {
+      uint32_t x = 2463534242u + 7919u * t;
+      size_t reads = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        tree.Find((hedger::S_T) (x % n));
+        reads++;
+      }
+      readTot.fetch_add(reads);
+    });
+  }
+  latency->resize(n);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n; i++) {
+    auto before = std::chrono::steady_clock::now();
+    tree.Add(keys[i]);
+    (*latency)[i] = Seconds(before, std::chrono::steady_clock::now()) * 1e9;
+  }
+  double seconds = Seconds(start, std::chrono::steady_clock::now());
+  done.store(true, std::memory_order_relaxed);
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  std::sort(latency->begin(), latency->end());
+  return readTot.load() / seconds;
+}
+
+// BenchCow
+//
+// Add latency of one writer beside two readers, on shuffled and on
+// sorted keys, for a scapegoat tree behind a mutex and behind a
+// reader-writer lock, whose writer runs every rebuild inline, and for
+// the copy-on-write tree, whose rebuilds run in the background.
+//
+// Entry: pointer to array
+//        size of array
+void BenchCow(hedger::S_T *array, size_t array_size)
+{
+  const int kReaderTot = 2;
+  if (0 == array_size) {
+    return;
+  }
+  hedger::S_T *sorted = AllocArray(array_size);
+  if (!sorted) {
+    return;
+  }
+  for (size_t i = 0; i < array_size; i++) {
+    sorted[i] = (hedger::S_T) i;
+  }
+
+  std::cout << COUT_YELLOW << "cow:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-8s %-10s %9s %9s %9s %10s %10s\n", "KEYS", "ORDER", "ENGINE", "P50-NS",
+    "P99.9-NS", "MAX-US", "READ-MOPS", "REBUILT");
+  std::vector<double> latency;
+  for (int order = 0; order < 2; order++) {
+    hedger::S_T *keys = order ? sorted : array;
+    for (int engine = 0; engine < 3; engine++) {
+      double reads;
+      const char *name;
+      char rebuilt[32] = "-";
+      if (0 == engine) {
+        hedger::LockedTree<hedger::ScapegoatTree> tree;
+        reads = MeasureWriterLatency(tree, keys, array_size, kReaderTot, &latency);
+        name = "locked";
+      } else if (1 == engine) {
+        hedger::SharedLockedTree<hedger::ScapegoatTree> tree;
+        reads = MeasureWriterLatency(tree, keys, array_size, kReaderTot, &latency);
+        name = "rwlocked";
+      } else {
+        hedger::CowScapegoatTree tree;
+        reads = MeasureWriterLatency(tree, keys, array_size, kReaderTot, &latency);
+        tree.WaitIdle();
+        snprintf(rebuilt, sizeof(rebuilt), "%zu", tree.RebuildTot());
+        name = "cow";
+      }
+      printf("%12zu  %-8s %-10s %9.0f %9.0f %9.1f %10.2f %10s\n", array_size,
+        order ? "sorted" : "shuffled", name, latency[array_size / 2],
+        latency[std::min(array_size - 1, array_size * 999 / 1000)], latency.back() / 1e3,
+        reads / 1e6, rebuilt);
+    }
+  }
+  FreeArray(sorted);
+}
+
+// ThreadWorkload
+//
+// One worker's share of a multi-threaded run: its own xorshift key
+// stream over [lo, lo + range) and its own operation mix.  The driver
+// fills in the time and the lookups that hit.
+struct ThreadWorkload
+{
+  const char *  mix;            // mix name, for reports
+  uint32_t      seed;           // xorshift state
+  hedger::S_T   lo;             // first key of the stream
+  size_t        range;          // keys in the stream
+  int           readPercent;    // lookups
+  int           addPercent;     // adds; the rest are deletes
+  size_t        opTot;          // operations to run
+  double        seconds;        // start to this thread's last operation
+  size_t        hitTot;         // lookups that found their key
+};
+
+// ThreadMix
+//
+// Operation mix handed to a worker.
+struct ThreadMix
+{
+  const char *  name;
+  int           readPercent;
+  int           addPercent;
+};
+
+// Read-heavy, balanced and write-heavy mixes; the split workload gives
+// worker t mix t % 3.
+const ThreadMix kThreadMixes[] = {
+  { "read", 90, 5 },
+  { "mixed", 50, 25 },
+  { "write", 10, 45 }
+};
+
+// MakeWorkloads
+//
+// Split opTot operations over threadTot workers.  In a shared workload
+// every worker runs the given mix over all of [0, keyRange); in a split
+// workload worker t runs mix t % 3 over its own slice of the key range.
+//
+// Entry: pointer to mix for shared workloads, nullptr == split
+//        key range
+//        total operations
+//        number of threads
+//        pointer to workloads to fill in
+void MakeWorkloads(const ThreadMix *mix, size_t keyRange, size_t opTot, int threadTot,
+  std::vector<ThreadWorkload> *work)
+{
+  work->clear();
+  for (int t = 0; t < threadTot; t++) {
+    const ThreadMix &m = mix ? *mix : kThreadMixes[t % 3];
+    ThreadWorkload w;
+    w.mix = m.name;
+    w.seed = 2463534242u + 7919u * t;
+    w.lo = mix ? 0 : (hedger::S_T) (keyRange * t / threadTot);
+    w.range = mix ? keyRange : std::max((size_t) 1, keyRange / threadTot);
+    w.readPercent = m.readPercent;
+    w.addPercent = m.addPercent;
+    w.opTot = opTot / threadTot;
+    w.seconds = 0.0;
+    w.hitTot = 0;
+    work->push_back(w);
+  }
+}
+
+// MeasureWorkloads
+//
+// Run one worker thread per workload on a shared engine.  Workers check
+// in at a barrier once created, and the clock starts only when all of
+// them have arrived, so they begin together and thread creation is not
+// timed.  Each worker records when it finished.
+//
+// Entry: engine
+//        pointer to workloads
+// Exit:  seconds from start to last worker done
+template <class TREE>
+double MeasureWorkloads(TREE &tree, std::vector<ThreadWorkload> *work)
+{
+  std::atomic<int> arrived(0);
+  std::atomic<bool> go(false);
+  std::chrono::steady_clock::time_point start;
+  std::vector<std::thread> threads;
+  for (auto &w : *work) {
+    threads.emplace_back([&]() {
+      uint32_t x = w.seed;
+      size_t hits = 0;
+      arrived.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (size_t i = 0; i < w.opTot; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        hedger::S_T key = w.lo + (hedger::S_T) (x % w.range);
+        int op = (int) ((x >> 8) % 100);
+        if (op < w.readPercent) {
+          if (tree.Find(key)) {
+            hits++;
+          }
+        } else if (op < w.readPercent + w.addPercent) {
+          tree.Add(key);
+        } else {
+          tree.DeleteKey(key);
+        }
+      }
+      w.seconds = Seconds(start, std::chrono::steady_clock::now());
+      w.hitTot = hits;
+    });
+  }
+  while (arrived.load() < (int) work->size()) {
+    std::this_thread::yield();
+  }
+  start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  double seconds = 0.0;
+  for (size_t t = 0; t < threads.size(); t++) {
+    threads[t].join();
+    seconds = std::max(seconds, (*work)[t].seconds);
+  }
+  return seconds;
+}
+
+// MeasureThreads
+//
+// Preload a fresh engine with the data set, run the workloads on it and
+// report aggregate throughput beside the slowest and fastest worker.
+// With detail set, also report each worker on its own line.
+//
+// Entry: engine name
+//        how the engine is made concurrent
+//        workload name
+//        pointer to array
+//        size of array
+//        pointer to workloads
+//        true == report each worker
+template <class TREE>
+void MeasureThreads(const char *name, const char *wrap, const char *workload,
+  hedger::S_T *array, size_t array_size, std::vector<ThreadWorkload> *work, bool detail)
+{
+  TREE tree;
+  MeasureConcurrentAdds(tree, array, array_size, 1);
+  double seconds = MeasureWorkloads(tree, work);
+  size_t opTot = 0;
+  double lo = 0.0;
+  double hi = 0.0;
+  for (size_t t = 0; t < work->size(); t++) {
+    const ThreadWorkload &w = (*work)[t];
+    double mops = w.opTot / w.seconds / 1e6;
+    lo = t ? std::min(lo, mops) : mops;
+    hi = std::max(hi, mops);
+    opTot += w.opTot;
+  }
+  if (!detail) {
+    printf("%12zu  %-6s %7zu  %-12s %-6s %8.2f %8.2f %8.2f\n", array_size, workload, work->size(),
+      name, wrap, opTot / seconds / 1e6, lo, hi);
+    return;
+  }
+  for (size_t t = 0; t < work->size(); t++) {
+    const ThreadWorkload &w = (*work)[t];
+    size_t readTot = w.opTot * w.readPercent / 100;
+    printf("%12zu  %-12s %6zu  %-6s %12d %10zu %8.2f %6.1f\n", array_size, name, t, w.mix, w.lo,
+      w.range, w.opTot / w.seconds / 1e6, readTot ? 100.0 * w.hitTot / readTot : 0.0);
+  }
+}
+
+// MeasureEngines
+//
+// Run the same workloads on every concurrent engine: scapegoat behind a
+// mutex and behind a reader-writer lock, the hash sharded tree, and the
+// natively concurrent olc, nmtree, cskiplist and cow engines.
+//
+// Entry: workload name
+//        pointer to mix for shared workloads, nullptr == split
+//        pointer to array
+//        size of array
+//        number of threads
+//        true == report each worker
+void MeasureEngines(const char *workload, const ThreadMix *mix, hedger::S_T *array,
+  size_t array_size, int threadTot, bool detail)
+{
+  std::vector<ThreadWorkload> work;
+  MakeWorkloads(mix, array_size, array_size, threadTot, &work);
+  MeasureThreads<hedger::LockedTree<hedger::ScapegoatTree>>("locked", "lock", workload,
+    array, array_size, &work, detail);
+  MakeWorkloads(mix, array_size, array_size, threadTot, &work);
+  MeasureThreads<hedger::SharedLockedTree<hedger::ScapegoatTree>>("rwlocked", "rwlock", workload,
+    array, array_size, &work, detail);
+  MakeWorkloads(mix, array_size, array_size, threadTot, &work);
+  MeasureThreads<hedger::ShardedTree>("sharded-hash", "shard", workload,
+    array, array_size, &work, detail);
+  MakeWorkloads(mix, array_size, array_size, threadTot, &work);
+  MeasureThreads<hedger::OlcTree>("olc", "native", workload, array, array_size, &work, detail);
+  MakeWorkloads(mix, array_size, array_size, threadTot, &work);
+  MeasureThreads<hedger::NmTree>("nmtree", "native", workload, array, array_size, &work, detail);
+  MakeWorkloads(mix, array_size, array_size, threadTot, &work);
+  MeasureThreads<hedger::ConcurrentSkipList>("cskiplist", "native", workload,
+    array, array_size, &work, detail);
+  MakeWorkloads(mix, array_size, array_size, threadTot, &work);
+  MeasureThreads<hedger::CowScapegoatTree>("cow", "native", workload,
+    array, array_size, &work, detail);
+}
+
+// BenchThreads
+//
+// Multi-threaded driver.  From 1 to 16 threads, every concurrent engine
+// runs the read, mixed and write workloads, where all workers share one
+// mix over the whole key range, and the split workload, where each
+// worker has its own mix and its own slice of the keys.  Each row gives
+// aggregate throughput and the slowest and fastest worker's.  Ends with
+// the split workload at 4 threads broken down per worker, with the share
+// of its lookups that hit.
+//
+// Entry: pointer to array
+//        size of array
+void BenchThreads(hedger::S_T *array, size_t array_size)
+{
+  const int kThreadMax = 16;
+  const int kDetailThreads = 4;
+  if (0 == array_size) {
+    return;
+  }
+
+  std::cout << COUT_YELLOW << "threads:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-6s %7s  %-12s %-6s %8s %8s %8s\n", "KEYS", "MIX", "THREADS", "ENGINE", "WRAP",
+    "MOPS/S", "MIN-MOPS", "MAX-MOPS");
+  for (int threadTot = 1; threadTot <= kThreadMax; threadTot *= 2) {
+    for (const ThreadMix &mix : kThreadMixes) {
+      MeasureEngines(mix.name, &mix, array, array_size, threadTot, false);
+    }
+    MeasureEngines("split", nullptr, array, array_size, threadTot, false);
+  }
+
+  printf("%12s  %-12s %6s  %-6s %12s %10s %8s %6s\n", "KEYS", "ENGINE", "THREAD", "MIX",
+    "FIRST-KEY", "RANGE", "MOPS/S", "HIT%");
+  MeasureEngines("split", nullptr, array, array_size, kDetailThreads, true);
+}
+
+// BenchBuild
+//
+// Time to turn the unsorted data set into a scapegoat tree: Build from 1
+// to 16 threads against one Add per key.  SORT-MS is the radix sort
+// alone on that many threads, beside std::sort for reference; the last
+// two columns are Build's speedup over one Add per key and over itself
+// on one thread.  The Add loop runs last, since freeing its nodes one by
+// one leaves the allocator to tidy up on the next large allocation.
+//
+// Entry: pointer to array
+//        size of array
+void BenchBuild(hedger::S_T *array, size_t array_size)
+{
+  const int kThreadMax = 16;
+  if (0 == array_size) {
+    return;
+  }
+  hedger::S_T *keys = AllocArray(array_size);
+  if (!keys) {
+    return;
+  }
+
+  memcpy(keys, array, array_size * sizeof(hedger::S_T));
+  auto start = std::chrono::steady_clock::now();
+  std::sort(keys, keys + array_size);
+  double stdSeconds = Seconds(start, std::chrono::steady_clock::now());
+
+  std::vector<double> sortSeconds;
+  std::vector<double> buildSeconds;
+  for (int threadTot = 1; threadTot <= kThreadMax; threadTot *= 2) {
+    memcpy(keys, array, array_size * sizeof(hedger::S_T));
+    start = std::chrono::steady_clock::now();
+    hedger::RadixSort(keys, array_size, threadTot);
+    sortSeconds.push_back(Seconds(start, std::chrono::steady_clock::now()));
+
+    hedger::ScapegoatTree tree;
+    start = std::chrono::steady_clock::now();
+    tree.Build(array, array_size, threadTot);
+    buildSeconds.push_back(Seconds(start, std::chrono::steady_clock::now()));
+  }
+
+  double addSeconds;
+  {
+    hedger::ScapegoatTree tree;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < array_size; i++) {
+      tree.Add(array[i]);
+    }
+    addSeconds = Seconds(start, std::chrono::steady_clock::now());
+  }
+
+  std::cout << COUT_YELLOW << "build:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %7s %10s %10s %8s %8s\n", "KEYS", "METHOD", "THREADS", "SORT-MS", "BUILD-MS",
+    "VS-ADD", "VS-1T");
+  printf("%12zu  %-10s %7d %10s %10.1f %8s %8s\n", array_size, "add", 1, "-", addSeconds * 1e3,
+    "-", "-");
+  printf("%12zu  %-10s %7d %10.1f %10s %8s %8s\n", array_size, "std::sort", 1, stdSeconds * 1e3,
+    "-", "-", "-");
+  for (size_t i = 0; i < buildSeconds.size(); i++) {
+    printf("%12zu  %-10s %7d %10.1f %10.1f %8.1f %8.2f\n", array_size, "build", 1 << i,
+      sortSeconds[i] * 1e3, buildSeconds[i] * 1e3, addSeconds / buildSeconds[i],
+      buildSeconds[0] / buildSeconds[i]);
+  }
+  FreeArray(keys);
+}
+
+// MeasureScanConflict
+//
+// Run updates from one writer thread, timing each, while scannerTot
+// threads scan every key, pausing a millisecond between scans, until the
+// writer is done.  Without the pause, overlapping scans could hold a
+// reader-preferring lock shared for good and the writer would never get
+// it.  The writer starts once every scanner is running, and alternates
+// Add and DeleteKey on keys from an xorshift stream.
+//
+// Entry: engine
+//        key range
+//        number of writer operations
+//        number of scanner threads
+//        scan function, called with an output array of keyRange keys
+//        pointer to per-update latencies in nanoseconds to fill in, sorted
+// Exit:  full scans per second across the scanners
+template <class TREE, class SCAN>
+double MeasureScanConflict(TREE &tree, size_t keyRange, size_t opTot, int scannerTot, SCAN scan,
+  std::vector<double> *latency)
+{
+  std::atomic<bool> done(false);
+  std::atomic<int> arrived(0);
+  std::atomic<size_t> scanTot(0);
+  std::vector<std::thread> scanners;
+  for (int t = 0; t < scannerTot; t++) {
+    scanners.emplace_back([&]() {
+      std::vector<hedger::S_T> out(keyRange);
+      size_t scans = 0;
+      arrived.fetch_add(1);
+      while (!done.load(std::memory_order_relaxed)) {
+        scan(tree, out.data(), keyRange);
+        scans++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      scanTot.fetch_add(scans);
+    });
+  }
+  while (arrived.load() < scannerTot) {
+    std::this_thread::yield();
+  }
+  latency->resize(opTot);
+  uint32_t x = 2463534242u;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < opTot; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    hedger::S_T key = (hedger::S_T) (x % keyRange);
+    auto before = std::chrono::steady_clock::now();
+    if (i & 1) {
+      tree.DeleteKey(key);
+    } else {
+      tree.Add(key);
+    }
+    (*latency)[i] = Seconds(before, std::chrono::steady_clock::now()) * 1e9;
+  }
+  double seconds = Seconds(start, std::chrono::steady_clock::now());
+  done.store(true, std::memory_order_relaxed);
+  for (auto &scanner : scanners) {
+    scanner.join();
+  }
+  std::sort(latency->begin(), latency->end());
+  return scanTot.load() / seconds;
+}
+
+// BenchPersistent
+//
+// Updates from one writer while 0, 1 and 2 threads scan every key, for
+// a scapegoat tree whose scans hold a reader-writer lock, and for the
+// persistent tree, whose scans run on a snapshot.  Ends with the cost
+// of taking and dropping a snapshot, and the nodes each update copies.
+//
+// Entry: pointer to array
+//        size of array
+void BenchPersistent(hedger::S_T *array, size_t array_size)
+{
+  const int kScannerMax = 2;
+  const size_t kSnapshotTot = 1000000;
+  if (0 == array_size) {
+    return;
+  }
+
+  std::cout << COUT_YELLOW << "persistent:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %8s %10s %9s %9s %9s %9s\n", "KEYS", "ENGINE", "SCANNERS", "WRITE-MOPS",
+    "P50-NS", "P99.9-US", "MAX-US", "SCANS/S");
+  std::vector<double> latency;
+  for (int scannerTot = 0; scannerTot <= kScannerMax; scannerTot++) {
+    for (int engine = 0; engine < 2; engine++) {
+      double scans;
+      const char *name;
+      if (0 == engine) {
+        hedger::SharedLockedTree<hedger::ScapegoatTree> tree;
+        MeasureConcurrentAdds(tree, array, array_size, 1);
+        scans = MeasureScanConflict(tree, array_size, array_size, scannerTot,
+          [](hedger::SharedLockedTree<hedger::ScapegoatTree> &t, hedger::S_T *out, size_t max) {
+            t.RangeScan(INT_MIN, INT_MAX, out, max);
+          }, &latency);
+        name = "rwlocked";
+      } else {
+        hedger::PersistentTree tree;
+        MeasureConcurrentAdds(tree, array, array_size, 1);
+        scans = MeasureScanConflict(tree, array_size, array_size, scannerTot,
+          [](hedger::PersistentTree &t, hedger::S_T *out, size_t max) {
+            t.Snapshot().RangeScan(INT_MIN, INT_MAX, out, max);
+          }, &latency);
+        name = "persistent";
+      }
+      double total = 0.0;
+      for (double ns : latency) {
+        total += ns;
+      }
+      printf("%12zu  %-10s %8d %10.2f %9.0f %9.1f %9.1f %9.1f\n", array_size, name, scannerTot,
+        array_size / total * 1e3, latency[array_size / 2],
+        latency[std::min(array_size - 1, array_size * 999 / 1000)] / 1e3, latency.back() / 1e3,
+        scans);
+    }
+  }
+
+  hedger::PersistentTree tree;
+  MeasureConcurrentAdds(tree, array, array_size, 1);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kSnapshotTot; i++) {
+    hedger::PersistentSnapshot snapshot = tree.Snapshot();
+  }
+  double snapshotSeconds = Seconds(start, std::chrono::steady_clock::now());
+  size_t copied = tree.CopiedTot();
+  for (size_t i = 0; i < array_size; i++) {
+    tree.DeleteKey(array[i]);
+    tree.Add(array[i]);
+  }
+  printf("%12s  %12s %14s\n", "KEYS", "SNAPSHOT-NS", "COPIED/UPDATE");
+  printf("%12zu  %12.1f %14.1f\n", array_size, snapshotSeconds * 1e9 / kSnapshotTot,
+    (tree.CopiedTot() - copied) / (2.0 * array_size));
+}
+
+// BenchCombining
+//
+// Throughput against thread count, from 1 to 32, of one scapegoat tree
+// behind a mutex and behind the flat-combining wrapper, under an
+// update-only and a half-lookup mix, on trees preloaded with the data
+// set.  BATCH is the mean number of requests applied per combining pass.
+//
+// Entry: pointer to array
+//        size of array
+void BenchCombining(hedger::S_T *array, size_t array_size)
+{
+  const int kThreadMax = 32;
+  const int kMixes[] = { 0, 50 };
+  if (0 == array_size) {
+    return;
+  }
+
+  std::cout << COUT_YELLOW << "combining:" << COUT_NORMAL << std::endl;
+  printf("%12s  %6s  %7s  %-10s %8s %8s\n", "KEYS", "READS", "THREADS", "ENGINE", "MOPS/S",
+    "BATCH");
+  for (int readPercent : kMixes) {
+    for (int threadTot = 1; threadTot <= kThreadMax; threadTot *= 2) {
+      for (int engine = 0; engine < 2; engine++) {
+        double seconds;
+        const char *name;
+        char batch[32] = "-";
+        if (0 == engine) {
+          hedger::LockedTree<hedger::ScapegoatTree> tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          name = "locked";
+        } else {
+          hedger::FlatCombiningTree tree;
+          MeasureConcurrentAdds(tree, array, array_size, 1);
+          size_t passes = tree.CombineTot();
+          size_t combined = tree.CombinedTot();
+          seconds = MeasureMix(tree, array_size, array_size, threadTot, readPercent);
+          snprintf(batch, sizeof(batch), "%.2f", (double) (tree.CombinedTot() - combined) /
+            std::max((size_t) 1, tree.CombineTot() - passes));
+          name = "combining";
+        }
+        printf("%12zu  %5d%%  %7d  %-10s %8.2f %8s\n", array_size, readPercent, threadTot, name,
+          array_size / seconds / 1e6, batch);
+      }
+    }
+  }
+}
+
+// BenchLayouts
+//
+// Compare lookup cost of the pointer (scapegoat), Eytzinger and van Emde
+// Boas layouts over key counts from 1K up to max_size, by factors of ten.
+//
+// Entry: largest key count
+void BenchLayouts(size_t max_size)
+{
+  const size_t kQueryMax = 1000000;
+  hedger::PerfCounter counter;
+
+  std::cout << COUT_YELLOW << "layouts:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %10s %10s\n", "KEYS", "LAYOUT", "NS/FIND", "MISS/FIND");
+  for (size_t n = 1000; n <= max_size; n *= 10) {
+    hedger::S_T *array = AllocArray(n);
+    hedger::S_T *sorted = AllocArray(n);
+    if (!array || !sorted) {
+      FreeArray(array);
+      FreeArray(sorted);
+      return;
+    }
+    CreateShuffledDataSet(array, n);
+    for (size_t i = 0; i < n; i++) {
+      sorted[i] = (hedger::S_T) i;
+    }
+    size_t q = n < kQueryMax ? n : kQueryMax;
+
+    {
+      hedger::ScapegoatTree tree;
+      for (size_t i = 0; i < n; i++) {
+        tree.Add(array[i]);
+      }
+      MeasureLookups("pointer", n, tree, array, q, counter);
+    }
+    {
+      hedger::EytzingerIndex index(sorted, n);
+      MeasureLookups("eytzinger", n, index, array, q, counter);
+    }
+    {
+      hedger::VebLayoutIndex index(sorted, n);
+      MeasureLookups("veb", n, index, array, q, counter);
+    }
+
+    FreeArray(array);
+    FreeArray(sorted);
+  }
+}
+
+// BenchFast
+//
+// Snapshot a scapegoat tree into sorted order and build FAST indexes over
+// the snapshot with different block configurations, labelled
+// simd/line/page block depth (0 == level disabled).  1/0/0 is the
+// unblocked tree stored in preorder; the Eytzinger index and the tree
+// itself are included for reference.
+//
+// Entry: pointer to array
+//        size of array
+void BenchFast(hedger::S_T *array, size_t array_size)
+{
+  static const int kConfigs[][3] = {
+    { 1, 0, 0 }, { 2, 0, 0 }, { 2, 4, 0 }, { 2, 4, 10 }, { 3, 0, 0 }, { 3, 6, 0 }, { 3, 6, 12 }
+  };
+  hedger::PerfCounter counter;
+  hedger::ScapegoatTree tree;
+  for (size_t i = 0; i < array_size; i++) {
+    tree.Add(array[i]);
+  }
+  hedger::S_T *sorted = AllocArray(array_size);
+  if (!sorted) {
+    return;
+  }
+  size_t n = tree.PackKeys(sorted);
+
+  std::cout << COUT_YELLOW << "fast:" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %10s %10s\n", "KEYS", "LAYOUT", "NS/FIND", "MISS/FIND");
+  MeasureLookups("pointer", n, tree, array, array_size, counter);
+  {
+    hedger::EytzingerIndex index(sorted, n);
+    MeasureLookups("eytzinger", n, index, array, array_size, counter);
+  }
+  for (const auto &config : kConfigs) {
+    char name[16];
+    snprintf(name, sizeof(name), "%d/%d/%d", config[0], config[1], config[2]);
+    hedger::FastIndex index(sorted, n, config[0], config[1], config[2]);
+    MeasureLookups(name, n, index, array, array_size, counter);
+  }
+  FreeArray(sorted);
+}
+
+// MeasureLearned
+//
+// Build a scapegoat tree from the query keys, snapshot it in order, and
+// compare lookups through the tree, the Eytzinger and FAST indexes and
+// learned indexes of several error bounds.  Build time and index size
+// (model only, for the learned indexes) are reported per index.
+//
+// Entry: key set name
+//        pointer to unique keys in random order, used as queries
+//        number of keys
+void MeasureLearned(const char *set, const hedger::S_T *queries, size_t n)
+{
+  static const int kErrors[] = { 8, 32, 128 };
+  hedger::PerfCounter counter;
+  hedger::ScapegoatTree tree;
+  for (size_t i = 0; i < n; i++) {
+    tree.Add(queries[i]);
+  }
+  hedger::S_T *sorted = AllocArray(n);
+  if (!sorted) {
+    return;
+  }
+  tree.PackKeys(sorted);
+
+  std::cout << COUT_YELLOW << "learned (" << set << "):" << COUT_NORMAL << std::endl;
+  printf("%12s  %-10s %10s %10s\n", "KEYS", "LAYOUT", "NS/FIND", "MISS/FIND");
+  MeasureLookups("pointer", n, tree, queries, n, counter);
+
+  std::vector<double> buildTimes;
+  std::vector<size_t> sizes;
+  std::vector<std::string> names;
+  std::vector<std::string> knots;
+  {
+    auto start = std::chrono::steady_clock::now();
+    hedger::EytzingerIndex index(sorted, n);
+    auto built = std::chrono::steady_clock::now();
+    MeasureLookups("eytzinger", n, index, queries, n, counter);
+    names.push_back("eytzinger");
+    knots.push_back("-");
+    buildTimes.push_back(Seconds(start, built));
+    sizes.push_back(index.MemoryUsage());
+  }
+  {
+    auto start = std::chrono::steady_clock::now();
+    hedger::FastIndex index(sorted, n);
+    auto built = std::chrono::steady_clock::now();
+    MeasureLookups("fast", n, index, queries, n, counter);
+    names.push_back("fast");
+    knots.push_back("-");
+    buildTimes.push_back(Seconds(start, built));
+    sizes.push_back(index.MemoryUsage());
+  }
+  for (int error : kErrors) {
+    char name[16];
+    snprintf(name, sizeof(name), "learned/%d", error);
+    auto start = std::chrono::steady_clock::now();
+    hedger::LearnedIndex index(sorted, n, error);
+    auto built = std::chrono::steady_clock::now();
+    MeasureLookups(name, n, index, queries, n, counter);
+    names.push_back(name);
+    knots.push_back(std::to_string(index.SplineTot()));
+    buildTimes.push_back(Seconds(start, built));
+    sizes.push_back(index.ModelSize());
+  }
+
+  printf("%12s  %-10s %10s %12s %10s\n", "KEYS", "LAYOUT", "BUILD MS", "INDEX BYTES", "KNOTS");
+  for (size_t i = 0; i < names.size(); i++) {
+    printf("%12zu  %-10s %10.2f %12zu %10s\n", n, names[i].c_str(), buildTimes[i] * 1e3, sizes[i],
+      knots[i].c_str());
+  }
+  FreeArray(sorted);
+}
+
+// BenchLearned
+//
+// Learned index against the trees on two key sets of the same size: the
+// dense keys of the data set, and sparse keys whose gaps are uniform
+// random, so positions wander from any single line.
+//
+// Entry: pointer to array
+//        size of array
+void BenchLearned(hedger::S_T *array, size_t array_size)
+{
+  MeasureLearned("dense", array, array_size);
+
+  hedger::S_T *walk = AllocArray(array_size);
+  hedger::S_T *sparse = AllocArray(array_size);
+  if (!walk || !sparse) {
+    FreeArray(walk);
+    FreeArray(sparse);
+    return;
+  }
+  // Mean gap of one stride fills about half of the non-negative range.
+  size_t stride = array_size ? INT_MAX / 2 / array_size : 0;
+  hedger::S_T key = 0;
+  for (size_t i = 0; i < array_size; i++) {
+    key += (hedger::S_T) (1 + rand() % (2 * stride - 1));
+    walk[i] = key;
+  }
+  for (size_t i = 0; i < array_size; i++) {
+    // array is a permutation of [0, array_size), so this shuffles
+    sparse[i] = walk[array[i]];
+  }
+  MeasureLearned("sparse", sparse, array_size);
+  FreeArray(walk);
+  FreeArray(sparse);
+}
+
+// BenchSetOps
+//
+// Merge a delta of one tenth of the keys, half of them already present,
+// into a base set: by one Add per key on a scapegoat tree, and by
+// building a weight-balanced delta tree and taking the Union.  The
+// weight-balanced Intersection and Difference of the same sets are timed
+// as well.
+//
+// Entry: pointer to array
+//        size of array
+void BenchSetOps(hedger::S_T *array, size_t array_size)
+{
+  size_t deltaTot = array_size / 10;
+  size_t baseTot = array_size - deltaTot;
+  size_t deltaStart = baseTot - deltaTot / 2;
+  std::vector<double> addTimes, unionTimes, intersectTimes, differenceTimes;
+
+  for (int i = 0; i < kIterationTot; i++) {
+    hedger::ScapegoatTree tree;
+    for (size_t j = 0; j < baseTot; j++) {
+      tree.Add(array[j]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (size_t j = deltaStart; j < array_size; j++) {
+      if (!tree.Find(array[j])) {
+        tree.Add(array[j]);
+      }
+    }
+    addTimes.push_back(Seconds(start, std::chrono::steady_clock::now()));
+
+    for (int op = 0; op < 3; op++) {
+      hedger::WeightBalancedTree base, delta;
+      for (size_t j = 0; j < baseTot; j++) {
+        base.Add(array[j]);
+      }
+      start = std::chrono::steady_clock::now();
+      for (size_t j = deltaStart; j < array_size; j++) {
+        delta.Add(array[j]);
+      }
+      if (0 == op) {
+        base.Union(delta);
+        unionTimes.push_back(Seconds(start, std::chrono::steady_clock::now()));
+        if (base.Size() != (int) array_size) {
+          printf("setops: union holds %d of %zu keys\n", base.Size(), array_size);
+        }
+      } else if (1 == op) {
+        base.Intersection(delta);
+        intersectTimes.push_back(Seconds(start, std::chrono::steady_clock::now()));
+      } else {
+        base.Difference(delta);
+        differenceTimes.push_back(Seconds(start, std::chrono::steady_clock::now()));
+      }
+    }
+  }
+
+  ReportTiming(addTimes, kIterationTot, "scapegoat ADD DELTA");
+  ReportTiming(unionTimes, kIterationTot, "wbtree UNION DELTA");
+  ReportTiming(intersectTimes, kIterationTot, "wbtree INTERSECTION DELTA");
+  ReportTiming(differenceTimes, kIterationTot, "wbtree DIFFERENCE DELTA");
+}
+
+// RunEngine
+//
+// Benchmark the engine selected by name.
+//
+// Entry: engine name
+//        pointer to array
+//        size of array
+// Exit:  true == engine known
+bool RunEngine(const char *engine, hedger::S_T *array, size_t array_size)
+{
+  bool all = !strcmp(engine, "all");
+  bool known = all;
+
+  if (all || !strcmp(engine, "bstree")) {
+    BenchTree<hedger::BSTree>("bstree", array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "scapegoat")) {
+    BenchTree<hedger::ScapegoatTree>("scapegoat", array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "zip")) {
+    BenchTree<hedger::ZipTree>("zip", array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "wbtree")) {
+    BenchTree<hedger::WeightBalancedTree>("wbtree", array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "bplus")) {
+    BenchTree<hedger::BPlusTree>("bplus", array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "csb")) {
+    BenchTree<hedger::CsbTree>("csb", array, array_size);
+    BenchReadOptimized(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "betree")) {
+    BenchTree<hedger::BeTree>("betree", array, array_size);
+    BenchWriteOptimized(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "lsm")) {
+    BenchTree<hedger::LsmTree>("lsm", array, array_size);
+    BenchTree<LsmTiered>("lsm-tier", array, array_size);
+    BenchLsm(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "pma")) {
+    BenchTree<hedger::PackedMemoryArray>("pma", array, array_size);
+    BenchScan(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "veb")) {
+    BenchTree<hedger::VebTree>("veb", array, array_size);
+    BenchVeb(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "sharded")) {
+    BenchTree<hedger::ShardedTree>("sharded", array, array_size);
+    BenchSharded(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "olc")) {
+    BenchTree<hedger::OlcTree>("olc", array, array_size);
+    BenchOlc(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "nmtree")) {
+    BenchTree<hedger::NmTree>("nmtree", array, array_size);
+    BenchLockFree(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "cskiplist")) {
+    BenchTree<hedger::ConcurrentSkipList>("cskiplist", array, array_size);
+    BenchConcurrentSkipList(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "cow")) {
+    BenchTree<hedger::CowScapegoatTree>("cow", array, array_size);
+    BenchCow(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "persistent")) {
+    BenchTree<hedger::PersistentTree>("persistent", array, array_size);
+    BenchPersistent(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "combining")) {
+    BenchTree<hedger::FlatCombiningTree>("combining", array, array_size);
+    BenchCombining(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "art")) {
+    BenchTree<hedger::ArtTree>("art", array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "skiplist")) {
+    BenchTree<hedger::SkipList>("skiplist", array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "skiplist-half")) {
+    BenchTree<SkipListHalf>("skiplist-half", array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "finger")) {
+    BenchFinger(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "eytzinger")) {
+    BenchFreeze(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "fast")) {
+    BenchFast(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "learned")) {
+    BenchLearned(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "setops")) {
+    BenchSetOps(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "reclaim")) {
+    BenchReclaim(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "threads")) {
+    BenchThreads(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "build")) {
+    BenchBuild(array, array_size);
+    known = true;
+  }
+  if (all || !strcmp(engine, "layouts")) {
+    BenchLayouts(array_size);
+    known = true;
+  }
+  return known;
+}
+
 // main
 int main(int argc, const char **argv)
 {
@@ -213,8 +2217,25 @@ int main(int argc, const char **argv)
     PrintUsage();
     return -1;
   }
-  sscanf(argv[1], "%d", (int *) &array_size);
-  TestBtree(array_size);
+  sscanf(argv[1], "%zu", &array_size);
+  if (argc < 3) {
+    TestBtree(array_size);
+    return result;
+  }
+
+  hedger::S_T *array = AllocArray(array_size);
+  if (!array) {
+    return -1;
+  }
+  CreateShuffledDataSet(array, array_size);
+  for (int i = 2; i < argc; i++) {
+    if (!RunEngine(argv[i], array, array_size)) {
+      printf("Unknown engine: %s\n", argv[i]);
+      PrintUsage();
+      result = -1;
+    }
+  }
+  FreeArray(array);
 
   return result;
 }
@@ -0,0 +1,175 @@
+// veb_layout_index.cc
+//
+// Implements an immutable search tree stored in van Emde Boas layout.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include <new>
+#include <stdexcept>
+
+#include "veb_layout_index.h"
+
+namespace hedger
+{
+// Constructor
+//
+// Entry: pointer to keys in ascending order
+//        number of keys
+VebLayoutIndex::VebLayoutIndex(const hedger::S_T *sorted, std::size_t n)
+{
+  n_ = n;
+  height_ = 0;
+  for (std::size_t k = n; k; k >>= 1) {
+    height_++;
+  }
+  if (height_ > kVebMaxHeight) {
+    throw std::length_error("VebLayoutIndex: too many keys");
+  }
+  slotTot_ = ((std::size_t) 1 << height_) - 1;
+
+  for (int d = 0; d <= kVebMaxHeight; d++) {
+    topSize_[d] = bottomSize_[d] = 0;
+    topDepth_[d] = 0;
+  }
+  if (height_) {
+    Split(1, height_);
+  }
+
+  void *mem = nullptr;
+  if (posix_memalign(&mem, kCacheLine, (slotTot_ + 1) * sizeof(hedger::S_T))) {
+    throw std::bad_alloc();
+  }
+  keys_ = (hedger::S_T *) mem;
+
+  std::size_t pos[kVebMaxHeight + 1];
+  Build(sorted, 0, 1, 1, pos);
+}
+
+// Destructor
+VebLayoutIndex::~VebLayoutIndex()
+{
+  free(keys_);
+}
+
+// Split
+//
+// Fill the navigation tables for a subtree by splitting it into its top
+// tree and bottom trees.  Calls itself recursively; every depth below
+// the root is the root depth of exactly one family of bottom trees.
+//
+// Entry: depth of subtree root
+//        height of subtree
+void VebLayoutIndex::Split(int rootDepth, int height)
+{
+  if (height <= 1) {
+    return;
+  }
+  int top = height / 2;
+  int bottom = height - top;
+  int d = rootDepth + top;
+  topSize_[d] = ((std::size_t) 1 << top) - 1;
+  bottomSize_[d] = ((std::size_t) 1 << bottom) - 1;
+  topDepth_[d] = rootDepth;
+  Split(rootDepth, top);
+  Split(d, bottom);
+}
+
+// Build
+//
+// In-order walk of the implicit complete tree, placing the r-th sorted
+// key at the vEB slot of the r-th node visited.  pos[] holds the slots of
+// the current node's ancestors.  Calls itself recursively.
+//
+// Entry: pointer to sorted keys
+//        next in-order rank
+//        BFS index of current node
+//        depth of current node
+//        slot array indexed by depth
+// Exit:  next in-order rank
+std::size_t VebLayoutIndex::Build(const hedger::S_T *sorted, std::size_t r, std::size_t i,
+  int d, std::size_t *pos)
+{
+  if (d > height_) {
+    return r;
+  }
+  pos[d] = (1 == d) ? 0 : pos[topDepth_[d]] + topSize_[d] + (i & topSize_[d]) * bottomSize_[d];
+  r = Build(sorted, r, 2 * i, d + 1, pos);
+  keys_[pos[d]] = r < n_ ? sorted[r] : INT_MAX;
+  r++;
+  return Build(sorted, r, 2 * i + 1, d + 1, pos);
+}
+
+// LowerBoundSlot
+//
+// Descend the full height, remembering the last node where the walk went
+// left.  Its in-order rank tells real keys from padding.
+//
+// Entry: key
+// Exit:  slot of the smallest key >= key, or slotTot_ if there is none
+std::size_t VebLayoutIndex::LowerBoundSlot(hedger::S_T key)
+{
+  std::size_t pos[kVebMaxHeight + 1];
+  std::size_t i = 1;
+  std::size_t bestSlot = slotTot_;
+  std::size_t bestIndex = 0;
+  int bestDepth = 0;
+
+  for (int d = 1; d <= height_; d++) {
+    pos[d] = (1 == d) ? 0 : pos[topDepth_[d]] + topSize_[d] + (i & topSize_[d]) * bottomSize_[d];
+    bool left = key <= keys_[pos[d]];
+    bestSlot = left ? pos[d] : bestSlot;
+    bestIndex = left ? i : bestIndex;
+    bestDepth = left ? d : bestDepth;
+    i = 2 * i + !left;
+  }
+
+  if (bestDepth) {
+    // In-order rank of BFS node bestIndex at depth bestDepth
+    std::size_t offset = bestIndex - ((std::size_t) 1 << (bestDepth - 1));
+    std::size_t rank = ((2 * offset + 1) << (height_ - bestDepth)) - 1;
+    if (rank >= n_) {
+      bestSlot = slotTot_;
+    }
+  }
+  return bestSlot;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool VebLayoutIndex::Find(hedger::S_T key)
+{
+  std::size_t slot = LowerBoundSlot(key);
+  return slot < slotTot_ && keys_[slot] == key;
+}
+
+// LowerBound
+//
+// Entry: key
+// Exit:  pointer to the smallest key >= key, or nullptr if there is none
+const hedger::S_T *VebLayoutIndex::LowerBound(hedger::S_T key)
+{
+  std::size_t slot = LowerBoundSlot(key);
+  return slot < slotTot_ ? &keys_[slot] : nullptr;
+}
+} // namespace hedger
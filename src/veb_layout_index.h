@@ -0,0 +1,74 @@
+// veb_layout_index.h
+//
+// Implements an immutable search tree stored in van Emde Boas layout.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef VEB_LAYOUT_INDEX_H_
+#define VEB_LAYOUT_INDEX_H_
+
+#include <cstddef>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Deepest tree supported (2^kVebMaxHeight - 1 slots)
+const int kVebMaxHeight = 48;
+
+// VebLayoutIndex
+//
+// A complete binary search tree of height h is split into a top tree of
+// height h / 2 and the bottom trees hanging from it, each stored
+// contiguously and laid out the same way recursively.  Every subtree of
+// every height then occupies a contiguous run of slots, so a descent
+// touches O(log_B n) blocks for any block size B without knowing B.
+//
+// Navigation uses the per-depth tables of Brodal, Fagerberg and Jacob:
+// the slot of a node at depth d with BFS index i is
+//   pos[d] = pos[topDepth_[d]] + topSize_[d] + (i & topSize_[d]) * bottomSize_[d]
+// so no child pointers are stored.  The tree is padded to complete
+// height; padding sorts after every real key.
+class VebLayoutIndex
+{
+ public:
+  VebLayoutIndex(const hedger::S_T *sorted, std::size_t n);
+  virtual ~VebLayoutIndex();
+
+  bool Find(hedger::S_T key);
+  const hedger::S_T *LowerBound(hedger::S_T key);
+  std::size_t Size() { return n_; }
+  std::size_t MemoryUsage() { return slotTot_ * sizeof(hedger::S_T); }
+
+ protected:
+  void Split(int rootDepth, int height);
+  std::size_t Build(const hedger::S_T *sorted, std::size_t r, std::size_t i, int d,
+    std::size_t *pos);
+  std::size_t LowerBoundSlot(hedger::S_T key);
+
+  hedger::S_T *   keys_;                          // slots in vEB order
+  std::size_t     n_;                             // real keys
+  std::size_t     slotTot_;                       // 2^height_ - 1
+  int             height_;
+  std::size_t     topSize_[kVebMaxHeight + 1];    // indexed by depth, root = 1
+  std::size_t     bottomSize_[kVebMaxHeight + 1];
+  int             topDepth_[kVebMaxHeight + 1];
+};
+} // namespace hedger
+#endif // #ifndef VEB_LAYOUT_INDEX_H_
@@ -0,0 +1,366 @@
+// veb_tree.cc
+//
+// Implements a van Emde Boas tree over a bounded universe of S_T keys.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdexcept>
+
+#include "veb_tree.h"
+
+namespace hedger
+{
+//
+// Helper functions
+//
+
+// LowBits
+//
+// Entry: universe bits of an inner node
+// Exit:  bits of a key that index within a cluster
+static inline int LowBits(int bits)
+{
+  return bits / 2;
+}
+
+// LeafMinMax
+//
+// Refresh a leaf's min and max from its bitmap.
+//
+// Entry: pointer to leaf
+static inline void LeafMinMax(hedger::VebNode *node)
+{
+  if (node->leaf) {
+    node->min = __builtin_ctzll(node->leaf);
+    node->max = 63 - __builtin_clzll(node->leaf);
+  } else {
+    node->min = node->max = -1;
+  }
+}
+
+// Constructor
+//
+// Entry: universe size as a power of two, 1 to 31 bits
+VebTree::VebTree(int universeBits)
+{
+  if (universeBits < 1 || universeBits > 31) {
+    throw std::invalid_argument("VebTree: universe must be 1 to 31 bits");
+  }
+  universeBits_ = universeBits;
+  keyTot_ = 0;
+  bytes_ = 0;
+  root_ = NewNode(universeBits);
+}
+
+// Destructor
+VebTree::~VebTree()
+{
+  DeleteRecursive(root_);
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == added, false == present or outside the universe
+bool VebTree::Add(hedger::S_T key)
+{
+  if (!InUniverse(key) || MemberRecurse(root_, key)) {
+    return false;
+  }
+  InsertRecurse(root_, key);
+  keyTot_++;
+  return true;
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool VebTree::Find(hedger::S_T key)
+{
+  return InUniverse(key) && MemberRecurse(root_, key);
+}
+
+// DeleteKey
+//
+// Entry: key
+// Exit:  true == deleted, false == not present
+bool VebTree::DeleteKey(hedger::S_T key)
+{
+  if (!InUniverse(key) || !MemberRecurse(root_, key)) {
+    return false;
+  }
+  DeleteRecurse(root_, key);
+  keyTot_--;
+  return true;
+}
+
+// Successor
+//
+// Entry: key, any S_T
+//        pointer to receive the smallest key > key
+// Exit:  true == found
+bool VebTree::Successor(hedger::S_T key, hedger::S_T *next)
+{
+  int32_t x;
+  if (key < 0) {
+    x = root_->min;
+  } else if (!InUniverse(key)) {
+    x = -1;
+  } else {
+    x = SuccessorRecurse(root_, key);
+  }
+  if (x < 0) {
+    return false;
+  }
+  *next = x;
+  return true;
+}
+
+// Predecessor
+//
+// Entry: key, any S_T
+//        pointer to receive the largest key < key
+// Exit:  true == found
+bool VebTree::Predecessor(hedger::S_T key, hedger::S_T *prev)
+{
+  int32_t x;
+  if (key < 0) {
+    x = -1;
+  } else if (!InUniverse(key)) {
+    x = root_->max;
+  } else {
+    x = PredecessorRecurse(root_, key);
+  }
+  if (x < 0) {
+    return false;
+  }
+  *prev = x;
+  return true;
+}
+
+// MemberRecurse
+//
+// Entry: pointer to node
+//        key within the node's universe
+// Exit:  true == present
+bool VebTree::MemberRecurse(hedger::VebNode *node, int32_t x)
+{
+  for (;;) {
+    if (x == node->min || x == node->max) {
+      return true;
+    }
+    if (node->bits <= kVebLeafBits) {
+      return (node->leaf >> x) & 1;
+    }
+    int low = LowBits(node->bits);
+    hedger::VebNode *cluster = node->clusters[x >> low];
+    if (!cluster) {
+      return false;
+    }
+    node = cluster;
+    x &= (1 << low) - 1;
+  }
+}
+
+// InsertRecurse
+//
+// Entry: pointer to node
+//        key within the node's universe, not present
+void VebTree::InsertRecurse(hedger::VebNode *node, int32_t x)
+{
+  if (node->bits <= kVebLeafBits) {
+    node->leaf |= 1ULL << x;
+    LeafMinMax(node);
+    return;
+  }
+  if (node->min < 0) {
+    node->min = node->max = x;
+    return;
+  }
+  if (x < node->min) {
+    int32_t t = x;
+    x = node->min;
+    node->min = t;
+  }
+  if (x > node->max) {
+    node->max = x;
+  }
+
+  int low = LowBits(node->bits);
+  int32_t high = x >> low;
+  hedger::VebNode *cluster = node->clusters[high];
+  if (!cluster) {
+    cluster = node->clusters[high] = NewNode(low);
+  }
+  if (cluster->min < 0) {
+    if (!node->summary) {
+      node->summary = NewNode(node->bits - low);
+    }
+    InsertRecurse(node->summary, high);
+  }
+  InsertRecurse(cluster, x & ((1 << low) - 1));
+}
+
+// DeleteRecurse
+//
+// Entry: pointer to node
+//        key within the node's universe, present
+void VebTree::DeleteRecurse(hedger::VebNode *node, int32_t x)
+{
+  if (node->bits <= kVebLeafBits) {
+    node->leaf &= ~(1ULL << x);
+    LeafMinMax(node);
+    return;
+  }
+  if (node->min == node->max) {
+    node->min = node->max = -1;
+    return;
+  }
+
+  int low = LowBits(node->bits);
+  if (x == node->min) {
+    // Promote the smallest clustered key to min, and delete it below.
+    int32_t first = node->summary->min;
+    x = (first << low) | node->clusters[first]->min;
+    node->min = x;
+  }
+
+  int32_t high = x >> low;
+  hedger::VebNode *cluster = node->clusters[high];
+  DeleteRecurse(cluster, x & ((1 << low) - 1));
+  if (cluster->min < 0) {
+    FreeNode(cluster);
+    node->clusters[high] = nullptr;
+    DeleteRecurse(node->summary, high);
+    if (x == node->max) {
+      int32_t last = node->summary->max;
+      node->max = last < 0 ? node->min : (last << low) | node->clusters[last]->max;
+    }
+  } else if (x == node->max) {
+    node->max = (high << low) | cluster->max;
+  }
+}
+
+// SuccessorRecurse
+//
+// Entry: pointer to node
+//        key within the node's universe
+// Exit:  smallest key > x, or -1
+int32_t VebTree::SuccessorRecurse(hedger::VebNode *node, int32_t x)
+{
+  if (node->bits <= kVebLeafBits) {
+    uint64_t above = x >= 63 ? 0 : node->leaf & (~0ULL << (x + 1));
+    return above ? __builtin_ctzll(above) : -1;
+  }
+  if (node->min >= 0 && x < node->min) {
+    return node->min;
+  }
+  int low = LowBits(node->bits);
+  int32_t high = x >> low;
+  int32_t offset = x & ((1 << low) - 1);
+  hedger::VebNode *cluster = node->clusters[high];
+  if (cluster && cluster->min >= 0 && offset < cluster->max) {
+    return (high << low) | SuccessorRecurse(cluster, offset);
+  }
+  int32_t next = node->summary ? SuccessorRecurse(node->summary, high) : -1;
+  return next < 0 ? -1 : (next << low) | node->clusters[next]->min;
+}
+
+// PredecessorRecurse
+//
+// Entry: pointer to node
+//        key within the node's universe
+// Exit:  largest key < x, or -1
+int32_t VebTree::PredecessorRecurse(hedger::VebNode *node, int32_t x)
+{
+  if (node->bits <= kVebLeafBits) {
+    uint64_t below = node->leaf & ((1ULL << x) - 1);
+    return below ? 63 - __builtin_clzll(below) : -1;
+  }
+  if (node->max >= 0 && x > node->max) {
+    return node->max;
+  }
+  int low = LowBits(node->bits);
+  int32_t high = x >> low;
+  int32_t offset = x & ((1 << low) - 1);
+  hedger::VebNode *cluster = node->clusters[high];
+  if (cluster && cluster->min >= 0 && offset > cluster->min) {
+    return (high << low) | PredecessorRecurse(cluster, offset);
+  }
+  int32_t prev = node->summary ? PredecessorRecurse(node->summary, high) : -1;
+  if (prev < 0) {
+    // min lives outside the clusters
+    return node->min >= 0 && x > node->min ? node->min : -1;
+  }
+  return (prev << low) | node->clusters[prev]->max;
+}
+
+// NewNode
+//
+// Entry: universe bits
+// Exit:  pointer to empty node
+hedger::VebNode *VebTree::NewNode(int bits)
+{
+  hedger::VebNode *node = new hedger::VebNode();
+  node->min = node->max = -1;
+  node->bits = bits;
+  node->leaf = 0;
+  node->summary = nullptr;
+  node->clusters = nullptr;
+  bytes_ += sizeof(hedger::VebNode);
+  if (bits > kVebLeafBits) {
+    std::size_t clusterTot = (std::size_t) 1 << (bits - LowBits(bits));
+    node->clusters = new hedger::VebNode *[clusterTot]();
+    bytes_ += clusterTot * sizeof(hedger::VebNode *);
+  }
+  return node;
+}
+
+// FreeNode
+//
+// Free an empty node and its summary.
+//
+// Entry: pointer to node
+void VebTree::FreeNode(hedger::VebNode *node)
+{
+  DeleteRecursive(node);
+}
+
+// DeleteRecursive
+//
+// Entry: pointer to node; it, its summary and its clusters are freed
+void VebTree::DeleteRecursive(hedger::VebNode *node)
+{
+  if (!node) {
+    return;
+  }
+  bytes_ -= sizeof(hedger::VebNode);
+  if (node->clusters) {
+    std::size_t clusterTot = (std::size_t) 1 << (node->bits - LowBits(node->bits));
+    for (std::size_t i = 0; i < clusterTot; i++) {
+      DeleteRecursive(node->clusters[i]);
+    }
+    delete [] node->clusters;
+    bytes_ -= clusterTot * sizeof(hedger::VebNode *);
+  }
+  DeleteRecursive(node->summary);
+  delete node;
+}
+} // namespace hedger
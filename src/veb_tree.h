@@ -0,0 +1,91 @@
+// veb_tree.h
+//
+// Implements a van Emde Boas tree over a bounded universe of S_T keys.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef VEB_TREE_H_
+#define VEB_TREE_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+#include "algo.h"
+
+namespace hedger
+{
+const int kVebUniverseBits = 31;        // default universe: every non-negative S_T
+const int kVebLeafBits = 6;             // universes this small are one 64-bit word
+
+// VebNode
+//
+// A universe of 2^bits keys.  Inner nodes split a key into high bits,
+// picking one of 2^(bits - bits / 2) clusters, and low bits within it;
+// summary records which clusters are non-empty.  min is held here and in
+// no cluster, so inserting into an empty node is O(1).  Leaves keep their
+// keys in a bitmap, min and max included.
+struct VebNode
+{
+  int32_t             min;              // -1 == empty
+  int32_t             max;
+  int                 bits;
+  uint64_t            leaf;             // leaf bitmap
+  hedger::VebNode *   summary;          // inner: non-empty clusters, or nullptr
+  hedger::VebNode **  clusters;         // inner: allocated on first use
+};
+
+// VebTree
+//
+// Add, Find, DeleteKey, Successor and Predecessor all cost O(log log U)
+// for a universe of U keys.  Clusters are allocated when they get their
+// first key and freed when they lose their last, so memory follows the
+// keys present rather than U.
+class VebTree
+{
+ public:
+  VebTree(int universeBits = kVebUniverseBits);
+  virtual ~VebTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  bool Successor(hedger::S_T key, hedger::S_T *next);
+  bool Predecessor(hedger::S_T key, hedger::S_T *prev);
+  int Size() { return keyTot_; }
+  int UniverseBits() { return universeBits_; }
+  std::size_t MemoryUsage() { return bytes_; }
+
+ protected:
+  bool InUniverse(hedger::S_T key) { return key >= 0 && ((int64_t) key >> universeBits_) == 0; }
+  bool MemberRecurse(hedger::VebNode *node, int32_t x);
+  void InsertRecurse(hedger::VebNode *node, int32_t x);
+  void DeleteRecurse(hedger::VebNode *node, int32_t x);
+  int32_t SuccessorRecurse(hedger::VebNode *node, int32_t x);
+  int32_t PredecessorRecurse(hedger::VebNode *node, int32_t x);
+  hedger::VebNode *NewNode(int bits);
+  void FreeNode(hedger::VebNode *node);
+  void DeleteRecursive(hedger::VebNode *node);
+
+  hedger::VebNode *   root_;
+  int                 universeBits_;
+  int                 keyTot_;
+  std::size_t         bytes_;
+};
+} // namespace hedger
+#endif // #ifndef VEB_TREE_H_
@@ -0,0 +1,491 @@
+// weight_balanced_tree.cc
+//
+// Implements a weight-balanced (BB[alpha]) tree with join-based set
+// operations.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include "weight_balanced_tree.h"
+
+namespace hedger
+{
+// Constructor
+WeightBalancedTree::WeightBalancedTree()
+{
+  root_ = nullptr;
+}
+
+// Destructor
+WeightBalancedTree::~WeightBalancedTree()
+{
+  DeleteRecursive(root_);
+}
+
+// Add
+//
+// Entry: key
+// Exit:  true == inserted, false == key already present
+bool WeightBalancedTree::Add(hedger::S_T key)
+{
+  bool added = false;
+  root_ = AddRecurse(root_, key, &added);
+  return added;
+}
+
+// AddRecurse
+// Internal recursion function for Add; rebalances on the way back up.
+// Entry: subtree root
+//        key
+//        pointer to flag set if a node was added
+// Exit:  new subtree root
+hedger::WbNode *WeightBalancedTree::AddRecurse(hedger::WbNode *node, hedger::S_T key, bool *added)
+{
+  if (!node) {
+    *added = true;
+    return new hedger::WbNode(key);
+  }
+  if (key < node->key) {
+    node->left = AddRecurse(node->left, key, added);
+  } else if (key > node->key) {
+    node->right = AddRecurse(node->right, key, added);
+  } else {
+    return node;
+  }
+  return Balance(node);
+}
+
+// Find
+//
+// Entry: key
+// Exit:  true == key present
+bool WeightBalancedTree::Find(hedger::S_T key)
+{
+  hedger::WbNode *node = root_;
+  while (node) {
+    if (key < node->key) {
+      node = node->left;
+    } else if (key > node->key) {
+      node = node->right;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+// DeleteKey
+//
+// Entry: key
+// Exit:  true == success
+bool WeightBalancedTree::DeleteKey(hedger::S_T key)
+{
+  bool deleted = false;
+  root_ = DeleteRecurse(root_, key, &deleted);
+  return deleted;
+}
+
+// DeleteRecurse
+// Internal recursion function for DeleteKey.
+// Entry: subtree root
+//        key
+//        pointer to flag set if a node was deleted
+// Exit:  new subtree root
+hedger::WbNode *WeightBalancedTree::DeleteRecurse(hedger::WbNode *node, hedger::S_T key,
+  bool *deleted)
+{
+  if (!node) {
+    return nullptr;
+  }
+  if (key < node->key) {
+    node->left = DeleteRecurse(node->left, key, deleted);
+  } else if (key > node->key) {
+    node->right = DeleteRecurse(node->right, key, deleted);
+  } else {
+    hedger::WbNode *glued = Glue(node->left, node->right);
+    delete node;
+    *deleted = true;
+    return glued;
+  }
+  return Balance(node);
+}
+
+// Union
+//
+// this = this | other.  other is left empty.
+//
+// Entry: other tree
+void WeightBalancedTree::Union(hedger::WeightBalancedTree &other)
+{
+  root_ = UnionRecurse(root_, other.root_);
+  other.root_ = nullptr;
+}
+
+// Intersection
+//
+// this = this & other.  other is left empty.
+//
+// Entry: other tree
+void WeightBalancedTree::Intersection(hedger::WeightBalancedTree &other)
+{
+  root_ = IntersectionRecurse(root_, other.root_);
+  other.root_ = nullptr;
+}
+
+// Difference
+//
+// this = this - other.  other is left empty.
+//
+// Entry: other tree
+void WeightBalancedTree::Difference(hedger::WeightBalancedTree &other)
+{
+  root_ = DifferenceRecurse(root_, other.root_);
+  other.root_ = nullptr;
+}
+
+// UnionRecurse
+// Entry: two subtrees, both consumed
+// Exit:  root of their union
+hedger::WbNode *WeightBalancedTree::UnionRecurse(hedger::WbNode *a, hedger::WbNode *b)
+{
+  if (!a) {
+    return b;
+  }
+  if (!b) {
+    return a;
+  }
+  hedger::WbNode *bLeft, *bRight;
+  hedger::WbNode *dup = Split(b, a->key, &bLeft, &bRight);
+  delete dup;
+  hedger::WbNode *aLeft = a->left;
+  hedger::WbNode *aRight = a->right;
+  hedger::WbNode *left = UnionRecurse(aLeft, bLeft);
+  hedger::WbNode *right = UnionRecurse(aRight, bRight);
+  return Join(left, a, right);
+}
+
+// IntersectionRecurse
+// Entry: two subtrees, both consumed
+// Exit:  root of their intersection
+hedger::WbNode *WeightBalancedTree::IntersectionRecurse(hedger::WbNode *a, hedger::WbNode *b)
+{
+  if (!a || !b) {
+    DeleteRecursive(a);
+    DeleteRecursive(b);
+    return nullptr;
+  }
+  hedger::WbNode *bLeft, *bRight;
+  hedger::WbNode *dup = Split(b, a->key, &bLeft, &bRight);
+  hedger::WbNode *aLeft = a->left;
+  hedger::WbNode *aRight = a->right;
+  hedger::WbNode *left = IntersectionRecurse(aLeft, bLeft);
+  hedger::WbNode *right = IntersectionRecurse(aRight, bRight);
+  if (dup) {
+    delete dup;
+    return Join(left, a, right);
+  }
+  delete a;
+  return Merge(left, right);
+}
+
+// DifferenceRecurse
+// Entry: two subtrees, both consumed
+// Exit:  root of a - b
+hedger::WbNode *WeightBalancedTree::DifferenceRecurse(hedger::WbNode *a, hedger::WbNode *b)
+{
+  if (!a || !b) {
+    DeleteRecursive(b);
+    return a;
+  }
+  hedger::WbNode *aLeft, *aRight;
+  hedger::WbNode *dup = Split(a, b->key, &aLeft, &aRight);
+  delete dup;
+  hedger::WbNode *bLeft = b->left;
+  hedger::WbNode *bRight = b->right;
+  delete b;
+  hedger::WbNode *left = DifferenceRecurse(aLeft, bLeft);
+  hedger::WbNode *right = DifferenceRecurse(aRight, bRight);
+  return Merge(left, right);
+}
+
+// Join
+//
+// Combine two trees and a middle node, where every key of left is below
+// mid->key and every key of right above it.  Descends the larger tree's
+// inner spine until the sizes are within kWbDelta, then rebalances on
+// the way back up.
+//
+// Entry: left tree
+//        middle node (its links are overwritten)
+//        right tree
+// Exit:  root of joined tree
+hedger::WbNode *WeightBalancedTree::Join(hedger::WbNode *left, hedger::WbNode *mid,
+  hedger::WbNode *right)
+{
+  if (!left) {
+    return InsertMin(mid, right);
+  }
+  if (!right) {
+    return InsertMax(mid, left);
+  }
+  if (kWbDelta * left->size < right->size) {
+    right->left = Join(left, mid, right->left);
+    return Balance(right);
+  }
+  if (kWbDelta * right->size < left->size) {
+    left->right = Join(left->right, mid, right);
+    return Balance(left);
+  }
+  mid->left = left;
+  mid->right = right;
+  Update(mid);
+  return mid;
+}
+
+// Merge
+//
+// Join without a middle node: every key of left is below every key of
+// right, but the two need not be balanced against each other.
+//
+// Entry: left tree
+//        right tree
+// Exit:  root of merged tree
+hedger::WbNode *WeightBalancedTree::Merge(hedger::WbNode *left, hedger::WbNode *right)
+{
+  if (!left) {
+    return right;
+  }
+  if (!right) {
+    return left;
+  }
+  if (kWbDelta * left->size < right->size) {
+    right->left = Merge(left, right->left);
+    return Balance(right);
+  }
+  if (kWbDelta * right->size < left->size) {
+    left->right = Merge(left->right, right);
+    return Balance(left);
+  }
+  return Glue(left, right);
+}
+
+// Glue
+//
+// Merge two trees already balanced against each other, by lifting the
+// extreme node of the larger one to the root.
+//
+// Entry: left tree
+//        right tree
+// Exit:  root of merged tree
+hedger::WbNode *WeightBalancedTree::Glue(hedger::WbNode *left, hedger::WbNode *right)
+{
+  if (!left) {
+    return right;
+  }
+  if (!right) {
+    return left;
+  }
+  hedger::WbNode *mid;
+  if (left->size > right->size) {
+    mid = RemoveMax(&left);
+  } else {
+    mid = RemoveMin(&right);
+  }
+  mid->left = left;
+  mid->right = right;
+  return Balance(mid);
+}
+
+// InsertMin
+// Entry: node whose key is below every key of tree
+//        tree
+// Exit:  new tree root
+hedger::WbNode *WeightBalancedTree::InsertMin(hedger::WbNode *node, hedger::WbNode *tree)
+{
+  if (!tree) {
+    node->left = node->right = nullptr;
+    node->size = 1;
+    return node;
+  }
+  tree->left = InsertMin(node, tree->left);
+  return Balance(tree);
+}
+
+// InsertMax
+// Entry: node whose key is above every key of tree
+//        tree
+// Exit:  new tree root
+hedger::WbNode *WeightBalancedTree::InsertMax(hedger::WbNode *node, hedger::WbNode *tree)
+{
+  if (!tree) {
+    node->left = node->right = nullptr;
+    node->size = 1;
+    return node;
+  }
+  tree->right = InsertMax(node, tree->right);
+  return Balance(tree);
+}
+
+// RemoveMin
+// Detach the smallest node of a non-empty tree.
+// Entry: pointer to tree root, updated
+// Exit:  detached node
+hedger::WbNode *WeightBalancedTree::RemoveMin(hedger::WbNode **tree)
+{
+  hedger::WbNode *node = *tree;
+  if (!node->left) {
+    *tree = node->right;
+    return node;
+  }
+  hedger::WbNode *min = RemoveMin(&node->left);
+  *tree = Balance(node);
+  return min;
+}
+
+// RemoveMax
+// Detach the largest node of a non-empty tree.
+// Entry: pointer to tree root, updated
+// Exit:  detached node
+hedger::WbNode *WeightBalancedTree::RemoveMax(hedger::WbNode **tree)
+{
+  hedger::WbNode *node = *tree;
+  if (!node->right) {
+    *tree = node->left;
+    return node;
+  }
+  hedger::WbNode *max = RemoveMax(&node->right);
+  *tree = Balance(node);
+  return max;
+}
+
+// Split
+//
+// Split a tree into the keys below and above key.
+//
+// Entry: tree, consumed
+//        key
+//        pointer to returned tree of keys < key
+//        pointer to returned tree of keys > key
+// Exit:  the detached node holding key, or nullptr
+hedger::WbNode *WeightBalancedTree::Split(hedger::WbNode *tree, hedger::S_T key,
+  hedger::WbNode **left, hedger::WbNode **right)
+{
+  if (!tree) {
+    *left = *right = nullptr;
+    return nullptr;
+  }
+  hedger::WbNode *found;
+  hedger::WbNode *below, *above;
+  if (key < tree->key) {
+    found = Split(tree->left, key, &below, &above);
+    *left = below;
+    *right = Join(above, tree, tree->right);
+  } else if (key > tree->key) {
+    found = Split(tree->right, key, &below, &above);
+    *left = Join(tree->left, tree, below);
+    *right = above;
+  } else {
+    *left = tree->left;
+    *right = tree->right;
+    found = tree;
+  }
+  return found;
+}
+
+//
+// Helper functions
+//
+
+// Update
+// Recompute a node's size from its children.
+// Entry: pointer to node
+void WeightBalancedTree::Update(hedger::WbNode *node)
+{
+  node->size = SizeOf(node->left) + SizeOf(node->right) + 1;
+}
+
+// Balance
+//
+// Restore the weight balance at a node whose subtrees are balanced but
+// may have drifted apart by one insert, delete or join step.
+//
+// Entry: pointer to node
+// Exit:  new subtree root
+hedger::WbNode *WeightBalancedTree::Balance(hedger::WbNode *node)
+{
+  int leftSize = SizeOf(node->left);
+  int rightSize = SizeOf(node->right);
+
+  if (leftSize + rightSize > 1) {
+    if (rightSize > kWbDelta * leftSize) {
+      hedger::WbNode *right = node->right;
+      if (SizeOf(right->left) >= kWbRatio * SizeOf(right->right)) {
+        node->right = RotateRight(right);
+      }
+      return RotateLeft(node);
+    }
+    if (leftSize > kWbDelta * rightSize) {
+      hedger::WbNode *left = node->left;
+      if (SizeOf(left->right) >= kWbRatio * SizeOf(left->left)) {
+        node->left = RotateLeft(left);
+      }
+      return RotateRight(node);
+    }
+  }
+  Update(node);
+  return node;
+}
+
+// RotateLeft
+// Entry: pointer to node with a right child
+// Exit:  new subtree root
+hedger::WbNode *WeightBalancedTree::RotateLeft(hedger::WbNode *node)
+{
+  hedger::WbNode *right = node->right;
+  node->right = right->left;
+  right->left = node;
+  Update(node);
+  Update(right);
+  return right;
+}
+
+// RotateRight
+// Entry: pointer to node with a left child
+// Exit:  new subtree root
+hedger::WbNode *WeightBalancedTree::RotateRight(hedger::WbNode *node)
+{
+  hedger::WbNode *left = node->left;
+  node->left = left->right;
+  left->right = node;
+  Update(node);
+  Update(left);
+  return left;
+}
+
+// DeleteRecursive
+// Delete the whole subtree under and including node.
+// Entry: pointer to node
+void WeightBalancedTree::DeleteRecursive(hedger::WbNode *node)
+{
+  if (node) {
+    DeleteRecursive(node->left);
+    DeleteRecursive(node->right);
+    delete node;
+  }
+}
+} // namespace hedger
@@ -0,0 +1,104 @@
+// weight_balanced_tree.h
+//
+// Implements a weight-balanced (BB[alpha]) tree with join-based set
+// operations.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef WEIGHT_BALANCED_TREE_H_
+#define WEIGHT_BALANCED_TREE_H_
+
+#include <cstddef>
+
+#include "algo.h"
+
+namespace hedger
+{
+// Balance parameters (Adams; Hirai and Yamamoto): a subtree may be at
+// most kWbDelta times the size of its sibling, and a rotation is single
+// when the inner grandchild is under kWbRatio times the outer one.
+const int kWbDelta = 3;
+const int kWbRatio = 2;
+
+struct WbNode
+{
+  WbNode(hedger::S_T newKey) {
+    key = newKey;
+    left = right = nullptr;
+    size = 1;
+  }
+  ~WbNode() {};
+
+  hedger::WbNode *    left;     // left leg
+  hedger::WbNode *    right;    // right leg
+  hedger::S_T         key;      // key
+  int                 size;     // nodes in this subtree
+};
+
+// WeightBalancedTree
+//
+// Every node stores its subtree size, which drives both balancing and
+// Join.  Union, Intersection and Difference split one tree by the root
+// of the other and Join the recursive results, costing
+// O(m log(n / m + 1)) for trees of sizes m <= n.  The set operations
+// reuse the nodes of both operands: the result is left in this tree and
+// the other tree is emptied.
+class WeightBalancedTree
+{
+ public:
+  WeightBalancedTree();
+  virtual ~WeightBalancedTree();
+
+  bool Add(hedger::S_T key);
+  bool Find(hedger::S_T key);
+  bool DeleteKey(hedger::S_T key);
+  int Size() { return SizeOf(root_); }
+  std::size_t MemoryUsage() { return Size() * sizeof(hedger::WbNode); }
+
+  void Union(hedger::WeightBalancedTree &other);
+  void Intersection(hedger::WeightBalancedTree &other);
+  void Difference(hedger::WeightBalancedTree &other);
+
+ protected:
+  static int SizeOf(hedger::WbNode *node) { return node ? node->size : 0; }
+  static void Update(hedger::WbNode *node);
+  static hedger::WbNode *Balance(hedger::WbNode *node);
+  static hedger::WbNode *RotateLeft(hedger::WbNode *node);
+  static hedger::WbNode *RotateRight(hedger::WbNode *node);
+
+  hedger::WbNode *AddRecurse(hedger::WbNode *node, hedger::S_T key, bool *added);
+  hedger::WbNode *DeleteRecurse(hedger::WbNode *node, hedger::S_T key, bool *deleted);
+  hedger::WbNode *Join(hedger::WbNode *left, hedger::WbNode *mid, hedger::WbNode *right);
+  hedger::WbNode *Merge(hedger::WbNode *left, hedger::WbNode *right);
+  hedger::WbNode *Glue(hedger::WbNode *left, hedger::WbNode *right);
+  hedger::WbNode *InsertMin(hedger::WbNode *node, hedger::WbNode *tree);
+  hedger::WbNode *InsertMax(hedger::WbNode *node, hedger::WbNode *tree);
+  hedger::WbNode *RemoveMin(hedger::WbNode **tree);
+  hedger::WbNode *RemoveMax(hedger::WbNode **tree);
+  hedger::WbNode *Split(hedger::WbNode *tree, hedger::S_T key,
+    hedger::WbNode **left, hedger::WbNode **right);
+  hedger::WbNode *UnionRecurse(hedger::WbNode *a, hedger::WbNode *b);
+  hedger::WbNode *IntersectionRecurse(hedger::WbNode *a, hedger::WbNode *b);
+  hedger::WbNode *DifferenceRecurse(hedger::WbNode *a, hedger::WbNode *b);
+  void DeleteRecursive(hedger::WbNode *node);
+
+  hedger::WbNode *    root_;
+};
+} // namespace hedger
+#endif // #ifndef WEIGHT_BALANCED_TREE_H_
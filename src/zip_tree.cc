@@ -0,0 +1,209 @@
+// zip_tree.cc
+//
+// Implements a zip tree derived from BSTree.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdlib.h>
+
+#include "zip_tree.h"
+
+namespace hedger
+{
+// Constructor
+ZipTree::ZipTree() : BSTree::BSTree()
+{
+  seed_ = ((uint64_t) rand() << 32) ^ (uint64_t) rand() ^ 0x9e3779b97f4a7c15ull;
+}
+
+// Destructor
+ZipTree::~ZipTree()
+{
+  // Nodes are released by BSTree::~BSTree
+}
+
+// RandomRank
+//
+// Geometric rank: the number of trailing zero bits of a random word.
+//
+// Exit: rank in [0, 63]
+uint8_t ZipTree::RandomRank()
+{
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 7;
+  seed_ ^= seed_ << 17;
+  return (uint8_t) (seed_ ? __builtin_ctzll(seed_) : 63);
+}
+
+// Add
+//
+// Add a node to the tree structure.
+//
+// Entry: key of new node
+// Exit:  pointer to new node, or to the existing node holding key
+hedger::Node *ZipTree::Add(hedger::S_T key)
+{
+  hedger::Node *existing = Find(key);
+  if (existing) {
+    return existing;
+  }
+
+  hedger::Node *node = new hedger::Node(key);
+  node->rank = RandomRank();
+  Unzip(node);
+  ChangeSize(1);
+  nodeTot_++;
+  return node;
+}
+
+// Unzip
+//
+// Descend to where node belongs by rank, hang node there, and split the
+// remainder of the search path into node's left (keys < key) and right
+// (keys > key) spines.
+//
+// Entry: pointer to new node
+void ZipTree::Unzip(hedger::Node *node)
+{
+  hedger::S_T key = node->key;
+  uint8_t rank = node->rank;
+
+  hedger::Node *cur = root_;
+  hedger::Node *prev = nullptr;
+  while (cur && (rank < cur->rank || (rank == cur->rank && key > cur->key))) {
+    prev = cur;
+    cur = (key < cur->key) ? cur->left : cur->right;
+  }
+
+  if (cur == root_) {
+    root_ = node;
+  } else if (key < prev->key) {
+    prev->left = node;
+  } else {
+    prev->right = node;
+  }
+  node->parent = prev;
+  if (!cur) {
+    return;
+  }
+
+  if (key < cur->key) {
+    node->right = cur;
+  } else {
+    node->left = cur;
+  }
+  cur->parent = node;
+
+  prev = node;
+  while (cur) {
+    hedger::Node *fix = prev;
+    if (cur->key < key) {
+      do {
+        prev = cur;
+        cur = cur->right;
+      } while (cur && cur->key < key);
+    } else {
+      do {
+        prev = cur;
+        cur = cur->left;
+      } while (cur && cur->key > key);
+    }
+    if (fix->key > key || (fix == node && prev->key > key)) {
+      fix->left = cur;
+    } else {
+      fix->right = cur;
+    }
+    if (cur) {
+      cur->parent = fix;
+    }
+  }
+}
+
+// DeleteKey
+// Delete the node associated with the given key.
+// Entry: key
+// Exit: true == success
+bool ZipTree::DeleteKey(hedger::S_T key)
+{
+  hedger::Node *node = Find(key);
+  if (!node) {
+    return false;
+  }
+  Zip(node);
+  delete (int *) node->data;
+  delete node;
+  ChangeSize(-1);
+  nodeTot_--;
+  return true;
+}
+
+// Zip
+//
+// Unlink node by merging its left subtree's right spine with its right
+// subtree's left spine in rank order.
+//
+// Entry: pointer to node to unlink
+void ZipTree::Zip(hedger::Node *node)
+{
+  hedger::Node *left = node->left;
+  hedger::Node *right = node->right;
+  hedger::Node *parent = node->parent;
+  hedger::Node *cur;
+
+  if (!left) {
+    cur = right;
+  } else if (!right) {
+    cur = left;
+  } else if (left->rank >= right->rank) {
+    cur = left;
+  } else {
+    cur = right;
+  }
+
+  if (!parent) {
+    root_ = cur;
+  } else if (parent->left == node) {
+    parent->left = cur;
+  } else {
+    parent->right = cur;
+  }
+  if (cur) {
+    cur->parent = parent;
+  }
+
+  hedger::Node *prev;
+  while (left && right) {
+    if (left->rank >= right->rank) {
+      do {
+        prev = left;
+        left = left->right;
+      } while (left && left->rank >= right->rank);
+      prev->right = right;
+      right->parent = prev;
+    } else {
+      do {
+        prev = right;
+        right = right->left;
+      } while (right && left->rank < right->rank);
+      prev->left = left;
+      left->parent = prev;
+    }
+  }
+}
+} // namespace hedger
@@ -0,0 +1,54 @@
+// zip_tree.h
+//
+// Implements a zip tree derived from BSTree.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#ifndef ZIP_TREE_H_
+#define ZIP_TREE_H_
+
+#include "bstree.h"
+
+namespace hedger
+{
+
+// ZipTree
+//
+// A randomized BST (Tarjan, Levy and Timmel) that is a max-heap on node
+// rank, ties broken toward the smaller key.  Ranks are geometric with
+// p = 1/2, so one random word yields a rank and Node::rank fits it in a
+// byte.  Insert splits the search path below the new node ("unzip");
+// delete merges the two spines under the removed node ("zip").
+class ZipTree : public hedger::BSTree
+{
+  public:
+    ZipTree();
+    virtual ~ZipTree();
+    hedger::Node *Add(hedger::S_T key);
+    bool DeleteKey(hedger::S_T key);
+
+  private:
+    uint8_t RandomRank();
+    void Unzip(hedger::Node *node);
+    void Zip(hedger::Node *node);
+
+    uint64_t seed_;     // xorshift state
+};
+} // namespace hedger
+#endif // #ifndef ZIP_TREE_H_
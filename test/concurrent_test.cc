@@ -0,0 +1,133 @@
+// concurrent_test.cc
+//
+// Checks the concurrent engines with threads working on disjoint keys.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdio.h>
+
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "concurrent_skip_list.h"
+#include "cow_scapegoat_tree.h"
+#include "flat_combining_tree.h"
+#include "nm_tree.h"
+#include "olc_tree.h"
+#include "persistent_tree.h"
+#include "sharded_tree.h"
+
+const int kThreadTot = 8;
+const int kOpTot = 20000;
+const int kKeysPerThread = 1024;
+
+// RunDisjoint
+//
+// Each thread adds, finds and deletes random keys of its own residue
+// class, so every result follows from that thread's own history, then
+// checks that exactly its keys remain.  Other threads' updates reshape
+// the tree around it: a wrong result means a concurrent update hid a
+// key or let one in twice.
+//
+// Entry: engine name
+//        tree
+// Exit:  number of wrong results
+template <typename TREE>
+int RunDisjoint(const char *name, TREE &tree)
+{
+  std::atomic<int> wrongTot(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreadTot; t++) {
+    threads.push_back(std::thread([&tree, &wrongTot, t]() {
+      std::mt19937 rng(t + 1);
+      std::set<hedger::S_T> mine;
+      int wrong = 0;
+      for (int i = 0; i < kOpTot; i++) {
+        hedger::S_T key = (hedger::S_T) (rng() % kKeysPerThread) * kThreadTot + t;
+        bool present = mine.count(key) > 0;
+        switch (rng() % 3) {
+          case 0:
+            wrong += tree.Add(key) == present;
+            mine.insert(key);
+            break;
+          case 1:
+            wrong += tree.Find(key) != present;
+            break;
+          default:
+            wrong += tree.DeleteKey(key) != present;
+            mine.erase(key);
+            break;
+        }
+      }
+      for (int k = 0; k < kKeysPerThread; k++) {
+        hedger::S_T key = (hedger::S_T) k * kThreadTot + t;
+        wrong += tree.Find(key) != (mine.count(key) > 0);
+      }
+      wrongTot += wrong;
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  if (wrongTot) {
+    printf("%s: %d wrong results\n", name, wrongTot.load());
+  }
+  return wrongTot;
+}
+
+// main
+//
+// Exit:  0 == pass
+int main()
+{
+  int wrongTot = 0;
+  {
+    hedger::OlcTree tree;
+    wrongTot += RunDisjoint("olc", tree);
+  }
+  {
+    hedger::NmTree tree;
+    wrongTot += RunDisjoint("nmtree", tree);
+  }
+  {
+    hedger::ConcurrentSkipList tree;
+    wrongTot += RunDisjoint("cskiplist", tree);
+  }
+  {
+    hedger::CowScapegoatTree tree;
+    wrongTot += RunDisjoint("cow", tree);
+  }
+  {
+    hedger::ShardedTree tree;
+    wrongTot += RunDisjoint("sharded", tree);
+  }
+  {
+    hedger::PersistentTree tree;
+    wrongTot += RunDisjoint("persistent", tree);
+  }
+  {
+    hedger::FlatCombiningTree tree;
+    wrongTot += RunDisjoint("combining", tree);
+  }
+  printf("concurrent_test: %s\n", wrongTot ? "FAIL" : "pass");
+  return wrongTot ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+// flat_combining_test.cc
+//
+// Checks combining passes that mix adds and deletes against std::set.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "flat_combining_tree.h"
+
+// CombineProbe
+//
+// Posts requests straight into the slots and runs one combining pass,
+// so a batch holds as many requests as the test chooses.
+class CombineProbe : public hedger::FlatCombiningTree
+{
+ public:
+  void Post(int slot, hedger::CombineState op, hedger::S_T key) {
+    slots_[slot].key = key;
+    slots_[slot].state.store(op);
+    if (slotTot_.load() <= slot) {
+      slotTot_.store(slot + 1);
+    }
+  }
+  void Pass() {
+    std::lock_guard<std::mutex> guard(lock_);
+    Combine();
+  }
+  bool Take(int slot, bool *result) {
+    *result = slots_[slot].result;
+    bool done = hedger::kCombineDone == slots_[slot].state.load();
+    slots_[slot].state.store(hedger::kCombineIdle);
+    return done;
+  }
+  int Keys(hedger::S_T *keys) {
+    std::lock_guard<std::mutex> guard(lock_);
+    return tree_.PackKeys(keys);
+  }
+  int Size() {
+    std::lock_guard<std::mutex> guard(lock_);
+    return tree_.Size();
+  }
+};
+
+// main
+//
+// Each batch adds a run of keys in a small window, deep enough to leave
+// depth tests pending, and deletes keys from the same window.  Keys are
+// distinct within a batch, so every result follows from the set before
+// it.  Adds stay below the count that switches a pass to Build.
+//
+// Exit:  0 == pass
+int main()
+{
+  const int kBatchTot = 4000;
+  const int kAddMax = (int) hedger::kCombineBuildMin - 1;
+  const int kDeleteMax = 16;
+  const int kWindow = 64;
+  const int kKeyRange = 1 << 14;
+  CombineProbe tree;
+  std::set<hedger::S_T> model;
+  srand(1);
+
+  int result = 0;
+  for (int batch = 0; batch < kBatchTot && !result; batch++) {
+    hedger::S_T base = rand() % (kKeyRange - kWindow);
+    std::vector<hedger::CombineState> ops;
+    std::vector<hedger::S_T> keys;
+    std::set<hedger::S_T> used;
+    int addTot = 1 + rand() % kAddMax;
+    int deleteTot = rand() % (kDeleteMax + 1);
+    for (int i = 0; i < addTot + deleteTot; i++) {
+      hedger::S_T key = base + rand() % kWindow;
+      if (used.insert(key).second) {
+        ops.push_back(i < addTot ? hedger::kCombineAdd : hedger::kCombineDelete);
+        keys.push_back(key);
+      }
+    }
+    for (std::size_t i = 0; i < ops.size(); i++) {
+      tree.Post((int) i, ops[i], keys[i]);
+    }
+    tree.Pass();
+
+    for (std::size_t i = 0; i < ops.size(); i++) {
+      bool present = model.count(keys[i]) > 0;
+      bool expect = hedger::kCombineAdd == ops[i] ? !present : present;
+      bool got;
+      if (!tree.Take((int) i, &got) || got != expect) {
+        printf("batch %d: %s %d returned %d, expected %d\n", batch,
+          hedger::kCombineAdd == ops[i] ? "Add" : "DeleteKey", keys[i], got, expect);
+        result = 1;
+      }
+    }
+    for (std::size_t i = 0; i < ops.size(); i++) {
+      if (hedger::kCombineAdd == ops[i]) {
+        model.insert(keys[i]);
+      } else {
+        model.erase(keys[i]);
+      }
+    }
+  }
+
+  std::vector<hedger::S_T> out(tree.Size() + 1);
+  int n = tree.Keys(out.data());
+  if (!result && (n != (int) model.size() || !std::equal(model.begin(), model.end(), out.begin()))) {
+    printf("tree holds %d keys, expected %zu\n", n, model.size());
+    result = 1;
+  }
+  printf("flat_combining_test: %s\n", result ? "FAIL" : "pass");
+  return result;
+}
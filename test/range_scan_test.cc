@@ -0,0 +1,63 @@
+// range_scan_test.cc
+//
+// Checks that RangeScan returns every copy of keys equal to its bounds.
+//
+// This file is part of treebench.
+//
+// treebench is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// treebench is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with treebench.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Copyright (C) 2018 Gregory Hedger
+//
+
+#include <stdio.h>
+
+#include "scapegoat_tree.h"
+
+// main
+//
+// Adds keys 0..199 four times, so rebuilds leave equal keys on both
+// sides of a node, then scans ranges whose bounds are duplicated keys.
+//
+// Exit:  0 == pass
+int main()
+{
+  const int kKeyTot = 200;
+  const int kCopyTot = 4;
+  hedger::ScapegoatTree tree;
+  for (int copy = 0; copy < kCopyTot; copy++) {
+    for (int key = 0; key < kKeyTot; key++) {
+      tree.Add(key);
+    }
+  }
+
+  int result = 0;
+  hedger::S_T out[kKeyTot * kCopyTot];
+  for (int lo = 0; lo < kKeyTot; lo++) {
+    for (int hi = lo; hi < kKeyTot && hi < lo + 5; hi++) {
+      std::size_t n = tree.RangeScan(lo, hi, out, kKeyTot * kCopyTot);
+      std::size_t expect = (std::size_t) (hi - lo + 1) * kCopyTot;
+      bool ordered = true;
+      for (std::size_t i = 0; i < n; i++) {
+        ordered = ordered && out[i] >= lo && out[i] <= hi && (0 == i || out[i - 1] <= out[i]);
+      }
+      if (n != expect || !ordered) {
+        printf("RangeScan(%d, %d): %zu keys, expected %zu%s\n", lo, hi, n, expect,
+          ordered ? "" : ", out of order");
+        result = 1;
+      }
+    }
+  }
+  printf("range_scan_test: %s\n", result ? "FAIL" : "pass");
+  return result;
+}